@@ -0,0 +1,357 @@
+#include "SzarkCore.h"
+
+#include <cstring>
+#include <memory>
+#include <new>
+#include <unordered_map>
+
+static const size_t s_chunkSize = 16 * 1024;
+static const size_t s_chunkAlignment = 64;
+static const uint s_maxComponentTypes = 64;
+
+struct ComponentType
+{
+	uint size, alignment;
+};
+
+/* 16KB of entities sharing one set of components. The entity handles
+   come first, followed by one tightly packed column per component. */
+struct Chunk
+{
+	unsigned char *data;
+	uint count;
+};
+
+/* Every entity with exactly the same set of components */
+struct Archetype
+{
+	uint64_t mask;
+	uint capacity;
+	size_t offsets[s_maxComponentTypes];
+	std::vector<Chunk> chunks;
+};
+
+struct EntityRecord
+{
+	Archetype *archetype;
+	uint chunk, row, generation;
+};
+
+static std::vector<ComponentType> s_componentTypes;
+static std::unordered_map<uint64_t, std::unique_ptr<Archetype>> s_archetypes;
+static std::vector<EntityRecord> s_entityRecords;
+static std::vector<uint> s_freeEntities;
+static uint s_entityCount = 0;
+
+/* Entity handles pack the generation above the record index so handles
+   to destroyed entities never match a reused record */
+static uint64_t entityHandle(uint index)
+{
+	return (uint64_t)s_entityRecords[index].generation << 32 | index;
+}
+
+static EntityRecord *findRecord(uint64_t entity)
+{
+	uint index = (uint)entity;
+	if (index >= s_entityRecords.size()) return nullptr;
+
+	auto &record = s_entityRecords[index];
+	return record.archetype && entityHandle(index) == entity ? &record : nullptr;
+}
+
+static uint64_t *entityColumn(const Chunk &chunk)
+{
+	return reinterpret_cast<uint64_t *>(chunk.data);
+}
+
+static unsigned char *column(const Archetype &archetype, const Chunk &chunk,
+							 uint component)
+{
+	return chunk.data + archetype.offsets[component];
+}
+
+/* Lays out the columns of a new archetype so as many entities as
+   possible fit in one chunk */
+static Archetype *getArchetype(uint64_t mask)
+{
+	auto &slot = s_archetypes[mask];
+	if (slot) return slot.get();
+
+	slot = std::make_unique<Archetype>();
+	auto &archetype = *slot;
+	archetype.mask = mask;
+
+	size_t bytesPerEntity = sizeof(uint64_t);
+	for (uint i = 0; i < s_componentTypes.size(); i++)
+		if (mask >> i & 1)
+			bytesPerEntity += s_componentTypes[i].size;
+
+	// Shrink the capacity until the aligned columns fit
+	uint capacity = (uint)(s_chunkSize / bytesPerEntity);
+	while (true)
+	{
+		size_t offset = sizeof(uint64_t) * capacity;
+		for (uint i = 0; i < s_componentTypes.size(); i++)
+		{
+			if (!(mask >> i & 1)) continue;
+			auto &type = s_componentTypes[i];
+			offset = (offset + type.alignment - 1) / type.alignment * type.alignment;
+			archetype.offsets[i] = offset;
+			offset += (size_t)type.size * capacity;
+		}
+
+		if (offset <= s_chunkSize || capacity == 1) break;
+		capacity--;
+	}
+
+	archetype.capacity = capacity;
+	return &archetype;
+}
+
+/* Adds an uninitialized row to the end of an archetype */
+static void allocateRow(Archetype &archetype, uint index,
+						uint &chunkIndex, uint &row)
+{
+	if (archetype.chunks.empty() ||
+		archetype.chunks.back().count == archetype.capacity)
+	{
+		auto data = static_cast<unsigned char *>(::operator new(
+			s_chunkSize, std::align_val_t(s_chunkAlignment)));
+		archetype.chunks.push_back({data, 0});
+	}
+
+	chunkIndex = (uint)archetype.chunks.size() - 1;
+	auto &chunk = archetype.chunks.back();
+	row = chunk.count++;
+	entityColumn(chunk)[row] = entityHandle(index);
+}
+
+/* Removes a row by moving the archetype's last row into it, keeping
+   every chunk but the last one full */
+static void removeRow(Archetype &archetype, uint chunkIndex, uint row)
+{
+	auto &last = archetype.chunks.back();
+	auto &chunk = archetype.chunks[chunkIndex];
+	uint lastRow = last.count - 1;
+
+	if (&chunk != &last || row != lastRow)
+	{
+		uint64_t moved = entityColumn(last)[lastRow];
+		entityColumn(chunk)[row] = moved;
+
+		for (uint i = 0; i < s_componentTypes.size(); i++)
+		{
+			uint size = s_componentTypes[i].size;
+			if (!(archetype.mask >> i & 1) || size == 0) continue;
+			memcpy(column(archetype, chunk, i) + (size_t)row * size,
+				   column(archetype, last, i) + (size_t)lastRow * size, size);
+		}
+
+		auto &record = s_entityRecords[(uint)moved];
+		record.chunk = chunkIndex;
+		record.row = row;
+	}
+
+	if (--last.count == 0)
+	{
+		::operator delete(last.data, std::align_val_t(s_chunkAlignment));
+		archetype.chunks.pop_back();
+	}
+}
+
+/* Moves an entity to the archetype with the given mask, copying the
+   components both archetypes have in common */
+static void moveEntity(uint index, uint64_t mask)
+{
+	auto &record = s_entityRecords[index];
+	auto &from = *record.archetype;
+	auto &to = *getArchetype(mask);
+
+	uint chunkIndex = 0, row = 0;
+	allocateRow(to, index, chunkIndex, row);
+
+	auto &src = from.chunks[record.chunk];
+	auto &dst = to.chunks[chunkIndex];
+	uint64_t shared = from.mask & to.mask;
+
+	for (uint i = 0; i < s_componentTypes.size(); i++)
+	{
+		uint size = s_componentTypes[i].size;
+		if (!(shared >> i & 1) || size == 0) continue;
+		memcpy(column(to, dst, i) + (size_t)row * size,
+			   column(from, src, i) + (size_t)record.row * size, size);
+	}
+
+	removeRow(from, record.chunk, record.row);
+
+	record.archetype = &to;
+	record.chunk = chunkIndex;
+	record.row = row;
+}
+
+/* Registers a component type and returns its id. A size of 0 makes a
+   tag that only takes part in queries and takes no space. */
+auto RegisterComponent(uint size, uint alignment) -> int
+{
+	if (s_componentTypes.size() >= s_maxComponentTypes)
+	{
+		Error("Too many component types, the limit is 64!");
+		return -1;
+	}
+
+	if (size > s_chunkSize / 8)
+	{
+		Error("Component is too large to fit in a chunk!");
+		return -1;
+	}
+
+	// Alignment must be a power of two
+	alignment = std::clamp(alignment, 1u, (uint)s_chunkAlignment);
+	while (alignment & (alignment - 1))
+		alignment &= alignment - 1;
+
+	s_componentTypes.push_back({size, alignment});
+	return (int)s_componentTypes.size() - 1;
+}
+
+/* Creates an entity without components, reusing a destroyed entity's
+   record when there is one */
+auto CreateEntity() -> uint64_t
+{
+	uint index = 0;
+
+	if (!s_freeEntities.empty())
+	{
+		index = s_freeEntities.back();
+		s_freeEntities.pop_back();
+	}
+	else
+	{
+		index = (uint)s_entityRecords.size();
+		s_entityRecords.push_back({nullptr, 0, 0, 0});
+	}
+
+	auto &record = s_entityRecords[index];
+	record.archetype = getArchetype(0);
+	record.generation = std::max(record.generation + 1, 1u);
+	allocateRow(*record.archetype, index, record.chunk, record.row);
+
+	s_entityCount++;
+	return entityHandle(index);
+}
+
+/* Destroys an entity and all of its components */
+auto DestroyEntity(uint64_t entity) -> bool
+{
+	auto record = findRecord(entity);
+	if (!record) return false;
+
+	removeRow(*record->archetype, record->chunk, record->row);
+	record->archetype = nullptr;
+
+	s_freeEntities.push_back((uint)entity);
+	s_entityCount--;
+	return true;
+}
+
+/* Whether the entity hasn't been destroyed */
+auto IsEntityAlive(uint64_t entity) -> bool { return findRecord(entity) != nullptr; }
+
+/* Returns how many entities exist */
+auto GetEntityCount() -> uint { return s_entityCount; }
+
+/* Adds or replaces a component of an entity, data may be null for tags */
+auto AddComponent(uint64_t entity, uint component, const void *data) -> bool
+{
+	auto record = findRecord(entity);
+	if (!record || component >= s_componentTypes.size()) return false;
+
+	uint64_t bit = 1ull << component;
+	if (!(record->archetype->mask & bit))
+		moveEntity((uint)entity, record->archetype->mask | bit);
+
+	uint size = s_componentTypes[component].size;
+	if (data && size > 0)
+	{
+		auto &chunk = record->archetype->chunks[record->chunk];
+		memcpy(column(*record->archetype, chunk, component) +
+				   (size_t)record->row * size, data, size);
+	}
+
+	return true;
+}
+
+/* Removes a component from an entity */
+auto RemoveComponent(uint64_t entity, uint component) -> bool
+{
+	auto record = findRecord(entity);
+	if (!record || component >= s_componentTypes.size()) return false;
+
+	uint64_t bit = 1ull << component;
+	if (!(record->archetype->mask & bit)) return false;
+
+	moveEntity((uint)entity, record->archetype->mask & ~bit);
+	return true;
+}
+
+/* Whether an entity has a component */
+auto HasComponent(uint64_t entity, uint component) -> bool
+{
+	auto record = findRecord(entity);
+	return record && component < s_componentTypes.size() &&
+		   (record->archetype->mask >> component & 1);
+}
+
+/* Returns a pointer to an entity's component. It stays valid until the
+   next structural change: creating, destroying, adding or removing. */
+auto GetComponent(uint64_t entity, uint component) -> void *
+{
+	auto record = findRecord(entity);
+	if (!record || component >= s_componentTypes.size() ||
+		!(record->archetype->mask >> component & 1) ||
+		s_componentTypes[component].size == 0)
+		return nullptr;
+
+	auto &chunk = record->archetype->chunks[record->chunk];
+	return column(*record->archetype, chunk, component) +
+		   (size_t)record->row * s_componentTypes[component].size;
+}
+
+/* Finds every chunk with all components in the first mask and none in
+   the second. Up to capacity chunks are written, with the requested
+   columns at columnPointers[chunk * columnCount + column].
+   Returns the total number of matching chunks. */
+auto QueryChunks(uint64_t all, uint64_t none, const uint *columns,
+				 uint columnCount, QueryChunk *chunks, void **columnPointers,
+				 uint capacity) -> uint
+{
+	uint found = 0;
+
+	for (auto &[mask, archetype] : s_archetypes)
+	{
+		if ((mask & all) != all || (mask & none) != 0)
+			continue;
+
+		for (auto &chunk : archetype->chunks)
+		{
+			if (found < capacity)
+			{
+				chunks[found] = {chunk.count, entityColumn(chunk)};
+
+				for (uint c = 0; c < columnCount; c++)
+				{
+					uint component = columns[c];
+					bool stored = component < s_componentTypes.size() &&
+								  (mask >> component & 1) &&
+								  s_componentTypes[component].size > 0;
+					columnPointers[(size_t)found * columnCount + c] =
+						stored ? column(*archetype, chunk, component) : nullptr;
+				}
+			}
+
+			found++;
+		}
+	}
+
+	return found;
+}
\ No newline at end of file
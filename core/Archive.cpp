@@ -0,0 +1,312 @@
+#include "SzarkCore.h"
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+static const char s_archiveMagic[4] = {'S', 'Z', 'P', 'K'};
+static const uint s_archiveVersion = 1;
+
+// Blobs start on cache line boundaries so they can be read with SIMD
+static const uint s_archiveAlignment = 64;
+
+/* An archive is the header, the index sorted by name hash, the names
+   with a terminating zero, and the aligned blobs of every entry */
+struct ArchiveHeader
+{
+	char magic[4];
+	uint version, count, alignment;
+	uint64_t namesOffset, namesSize;
+};
+
+struct ArchiveEntry
+{
+	uint64_t hash, offset, size;
+	uint nameOffset, nameLength;
+};
+
+static_assert(sizeof(ArchiveHeader) == 32, "Archive header must be packed");
+static_assert(sizeof(ArchiveEntry) == 32, "Archive entry must be packed");
+
+static std::mutex s_archiveMutex;
+static std::unordered_map<uint, MappedFile> s_archives;
+static std::unordered_map<const void *, MappedFile> s_mappedAssets;
+static uint s_nextArchiveID = 1;
+
+/* FNV-1a of an entry name */
+static uint64_t hashName(const char *name, size_t length)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (unsigned char)name[i]) * 1099511628211ull;
+	return hash;
+}
+
+static const ArchiveHeader &archiveHeader(const MappedFile &file)
+{
+	return *reinterpret_cast<const ArchiveHeader *>(file.data);
+}
+
+static const ArchiveEntry *archiveEntries(const MappedFile &file)
+{
+	return reinterpret_cast<const ArchiveEntry *>(file.data + sizeof(ArchiveHeader));
+}
+
+/* Checks that the index, every entry and every name lie inside the file
+   and names end with a zero, so lookups never have to */
+static bool validateArchive(const MappedFile &file)
+{
+	if (file.size < sizeof(ArchiveHeader)) return false;
+
+	auto &header = archiveHeader(file);
+	if (memcmp(header.magic, s_archiveMagic, 4) != 0 ||
+		header.version != s_archiveVersion)
+		return false;
+
+	uint64_t indexEnd = sizeof(ArchiveHeader) + (uint64_t)header.count * sizeof(ArchiveEntry);
+	if (indexEnd > file.size || header.namesOffset < indexEnd ||
+		header.namesOffset > file.size || header.namesSize > file.size - header.namesOffset)
+		return false;
+
+	auto entries = archiveEntries(file);
+	auto names = file.data + header.namesOffset;
+	for (uint i = 0; i < header.count; i++)
+	{
+		auto &entry = entries[i];
+		uint64_t nameEnd = (uint64_t)entry.nameOffset + entry.nameLength;
+		if (entry.offset > file.size || entry.size > file.size - entry.offset ||
+			nameEnd >= header.namesSize || names[nameEnd] != 0 ||
+			(i > 0 && entries[i - 1].hash > entry.hash))
+			return false;
+	}
+
+	return true;
+}
+
+static const ArchiveEntry *findEntry(const MappedFile &file, const char *name)
+{
+	auto &header = archiveHeader(file);
+	auto entries = archiveEntries(file);
+	auto names = reinterpret_cast<const char *>(file.data + header.namesOffset);
+
+	size_t length = strlen(name);
+	uint64_t hash = hashName(name, length);
+
+	auto entry = std::lower_bound(entries, entries + header.count, hash,
+		[](const ArchiveEntry &entry, uint64_t hash) { return entry.hash < hash; });
+
+	// Names are compared too in case two of them share a hash
+	for (; entry != entries + header.count && entry->hash == hash; entry++)
+		if (entry->nameLength == length &&
+			memcmp(names + entry->nameOffset, name, length) == 0)
+			return entry;
+
+	return nullptr;
+}
+
+/* Memory maps a file for reading, for loading an asset without copying
+   it. Returns null when the file can't be opened. */
+auto MapAssetFile(const char *path, uint64_t *size) -> const void *
+{
+	MappedFile file;
+	if (!MapFile(path, file))
+		return nullptr;
+
+	if (size) *size = file.size;
+
+	std::lock_guard<std::mutex> lock(s_archiveMutex);
+	s_mappedAssets[file.data] = file;
+	return file.data;
+}
+
+/* Unmaps a file mapped with MapAssetFile */
+auto UnmapAssetFile(const void *data) -> void
+{
+	std::lock_guard<std::mutex> lock(s_archiveMutex);
+
+	auto it = s_mappedAssets.find(data);
+	if (it == s_mappedAssets.end()) return;
+
+	UnmapFile(it->second);
+	s_mappedAssets.erase(it);
+}
+
+/* Maps an archive for the rest of the run, or until it is closed.
+   Entries are read straight from the mapping. Returns 0 on failure. */
+auto OpenArchive(const char *path) -> uint
+{
+	MappedFile file;
+	if (!MapFile(path, file))
+	{
+		Error("Failed to open archive!");
+		return 0;
+	}
+
+	if (!validateArchive(file))
+	{
+		UnmapFile(file);
+		Error("Archive is invalid or from another version!");
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> lock(s_archiveMutex);
+	uint id = s_nextArchiveID++;
+	s_archives[id] = file;
+	return id;
+}
+
+/* Returns the data of an entry inside the mapping, or null if there is
+   no such entry. It stays valid until the archive is closed. */
+auto FindArchiveEntry(uint archive, const char *name, uint64_t *size) -> const void *
+{
+	if (!name) return nullptr;
+
+	std::lock_guard<std::mutex> lock(s_archiveMutex);
+
+	auto it = s_archives.find(archive);
+	if (it == s_archives.end()) return nullptr;
+
+	auto entry = findEntry(it->second, name);
+	if (!entry) return nullptr;
+
+	if (size) *size = entry->size;
+	return it->second.data + entry->offset;
+}
+
+/* Returns how many entries an archive has */
+auto GetArchiveEntryCount(uint archive) -> uint
+{
+	std::lock_guard<std::mutex> lock(s_archiveMutex);
+
+	auto it = s_archives.find(archive);
+	return it != s_archives.end() ? archiveHeader(it->second).count : 0;
+}
+
+/* Returns the name of an entry by its place in the index */
+auto GetArchiveEntryName(uint archive, uint index) -> const char *
+{
+	std::lock_guard<std::mutex> lock(s_archiveMutex);
+
+	auto it = s_archives.find(archive);
+	if (it == s_archives.end()) return nullptr;
+
+	auto &header = archiveHeader(it->second);
+	if (index >= header.count) return nullptr;
+
+	return reinterpret_cast<const char *>(it->second.data + header.namesOffset +
+										  archiveEntries(it->second)[index].nameOffset);
+}
+
+/* Unmaps an archive, every pointer into it becomes invalid */
+auto CloseArchive(uint archive) -> void
+{
+	std::lock_guard<std::mutex> lock(s_archiveMutex);
+
+	auto it = s_archives.find(archive);
+	if (it == s_archives.end()) return;
+
+	UnmapFile(it->second);
+	s_archives.erase(it);
+}
+
+/* Packs files into an archive where each is found by its name */
+auto WriteArchive(const char *path, const char *const *names,
+				  const char *const *files, uint count) -> bool
+{
+	if (!path || (count > 0 && (!names || !files))) return false;
+
+	std::vector<ArchiveEntry> entries(count);
+	std::string nameTable;
+
+	for (uint i = 0; i < count; i++)
+	{
+		size_t length = strlen(names[i]);
+		entries[i] = {hashName(names[i], length), i, 0,
+					  (uint)nameTable.size(), (uint)length};
+		nameTable.append(names[i], length + 1);
+	}
+
+	// The offset holds the input index until the blobs are laid out
+	std::sort(entries.begin(), entries.end(), [](auto &a, auto &b) {
+		return a.hash != b.hash ? a.hash < b.hash : a.offset < b.offset;
+	});
+
+	for (uint i = 1; i < count; i++)
+		if (entries[i].hash == entries[i - 1].hash &&
+			strcmp(names[entries[i].offset], names[entries[i - 1].offset]) == 0)
+		{
+			Error("Archive entry names must be unique!");
+			return false;
+		}
+
+	std::vector<uint> inputs(count);
+	for (uint i = 0; i < count; i++)
+		inputs[i] = (uint)entries[i].offset;
+
+	FILE *out = fopen(path, "wb");
+	if (!out)
+	{
+		Error("Failed to create archive file!");
+		return false;
+	}
+
+	ArchiveHeader header = {{'S', 'Z', 'P', 'K'}, s_archiveVersion, count,
+							s_archiveAlignment, 0, nameTable.size()};
+	header.namesOffset = sizeof(ArchiveHeader) + (uint64_t)count * sizeof(ArchiveEntry);
+
+	uint64_t offset = header.namesOffset + header.namesSize;
+	static const char padding[s_archiveAlignment] = {0};
+
+	// Index and names are written over these zeros once the blob offsets
+	// are known, seeking forward would need 64 bit offsets on Windows
+	std::vector<char> reserved(offset, 0);
+	bool written = fwrite(reserved.data(), 1, reserved.size(), out) == reserved.size();
+
+	for (uint i = 0; i < count && written; i++)
+	{
+		uint64_t pad = (s_archiveAlignment - offset % s_archiveAlignment) % s_archiveAlignment;
+		written = fwrite(padding, 1, pad, out) == pad;
+		offset += pad;
+
+		MappedFile file;
+		if (!MapFile(files[inputs[i]], file))
+		{
+			// Empty files can't be mapped but are still valid entries
+			FILE *empty = fopen(files[inputs[i]], "rb");
+			if (!empty)
+			{
+				fclose(out);
+				remove(path);
+				Error("Failed to read a file for the archive!");
+				return false;
+			}
+			fclose(empty);
+		}
+
+		entries[i].offset = offset;
+		entries[i].size = file.size;
+
+		if (file.size > 0)
+			written = written && fwrite(file.data, 1, file.size, out) == file.size;
+		offset += file.size;
+		UnmapFile(file);
+	}
+
+	if (written)
+	{
+		fseek(out, 0, SEEK_SET);
+		written = fwrite(&header, sizeof(header), 1, out) == 1 &&
+				  (count == 0 || fwrite(entries.data(), sizeof(ArchiveEntry),
+										count, out) == count) &&
+				  fwrite(nameTable.data(), 1, nameTable.size(), out) == nameTable.size();
+	}
+
+	written = fclose(out) == 0 && written;
+	if (!written)
+	{
+		remove(path);
+		Error("Failed to write archive file!");
+	}
+
+	return written;
+}
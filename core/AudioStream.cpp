@@ -0,0 +1,313 @@
+#include "SzarkCore.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+static const uint s_streamBufferCount = 4;
+
+// Each buffer holds this fraction of a second of audio
+static const uint s_streamBuffersPerSecond = 8;
+
+struct AudioStream
+{
+	MappedFile file;
+	int format;
+	uint frequency, blockAlign;
+
+	// The PCM samples inside the mapped file
+	size_t dataOffset, dataSize, position;
+
+	uint source;
+	uint buffers[s_streamBufferCount];
+	size_t chunkSize;
+	bool playing, loop;
+};
+
+static std::mutex s_streamMutex;
+static std::unordered_map<uint, AudioStream> s_audioStreams;
+static uint s_nextStreamID = 1;
+
+static std::thread s_streamThread;
+static std::atomic<bool> s_streamThreadRunning{false};
+
+/* Reads a little endian integer from the mapped file */
+template <typename T>
+static T readLE(const unsigned char *data)
+{
+	T value = 0;
+	for (size_t i = 0; i < sizeof(T); i++)
+		value |= (T)data[i] << (i * 8);
+	return value;
+}
+
+/* Finds the format and the samples of a PCM WAV file in memory, so
+   clips can be made straight from a mapped file or archive entry */
+auto ReadWaveInfo(const void *wave, uint64_t size, WaveInfo *info) -> bool
+{
+	auto data = static_cast<const unsigned char *>(wave);
+	if (!data || !info || size < 12 || memcmp(data, "RIFF", 4) != 0 ||
+		memcmp(data + 8, "WAVE", 4) != 0)
+		return false;
+
+	*info = {0, 0, 0, 0, 0};
+	uint channels = 0, bits = 0;
+	bool foundFormat = false, foundData = false;
+
+	// Walk the chunks, anything besides "fmt " and "data" is skipped.
+	// Either may come first, so both are found before checking them.
+	for (uint64_t offset = 12; offset + 8 <= size && !(foundFormat && foundData);)
+	{
+		uint chunkSize = readLE<uint>(data + offset + 4);
+		uint64_t body = offset + 8;
+
+		if (memcmp(data + offset, "fmt ", 4) == 0 && chunkSize >= 16 &&
+			body + 16 <= size)
+		{
+			if (readLE<uint16_t>(data + body) != 1)
+				return false;
+
+			channels = readLE<uint16_t>(data + body + 2);
+			info->frequency = readLE<uint>(data + body + 4);
+			info->blockAlign = readLE<uint16_t>(data + body + 12);
+			bits = readLE<uint16_t>(data + body + 14);
+			foundFormat = true;
+		}
+		else if (memcmp(data + offset, "data", 4) == 0 && !foundData)
+		{
+			info->offset = body;
+			info->size = std::min<uint64_t>(chunkSize, size - body);
+			foundData = true;
+		}
+
+		// Chunks are padded to an even size
+		offset = body + chunkSize + (chunkSize & 1);
+	}
+
+	if (!foundFormat || info->size == 0 || info->frequency == 0)
+		return false;
+
+	// The block size rounds the samples to whole frames, so it has to match
+	if ((bits != 8 && bits != 16) || info->blockAlign != channels * bits / 8)
+		return false;
+
+	if (channels == 1)
+		info->format = bits == 8 ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16;
+	else if (channels == 2)
+		info->format = bits == 8 ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
+	else
+		return false;
+
+	info->size -= info->size % info->blockAlign;
+	return true;
+}
+
+/* Fills a buffer with the next chunk of samples, wrapping around when
+   looping. Returns false once the end of the samples was reached. */
+static bool fillBuffer(AudioStream &stream, uint buffer)
+{
+	if (stream.position >= stream.dataSize)
+	{
+		if (!stream.loop) return false;
+		stream.position = 0;
+	}
+
+	size_t size = std::min(stream.chunkSize, stream.dataSize - stream.position);
+	alBufferData(buffer, stream.format,
+				 stream.file.data + stream.dataOffset + stream.position,
+				 (int)size, stream.frequency);
+	stream.position += size;
+	return true;
+}
+
+/* Replaces the buffers that finished playing with new chunks */
+static void updateStream(AudioStream &stream)
+{
+	int processed = 0;
+	alGetSourcei(stream.source, AL_BUFFERS_PROCESSED, &processed);
+
+	for (int i = 0; i < processed; i++)
+	{
+		uint buffer = 0;
+		alSourceUnqueueBuffers(stream.source, 1, &buffer);
+
+		if (fillBuffer(stream, buffer))
+			alSourceQueueBuffers(stream.source, 1, &buffer);
+	}
+
+	int queued = 0, state = 0;
+	alGetSourcei(stream.source, AL_BUFFERS_QUEUED, &queued);
+	alGetSourcei(stream.source, AL_SOURCE_STATE, &state);
+
+	// Restart a source that ran dry, or finish once everything played
+	if (state != AL_PLAYING && state != AL_PAUSED)
+	{
+		if (queued > 0)
+			alSourcePlay(stream.source);
+		else
+			stream.playing = false;
+	}
+}
+
+/* Keeps every playing stream fed, a quarter buffer at a time */
+static void streamLoop()
+{
+	auto interval = std::chrono::milliseconds(1000 / s_streamBuffersPerSecond / 4);
+
+	while (s_streamThreadRunning)
+	{
+		{
+			std::lock_guard<std::mutex> lock(s_streamMutex);
+			for (auto &[id, stream] : s_audioStreams)
+				if (stream.playing)
+					updateStream(stream);
+		}
+
+		std::this_thread::sleep_for(interval);
+	}
+}
+
+/* Joins the stream thread when the library unloads */
+static struct AudioStreamShutdown
+{
+	~AudioStreamShutdown()
+	{
+		s_streamThreadRunning = false;
+		if (s_streamThread.joinable())
+			s_streamThread.join();
+	}
+} s_audioStreamShutdown;
+
+/* Stops a source and takes back all of its buffers */
+static void resetSource(AudioStream &stream)
+{
+	alSourceStop(stream.source);
+
+	int queued = 0;
+	alGetSourcei(stream.source, AL_BUFFERS_QUEUED, &queued);
+	while (queued-- > 0)
+	{
+		uint buffer = 0;
+		alSourceUnqueueBuffers(stream.source, 1, &buffer);
+	}
+}
+
+/* Opens a PCM WAV file for streaming. The file is memory mapped and only
+   a few small buffers are ever decoded, whatever the length. */
+auto OpenAudioStream(const char *path) -> uint
+{
+	AudioStream stream = {};
+
+	if (!MapFile(path, stream.file))
+	{
+		Error("Failed to open audio stream file!");
+		return 0;
+	}
+
+	WaveInfo wave;
+	if (!ReadWaveInfo(stream.file.data, stream.file.size, &wave))
+	{
+		UnmapFile(stream.file);
+		Error("Audio stream is not a PCM WAV file!");
+		return 0;
+	}
+
+	stream.format = wave.format;
+	stream.frequency = wave.frequency;
+	stream.blockAlign = wave.blockAlign;
+	stream.dataOffset = wave.offset;
+	stream.dataSize = wave.size;
+
+	size_t bytesPerSecond = (size_t)stream.frequency * stream.blockAlign;
+	stream.chunkSize = std::max<size_t>(bytesPerSecond / s_streamBuffersPerSecond,
+										stream.blockAlign);
+	stream.chunkSize -= stream.chunkSize % stream.blockAlign;
+
+	alGenSources(1, &stream.source);
+	alGenBuffers(s_streamBufferCount, stream.buffers);
+
+	std::lock_guard<std::mutex> lock(s_streamMutex);
+	uint id = s_nextStreamID++;
+	s_audioStreams[id] = stream;
+
+	if (!s_streamThreadRunning.exchange(true))
+		s_streamThread = std::thread(streamLoop);
+
+	return id;
+}
+
+/* Plays a stream from the start. The first buffers are filled right away
+   so playback starts immediately, the rest is streamed in the background. */
+auto PlayAudioStream(uint id, float volume, bool loop) -> void
+{
+	std::lock_guard<std::mutex> lock(s_streamMutex);
+
+	auto it = s_audioStreams.find(id);
+	if (it == s_audioStreams.end()) return;
+	auto &stream = it->second;
+
+	resetSource(stream);
+	stream.position = 0;
+	stream.loop = loop;
+
+	uint filled = 0;
+	while (filled < s_streamBufferCount &&
+		   fillBuffer(stream, stream.buffers[filled]))
+		filled++;
+
+	alSourceQueueBuffers(stream.source, filled, stream.buffers);
+	alSourcef(stream.source, AL_GAIN, volume);
+	alSourcePlay(stream.source);
+	stream.playing = true;
+}
+
+/* Stops a stream from playing */
+auto StopAudioStream(uint id) -> void
+{
+	std::lock_guard<std::mutex> lock(s_streamMutex);
+
+	auto it = s_audioStreams.find(id);
+	if (it == s_audioStreams.end()) return;
+
+	resetSource(it->second);
+	it->second.playing = false;
+}
+
+/* Whether a stream still has audio left to play */
+auto IsAudioStreamPlaying(uint id) -> bool
+{
+	std::lock_guard<std::mutex> lock(s_streamMutex);
+
+	auto it = s_audioStreams.find(id);
+	return it != s_audioStreams.end() && it->second.playing;
+}
+
+/* Returns the length of a stream in seconds */
+auto GetAudioStreamLength(uint id) -> double
+{
+	std::lock_guard<std::mutex> lock(s_streamMutex);
+
+	auto it = s_audioStreams.find(id);
+	if (it == s_audioStreams.end()) return 0;
+
+	auto &stream = it->second;
+	return (double)stream.dataSize / stream.blockAlign / stream.frequency;
+}
+
+/* Stops a stream and frees its source, buffers and file mapping */
+auto CloseAudioStream(uint id) -> void
+{
+	std::lock_guard<std::mutex> lock(s_streamMutex);
+
+	auto it = s_audioStreams.find(id);
+	if (it == s_audioStreams.end()) return;
+	auto &stream = it->second;
+
+	resetSource(stream);
+	alDeleteSources(1, &stream.source);
+	alDeleteBuffers(s_streamBufferCount, stream.buffers);
+	UnmapFile(stream.file);
+	s_audioStreams.erase(it);
+}
\ No newline at end of file
@@ -0,0 +1,558 @@
+#include "SzarkCore.h"
+
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+using BroadphaseClock = std::chrono::steady_clock;
+
+// Items touching more cells than this are kept out of the grid and
+// tested against everything instead
+static const uint s_maxItemCells = 64;
+
+static const float s_infinity = std::numeric_limits<float>::infinity();
+
+struct Bounds
+{
+	float minX, minY, maxX, maxY;
+};
+
+/* Inclusive range of the grid cells a box touches */
+struct CellRange
+{
+	int minX, minY, maxX, maxY;
+};
+
+/* One item listed in one grid cell */
+struct CellEntry
+{
+	int x, y;
+	uint item;
+};
+
+/* A uniform grid hashed into a power of two number of buckets. Items
+   are listed in every cell they touch, with the entries of a bucket
+   next to each other so a cell is one contiguous run to scan. */
+struct Broadphase
+{
+	float cellSize, inverseCellSize;
+
+	std::vector<uint64_t> entities;
+	std::vector<Bounds> bounds;
+	std::vector<CellRange> ranges;
+	std::vector<uint> largeItems;
+	std::vector<uint> bucketStarts;
+	std::vector<CellEntry> entries;
+	uint bucketMask, indexed;
+	Bounds world;
+
+	// Found on the first pair query after a build
+	std::vector<EntityPair> pairs;
+	bool pairsFound;
+
+	BroadphaseStats stats;
+	double insertTime;
+	std::shared_mutex mutex;
+};
+
+static std::mutex s_broadphaseMutex;
+static std::unordered_map<uint, std::shared_ptr<Broadphase>> s_broadphases;
+static uint s_nextBroadphaseID = 1;
+
+static std::shared_ptr<Broadphase> findBroadphase(uint id)
+{
+	std::lock_guard<std::mutex> lock(s_broadphaseMutex);
+	auto it = s_broadphases.find(id);
+	return it != s_broadphases.end() ? it->second : nullptr;
+}
+
+static double seconds(BroadphaseClock::time_point start)
+{
+	return std::chrono::duration<double>(BroadphaseClock::now() - start).count();
+}
+
+static int cellOf(float value, float inverseCellSize)
+{
+	// Clamped so huge coordinates can't overflow the cell index
+	return (int)std::floor(std::clamp(value * inverseCellSize, -1e9f, 1e9f));
+}
+
+static CellRange cellRange(const Bounds &bounds, float inverseCellSize)
+{
+	return {cellOf(bounds.minX, inverseCellSize), cellOf(bounds.minY, inverseCellSize),
+			cellOf(bounds.maxX, inverseCellSize), cellOf(bounds.maxY, inverseCellSize)};
+}
+
+static int64_t cellCount(const CellRange &range)
+{
+	return ((int64_t)range.maxX - range.minX + 1) * ((int64_t)range.maxY - range.minY + 1);
+}
+
+static uint hashCell(int x, int y, uint mask)
+{
+	return ((uint)x * 73856093u ^ (uint)y * 19349663u) & mask;
+}
+
+/* Boxes include their edges, so touching boxes overlap */
+static bool overlaps(const Bounds &a, const Bounds &b)
+{
+	return a.minX <= b.maxX && b.minX <= a.maxX &&
+		   a.minY <= b.maxY && b.minY <= a.maxY;
+}
+
+/* Overlapping boxes can share several cells. Only the cell holding the
+   top left corner of the overlap reports them, so they're found once. */
+static bool ownsOverlap(const Bounds &a, const Bounds &b, const CellEntry &cell,
+						float inverseCellSize)
+{
+	return cellOf(std::max(a.minX, b.minX), inverseCellSize) == cell.x &&
+		   cellOf(std::max(a.minY, b.minY), inverseCellSize) == cell.y;
+}
+
+/* Distances along a ray where it enters and leaves a box */
+static bool slab(const Bounds &bounds, float x, float y, float dx, float dy,
+				 float &enter, float &exit, bool &enteredX)
+{
+	float enterX = -s_infinity, exitX = s_infinity;
+	float enterY = -s_infinity, exitY = s_infinity;
+
+	if (dx != 0)
+	{
+		float a = (bounds.minX - x) / dx, b = (bounds.maxX - x) / dx;
+		enterX = std::min(a, b), exitX = std::max(a, b);
+	}
+	else if (x < bounds.minX || x > bounds.maxX)
+		return false;
+
+	if (dy != 0)
+	{
+		float a = (bounds.minY - y) / dy, b = (bounds.maxY - y) / dy;
+		enterY = std::min(a, b), exitY = std::max(a, b);
+	}
+	else if (y < bounds.minY || y > bounds.maxY)
+		return false;
+
+	enter = std::max(enterX, enterY);
+	exit = std::min(exitX, exitY);
+	enteredX = enterX > enterY;
+	return enter <= exit && exit >= 0;
+}
+
+/* Calls visit with every entry listed in a cell */
+template <typename Visit>
+static void forEachInCell(const Broadphase &broadphase, int x, int y, Visit visit)
+{
+	uint bucket = hashCell(x, y, broadphase.bucketMask);
+	for (uint i = broadphase.bucketStarts[bucket]; i < broadphase.bucketStarts[bucket + 1]; i++)
+	{
+		auto &entry = broadphase.entries[i];
+		if (entry.x == x && entry.y == y) visit(entry);
+	}
+}
+
+/* Tests every pair sharing a cell, then the large items against all */
+static void findPairs(Broadphase &broadphase)
+{
+	auto &entries = broadphase.entries;
+	auto &bounds = broadphase.bounds;
+	uint64_t candidates = 0;
+
+	auto addPair = [&](uint a, uint b) {
+		if (a > b) std::swap(a, b);
+		broadphase.pairs.push_back({broadphase.entities[a], broadphase.entities[b]});
+	};
+
+	broadphase.pairs.clear();
+
+	for (uint bucket = 0; bucket + 1 < broadphase.bucketStarts.size(); bucket++)
+	{
+		uint end = broadphase.bucketStarts[bucket + 1];
+		for (uint i = broadphase.bucketStarts[bucket]; i < end; i++)
+		{
+			auto &a = entries[i];
+			for (uint j = i + 1; j < end; j++)
+			{
+				auto &b = entries[j];
+				if (a.x != b.x || a.y != b.y) continue;
+
+				candidates++;
+				if (overlaps(bounds[a.item], bounds[b.item]) &&
+					ownsOverlap(bounds[a.item], bounds[b.item], a,
+								broadphase.inverseCellSize))
+					addPair(a.item, b.item);
+			}
+		}
+	}
+
+	// Large items have an empty range, two of them are paired only once
+	for (uint large : broadphase.largeItems)
+		for (uint item = 0; item < broadphase.indexed; item++)
+		{
+			auto &range = broadphase.ranges[item];
+			if (item == large || (range.maxX < range.minX && item < large))
+				continue;
+
+			candidates++;
+			if (overlaps(bounds[large], bounds[item]))
+				addPair(large, item);
+		}
+
+	broadphase.pairsFound = true;
+	broadphase.stats.candidatePairs = candidates;
+	broadphase.stats.pairs = (uint64_t)broadphase.pairs.size();
+}
+
+/* Walks the cells along the ray until nothing closer can be hit */
+static BroadphaseHit raycast(const Broadphase &broadphase, const BroadphaseRay &ray)
+{
+	BroadphaseHit hit = {0, 0, 0, 0, 0, 0};
+
+	float length = std::sqrt(ray.dx * ray.dx + ray.dy * ray.dy);
+	if (!(length > 0) || !(ray.maxDistance >= 0)) return hit;
+
+	float dx = ray.dx / length, dy = ray.dy / length;
+	float best = ray.maxDistance;
+	uint bestItem = 0;
+	bool found = false, bestX = false;
+
+	auto test = [&](uint item) {
+		float enter = 0, exit = 0;
+		bool enteredX = false;
+		if (!slab(broadphase.bounds[item], ray.x, ray.y, dx, dy, enter, exit, enteredX))
+			return;
+
+		enter = std::max(enter, 0.0f);
+		if (enter > best || (found && enter == best && item >= bestItem)) return;
+
+		best = enter, bestItem = item, bestX = enteredX, found = true;
+	};
+
+	for (uint large : broadphase.largeItems)
+		test(large);
+
+	float enter = 0, exit = 0;
+	bool enteredX = false;
+	if (!broadphase.entries.empty() &&
+		slab(broadphase.world, ray.x, ray.y, dx, dy, enter, exit, enteredX) &&
+		std::max(enter, 0.0f) <= best)
+	{
+		float start = std::max(enter, 0.0f);
+		float inverse = broadphase.inverseCellSize, size = broadphase.cellSize;
+
+		int x = cellOf(ray.x + dx * start, inverse);
+		int y = cellOf(ray.y + dy * start, inverse);
+		int stepX = dx > 0 ? 1 : -1, stepY = dy > 0 ? 1 : -1;
+
+		// Distances along the ray to the next cell edge, and between edges
+		float nextX = dx != 0 ? ((x + (dx > 0)) * size - ray.x) / dx : s_infinity;
+		float nextY = dy != 0 ? ((y + (dy > 0)) * size - ray.y) / dy : s_infinity;
+		float deltaX = dx != 0 ? size / std::abs(dx) : s_infinity;
+		float deltaY = dy != 0 ? size / std::abs(dy) : s_infinity;
+
+		while (true)
+		{
+			forEachInCell(broadphase, x, y, [&](const CellEntry &entry) { test(entry.item); });
+
+			float cellExit = std::min(nextX, nextY);
+			if ((found && best <= cellExit) || cellExit > std::min(exit, best))
+				break;
+
+			if (nextX < nextY) x += stepX, nextX += deltaX;
+			else y += stepY, nextY += deltaY;
+		}
+	}
+
+	if (!found) return hit;
+
+	hit.entity = broadphase.entities[bestItem];
+	hit.distance = best;
+	hit.x = ray.x + dx * best;
+	hit.y = ray.y + dy * best;
+
+	// Rays starting inside a box hit it right away with no normal
+	auto &bounds = broadphase.bounds[bestItem];
+	bool inside = ray.x >= bounds.minX && ray.x <= bounds.maxX &&
+				  ray.y >= bounds.minY && ray.y <= bounds.maxY;
+	if (!inside)
+	{
+		hit.normalX = bestX ? (dx > 0 ? -1.0f : 1.0f) : 0.0f;
+		hit.normalY = bestX ? 0.0f : (dy > 0 ? -1.0f : 1.0f);
+	}
+
+	return hit;
+}
+
+/* Creates an empty broadphase. Cells should be about the size of the
+   common item, larger ones fall back to being tested against all. */
+auto CreateBroadphase(float cellSize) -> uint
+{
+	if (!(cellSize > 0) || !std::isfinite(cellSize))
+	{
+		Error("Broadphase cell size must be positive!");
+		return 0;
+	}
+
+	auto broadphase = std::make_shared<Broadphase>();
+	broadphase->cellSize = cellSize;
+	broadphase->inverseCellSize = 1.0f / cellSize;
+	broadphase->bucketMask = 0;
+	broadphase->indexed = 0;
+	broadphase->world = {0, 0, 0, 0};
+	broadphase->pairsFound = false;
+	broadphase->stats = {};
+	broadphase->insertTime = 0;
+
+	std::lock_guard<std::mutex> lock(s_broadphaseMutex);
+	uint id = s_nextBroadphaseID++;
+	s_broadphases[id] = broadphase;
+	return id;
+}
+
+/* Frees a broadphase, queries already running on it still finish */
+auto DestroyBroadphase(uint broadphase) -> void
+{
+	std::lock_guard<std::mutex> lock(s_broadphaseMutex);
+	s_broadphases.erase(broadphase);
+}
+
+/* Removes every item to start a rebuild */
+auto ClearBroadphase(uint broadphase) -> void
+{
+	auto found = findBroadphase(broadphase);
+	if (!found) return;
+
+	std::unique_lock<std::shared_mutex> lock(found->mutex);
+	found->entities.clear();
+	found->bounds.clear();
+	found->largeItems.clear();
+	found->bucketStarts.clear();
+	found->entries.clear();
+	found->pairs.clear();
+	found->pairsFound = false;
+	found->indexed = 0;
+	found->insertTime = 0;
+}
+
+/* Adds items for the next build. Each box is four floats, the position
+   and the size, every stride bytes so they can be read straight out of
+   a component column. Boxes that aren't finite are skipped. */
+auto InsertBroadphase(uint broadphase, const uint64_t *entities, const void *bounds,
+					  uint stride, uint count) -> void
+{
+	auto found = findBroadphase(broadphase);
+	if (!found || !entities || !bounds) return;
+
+	std::unique_lock<std::shared_mutex> lock(found->mutex);
+	auto start = BroadphaseClock::now();
+	auto bytes = static_cast<const unsigned char *>(bounds);
+
+	for (uint i = 0; i < count; i++)
+	{
+		float box[4];
+		memcpy(box, bytes + (size_t)i * stride, sizeof(box));
+
+		float x2 = box[0] + box[2], y2 = box[1] + box[3];
+		if (!std::isfinite(x2) || !std::isfinite(y2) ||
+			!std::isfinite(box[0]) || !std::isfinite(box[1]))
+			continue;
+
+		found->entities.push_back(entities[i]);
+		found->bounds.push_back({std::min(box[0], x2), std::min(box[1], y2),
+								 std::max(box[0], x2), std::max(box[1], y2)});
+	}
+
+	found->insertTime += seconds(start);
+}
+
+/* Lists the inserted items in the grid with a counting sort of their
+   cells, which queries use until the next build */
+auto BuildBroadphase(uint broadphase) -> void
+{
+	auto found = findBroadphase(broadphase);
+	if (!found) return;
+
+	std::unique_lock<std::shared_mutex> lock(found->mutex);
+	auto start = BroadphaseClock::now();
+	auto &grid = *found;
+
+	uint count = (uint)grid.bounds.size();
+	grid.ranges.resize(count);
+	grid.largeItems.clear();
+	grid.pairs.clear();
+	grid.pairsFound = false;
+	grid.world = {s_infinity, s_infinity, -s_infinity, -s_infinity};
+
+	size_t references = 0;
+	for (uint i = 0; i < count; i++)
+	{
+		auto &range = grid.ranges[i] = cellRange(grid.bounds[i], grid.inverseCellSize);
+		int64_t cells = cellCount(range);
+
+		if (cells > s_maxItemCells)
+		{
+			grid.largeItems.push_back(i);
+			range = {0, 0, -1, -1};
+			continue;
+		}
+
+		references += (size_t)cells;
+
+		auto &bounds = grid.bounds[i];
+		grid.world = {std::min(grid.world.minX, bounds.minX), std::min(grid.world.minY, bounds.minY),
+					  std::max(grid.world.maxX, bounds.maxX), std::max(grid.world.maxY, bounds.maxY)};
+	}
+
+	// At least twice the buckets as entries keeps cells from sharing one
+	uint buckets = 16;
+	while (buckets < references * 2 && buckets < (1u << 30)) buckets *= 2;
+	grid.bucketMask = buckets - 1;
+	grid.bucketStarts.assign(buckets + 1, 0);
+
+	for (auto &range : grid.ranges)
+		for (int y = range.minY; y <= range.maxY; y++)
+			for (int x = range.minX; x <= range.maxX; x++)
+				grid.bucketStarts[hashCell(x, y, grid.bucketMask) + 1]++;
+
+	for (uint i = 0; i < buckets; i++)
+		grid.bucketStarts[i + 1] += grid.bucketStarts[i];
+
+	grid.entries.resize(references);
+	std::vector<uint> next(grid.bucketStarts.begin(), grid.bucketStarts.end() - 1);
+
+	for (uint i = 0; i < count; i++)
+	{
+		auto &range = grid.ranges[i];
+		for (int y = range.minY; y <= range.maxY; y++)
+			for (int x = range.minX; x <= range.maxX; x++)
+				grid.entries[next[hashCell(x, y, grid.bucketMask)]++] = {x, y, i};
+	}
+
+	grid.indexed = count;
+	grid.stats = {count, (uint)grid.largeItems.size(), (uint)references,
+				  0, 0, grid.insertTime + seconds(start)};
+}
+
+/* Writes up to capacity pairs of overlapping items and returns how
+   many there are. Pairs are found once per build and kept. */
+auto FindBroadphasePairs(uint broadphase, EntityPair *pairs, uint capacity) -> uint
+{
+	auto found = findBroadphase(broadphase);
+	if (!found) return 0;
+
+	std::unique_lock<std::shared_mutex> lock(found->mutex);
+	if (!found->pairsFound) findPairs(*found);
+
+	uint count = (uint)found->pairs.size();
+	if (pairs) std::copy_n(found->pairs.begin(), std::min(count, capacity), pairs);
+	return count;
+}
+
+/* Writes up to capacity items containing the point and returns how
+   many there are */
+auto QueryBroadphasePoint(uint broadphase, float x, float y, uint64_t *entities,
+						  uint capacity) -> uint
+{
+	auto found = findBroadphase(broadphase);
+	if (!found || !std::isfinite(x) || !std::isfinite(y)) return 0;
+
+	std::shared_lock<std::shared_mutex> lock(found->mutex);
+	auto &grid = *found;
+	Bounds point = {x, y, x, y};
+	uint count = 0;
+
+	auto report = [&](uint item) {
+		if (entities && count < capacity) entities[count] = grid.entities[item];
+		count++;
+	};
+
+	if (!grid.entries.empty())
+	{
+		int cellX = cellOf(x, grid.inverseCellSize), cellY = cellOf(y, grid.inverseCellSize);
+		forEachInCell(grid, cellX, cellY, [&](const CellEntry &entry) {
+			if (overlaps(grid.bounds[entry.item], point)) report(entry.item);
+		});
+	}
+
+	for (uint large : grid.largeItems)
+		if (overlaps(grid.bounds[large], point)) report(large);
+
+	return count;
+}
+
+/* Writes up to capacity items overlapping the box and returns how many
+   there are */
+auto QueryBroadphaseRect(uint broadphase, float x, float y, float width, float height,
+						 uint64_t *entities, uint capacity) -> uint
+{
+	auto found = findBroadphase(broadphase);
+	if (!found || !std::isfinite(x + width) || !std::isfinite(y + height)) return 0;
+
+	std::shared_lock<std::shared_mutex> lock(found->mutex);
+	auto &grid = *found;
+	Bounds query = {std::min(x, x + width), std::min(y, y + height),
+					std::max(x, x + width), std::max(y, y + height)};
+	uint count = 0;
+
+	auto report = [&](uint item) {
+		if (entities && count < capacity) entities[count] = grid.entities[item];
+		count++;
+	};
+
+	auto range = cellRange(query, grid.inverseCellSize);
+
+	// A box covering more cells than there are entries is quicker to
+	// test against every item
+	if (cellCount(range) > (int64_t)grid.entries.size())
+	{
+		for (uint item = 0; item < grid.indexed; item++)
+			if (overlaps(grid.bounds[item], query)) report(item);
+		return count;
+	}
+
+	for (int cellY = range.minY; cellY <= range.maxY; cellY++)
+		for (int cellX = range.minX; cellX <= range.maxX; cellX++)
+			forEachInCell(grid, cellX, cellY, [&](const CellEntry &entry) {
+				auto &bounds = grid.bounds[entry.item];
+				if (overlaps(bounds, query) &&
+					ownsOverlap(bounds, query, entry, grid.inverseCellSize))
+					report(entry.item);
+			});
+
+	for (uint large : grid.largeItems)
+		if (overlaps(grid.bounds[large], query)) report(large);
+
+	return count;
+}
+
+/* Finds the nearest item along each ray. Misses have an entity of 0.
+   Returns how many rays hit something. */
+auto RaycastBroadphase(uint broadphase, const BroadphaseRay *rays, uint count,
+					   BroadphaseHit *hits) -> uint
+{
+	auto found = findBroadphase(broadphase);
+	if (!found || !rays || !hits) return 0;
+
+	std::shared_lock<std::shared_mutex> lock(found->mutex);
+	uint hitCount = 0;
+
+	for (uint i = 0; i < count; i++)
+	{
+		hits[i] = raycast(*found, rays[i]);
+		if (hits[i].entity != 0) hitCount++;
+	}
+
+	return hitCount;
+}
+
+/* Returns the size of the last build and the pairs it tested */
+auto GetBroadphaseStats(uint broadphase) -> BroadphaseStats
+{
+	auto found = findBroadphase(broadphase);
+	if (!found) return {};
+
+	std::shared_lock<std::shared_mutex> lock(found->mutex);
+	return found->stats;
+}
@@ -0,0 +1,607 @@
+#include "SzarkCore.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Readbacks in flight on the graphics card
+static const uint s_captureRingSize = 3;
+
+static const uint s_defaultCaptureFrames = 8;
+static const size_t s_captureFileBuffer = 1 << 20;
+
+// Unchanged runs shorter than this are kept inside a delta span, as
+// starting a new span costs more than the pixels
+static const uint s_deltaMergeGap = 3;
+
+/* A copied frame waiting for the writer, top row first */
+struct CapturedFrame
+{
+	std::vector<Color> pixels;
+	uint64_t number;
+};
+
+/* A capture to start on the render thread, its file is already open */
+struct CaptureRequest
+{
+	std::string path;
+	CaptureFormat format;
+	uint frameRate, queueFrames;
+	FILE *file;
+};
+
+// Starting and stopping may be asked for from any thread, the render
+// thread applies it before capturing its next frame
+static std::mutex s_captureRequestMutex;
+static std::atomic<bool> s_captureRequested{false};
+static bool s_startRequested = false, s_stopRequested = false;
+static CaptureRequest s_captureRequest = {};
+
+// Only changed on the render thread while holding the request lock
+static std::atomic<bool> s_capturing{false};
+static std::string s_capturePath;
+static CaptureFormat s_captureFormat;
+static uint s_captureRate = 0;
+static uint s_captureWidth = 0, s_captureHeight = 0;
+static FILE *s_captureFile = nullptr;
+
+// Frames are only ever allocated once, the writer hands them back
+static std::mutex s_captureMutex;
+static std::condition_variable s_captureWake;
+static std::vector<CapturedFrame> s_captureFrames;
+static std::vector<uint> s_freeFrames;
+static std::deque<uint> s_queuedFrames;
+static bool s_captureStopping = false;
+static CaptureStats s_captureStats = {};
+static std::thread s_captureThread;
+
+// Ring of pixel pack buffers the frames are read back through
+static uint s_packBuffers[s_captureRingSize];
+static GLsync s_packFences[s_captureRingSize];
+static uint64_t s_packNumbers[s_captureRingSize];
+static std::deque<uint> s_pendingReads;
+static uint s_nextPackBuffer = 0;
+
+/* Writes the whole buffer and counts it, false when the disk refused */
+static bool writeBytes(FILE *file, const void *data, size_t size)
+{
+	if (fwrite(data, 1, size, file) != size)
+		return false;
+
+	std::lock_guard<std::mutex> lock(s_captureMutex);
+	s_captureStats.bytes += size;
+	return true;
+}
+
+/* Writes a frame as its own binary PPM file, named after the frame */
+static bool writePPM(const CapturedFrame &frame)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%06llu.ppm", (unsigned long long)frame.number);
+
+	FILE *file = fopen((s_capturePath + name).c_str(), "wb");
+	if (!file) return false;
+
+	char header[32];
+	int headerSize = snprintf(header, sizeof(header), "P6\n%u %u\n255\n",
+							  s_captureWidth, s_captureHeight);
+
+	bool written = writeBytes(file, header, headerSize) &&
+				   writeBytes(file, frame.pixels.data(), frame.pixels.size() * sizeof(Color));
+	return fclose(file) == 0 && written;
+}
+
+/* Writes a frame of a YUV4MPEG2 stream as full resolution BT.601 planes,
+   so nothing is lost to chroma subsampling. The stream has no timestamps,
+   so frames dropped since the last one repeat it to keep the frame rate. */
+static bool writeY4M(const CapturedFrame &frame, std::vector<unsigned char> &planes,
+					 bool first, uint64_t lastNumber)
+{
+	if (first)
+	{
+		char header[64];
+		int headerSize = snprintf(header, sizeof(header),
+								  "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n",
+								  s_captureWidth, s_captureHeight, s_captureRate);
+		if (!writeBytes(s_captureFile, header, headerSize))
+			return false;
+	}
+	else
+	{
+		for (uint64_t n = lastNumber + 1; n < frame.number; n++)
+			if (!writeBytes(s_captureFile, "FRAME\n", 6) ||
+				!writeBytes(s_captureFile, planes.data(), planes.size()))
+				return false;
+	}
+
+	size_t count = frame.pixels.size();
+	planes.resize(count * 3);
+	unsigned char *y = planes.data(), *u = y + count, *v = u + count;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		int r = frame.pixels[i].r, g = frame.pixels[i].g, b = frame.pixels[i].b;
+		y[i] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+		u[i] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+		v[i] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+	}
+
+	return writeBytes(s_captureFile, "FRAME\n", 6) &&
+		   writeBytes(s_captureFile, planes.data(), planes.size());
+}
+
+/* Writes the pixels that changed since the last written frame. The file
+   starts with "SZCAP1" and the width, height and frame rate. Every frame
+   is its number, a span count and the spans: pixels skipped since the
+   previous span, the length and the RGB pixels. Integers are 32 bit,
+   the frame number 64 bit, all little endian. The first frame is
+   compared against black. */
+static bool writeDelta(const CapturedFrame &frame, std::vector<Color> &previous,
+					   std::vector<unsigned char> &spans, bool first)
+{
+	auto put = [&](const void *data, size_t size) {
+		auto bytes = static_cast<const unsigned char *>(data);
+		spans.insert(spans.end(), bytes, bytes + size);
+	};
+
+	auto changed = [&](size_t i) {
+		const Color &a = frame.pixels[i], &b = previous[i];
+		return a.r != b.r || a.g != b.g || a.b != b.b;
+	};
+
+	if (first)
+	{
+		uint header[3] = {s_captureWidth, s_captureHeight, s_captureRate};
+		if (!writeBytes(s_captureFile, "SZCAP1", 6) ||
+			!writeBytes(s_captureFile, header, sizeof(header)))
+			return false;
+
+		previous.assign(frame.pixels.size(), {0, 0, 0});
+	}
+
+	spans.clear();
+	uint spanCount = 0;
+	size_t count = frame.pixels.size(), end = 0;
+
+	for (size_t i = 0; i < count;)
+	{
+		if (!changed(i))
+		{
+			i++;
+			continue;
+		}
+
+		// Grows the span over short unchanged gaps
+		size_t start = i, last = i;
+		for (i++; i < count && i - last <= s_deltaMergeGap; i++)
+			if (changed(i)) last = i;
+
+		uint span[2] = {(uint)(start - end), (uint)(last - start + 1)};
+		put(span, sizeof(span));
+		put(&frame.pixels[start], span[1] * sizeof(Color));
+
+		end = last + 1;
+		i = end;
+		spanCount++;
+	}
+
+	previous = frame.pixels;
+	return writeBytes(s_captureFile, &frame.number, sizeof(frame.number)) &&
+		   writeBytes(s_captureFile, &spanCount, sizeof(spanCount)) &&
+		   writeBytes(s_captureFile, spans.data(), spans.size());
+}
+
+/* Encodes queued frames until capture stops and the queue is empty */
+static void captureLoop()
+{
+	std::vector<unsigned char> scratch;
+	std::vector<Color> previous;
+	uint64_t lastNumber = 0;
+	bool first = true, failed = false;
+
+	while (true)
+	{
+		uint index;
+		{
+			std::unique_lock<std::mutex> lock(s_captureMutex);
+			s_captureWake.wait(lock, [] { return s_captureStopping || !s_queuedFrames.empty(); });
+			if (s_queuedFrames.empty()) break;
+
+			index = s_queuedFrames.front();
+			s_queuedFrames.pop_front();
+			s_captureStats.queued = (uint)s_queuedFrames.size();
+		}
+
+		const CapturedFrame &frame = s_captureFrames[index];
+		bool written = false;
+
+		if (!failed)
+		{
+			switch (s_captureFormat)
+			{
+			case CaptureFormat::PPM:
+				written = writePPM(frame);
+				break;
+			case CaptureFormat::Y4M:
+				written = writeY4M(frame, scratch, first, lastNumber);
+				break;
+			case CaptureFormat::Delta:
+				written = writeDelta(frame, previous, scratch, first);
+				break;
+			}
+
+			// Frames after a failed write are dropped, nothing would read them
+			if (!written)
+			{
+				Error("Failed to write a captured frame!");
+				failed = true;
+			}
+		}
+
+		if (written)
+		{
+			first = false;
+			lastNumber = frame.number;
+		}
+
+		std::lock_guard<std::mutex> lock(s_captureMutex);
+		s_freeFrames.push_back(index);
+		(written ? s_captureStats.written : s_captureStats.dropped)++;
+		s_captureStats.queued = (uint)s_queuedFrames.size();
+	}
+}
+
+/* Takes a free frame for the render thread to fill, or drops the frame
+   when the writer is behind */
+static CapturedFrame *acquireFrame(uint &index)
+{
+	std::lock_guard<std::mutex> lock(s_captureMutex);
+	if (s_freeFrames.empty())
+	{
+		s_captureStats.dropped++;
+		return nullptr;
+	}
+
+	index = s_freeFrames.back();
+	s_freeFrames.pop_back();
+	return &s_captureFrames[index];
+}
+
+/* Hands a filled frame to the writer */
+static void queueFrame(uint index)
+{
+	{
+		std::lock_guard<std::mutex> lock(s_captureMutex);
+		s_queuedFrames.push_back(index);
+		s_captureStats.queued = (uint)s_queuedFrames.size();
+		s_captureStats.peakQueued = std::max(s_captureStats.peakQueued, s_captureStats.queued);
+	}
+
+	s_captureWake.notify_one();
+}
+
+/* Copies the oldest readbacks that are done out of their pack buffers.
+   When waiting, every readback is copied however long it takes. */
+static void collectReadbacks(bool wait)
+{
+	size_t rowSize = (size_t)s_captureWidth * sizeof(Color);
+
+	while (!s_pendingReads.empty())
+	{
+		uint slot = s_pendingReads.front();
+		GLenum status = glClientWaitSync(s_packFences[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+										 wait ? 1000000000 : 0);
+		if (status == GL_TIMEOUT_EXPIRED && !wait) break;
+
+		s_pendingReads.pop_front();
+		glDeleteSync(s_packFences[slot]);
+		s_packFences[slot] = nullptr;
+
+		uint index;
+		CapturedFrame *frame = acquireFrame(index);
+		if (!frame) continue;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, s_packBuffers[slot]);
+		auto mapped = static_cast<const unsigned char *>(glMapBufferRange(
+			GL_PIXEL_PACK_BUFFER, 0, rowSize * s_captureHeight, GL_MAP_READ_BIT));
+
+		if (mapped)
+		{
+			// OpenGL reads bottom row first
+			for (uint y = 0; y < s_captureHeight; y++)
+				memcpy(&frame->pixels[(size_t)y * s_captureWidth],
+					   mapped + (s_captureHeight - y - 1) * rowSize, rowSize);
+
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		frame->number = s_packNumbers[slot];
+
+		if (mapped)
+			queueFrame(index);
+		else
+		{
+			std::lock_guard<std::mutex> lock(s_captureMutex);
+			s_freeFrames.push_back(index);
+			s_captureStats.dropped++;
+		}
+	}
+}
+
+/* Allocates the frames and pack buffers once the frame size is known */
+static void beginCaptureFrames(uint width, uint height)
+{
+	s_captureWidth = width;
+	s_captureHeight = height;
+
+	std::lock_guard<std::mutex> lock(s_captureMutex);
+	for (auto &frame : s_captureFrames)
+		frame.pixels.assign((size_t)width * height, {0, 0, 0});
+
+	if (IsHeadless()) return;
+
+	size_t size = (size_t)width * height * sizeof(Color);
+	glGenBuffers(s_captureRingSize, s_packBuffers);
+	for (uint i = 0; i < s_captureRingSize; i++)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, s_packBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/* Starts the writer for a requested capture */
+static void beginCapture(CaptureRequest &request)
+{
+	s_capturePath = std::move(request.path);
+	s_captureFormat = request.format;
+	s_captureRate = request.frameRate;
+	s_captureFile = request.file;
+	s_captureWidth = s_captureHeight = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(s_captureMutex);
+		s_captureFrames.assign(request.queueFrames, {});
+		s_freeFrames.clear();
+		for (uint i = 0; i < request.queueFrames; i++)
+			s_freeFrames.push_back(i);
+
+		s_queuedFrames.clear();
+		s_captureStopping = false;
+		s_captureStats = {};
+		s_captureStats.capacity = request.queueFrames;
+	}
+
+	s_pendingReads.clear();
+	s_nextPackBuffer = 0;
+
+	s_captureThread = std::thread(captureLoop);
+}
+
+/* Finishes the readbacks in flight, waits for the writer to write every
+   queued frame and closes the output */
+static void endCapture()
+{
+	if (!IsHeadless() && s_captureWidth != 0 && s_captureHeight != 0)
+	{
+		collectReadbacks(true);
+		glDeleteBuffers(s_captureRingSize, s_packBuffers);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(s_captureMutex);
+		s_captureStopping = true;
+	}
+
+	s_captureWake.notify_one();
+	s_captureThread.join();
+
+	if (s_captureFile)
+	{
+		if (fclose(s_captureFile) != 0)
+			Error("Failed to write a captured frame!");
+		s_captureFile = nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(s_captureMutex);
+	s_captureFrames.clear();
+}
+
+/* Stops and starts captures as asked for since the last frame */
+static void applyCaptureRequests()
+{
+	if (!s_captureRequested) return;
+
+	std::unique_lock<std::mutex> lock(s_captureRequestMutex);
+	bool start = s_startRequested, stop = s_stopRequested && s_capturing;
+	CaptureRequest request = std::move(s_captureRequest);
+	s_startRequested = s_stopRequested = false;
+	s_captureRequested = false;
+
+	// Flipped before unlocking so a stop asked for meanwhile isn't lost
+	if (stop) s_capturing = false;
+	if (start) s_capturing = true;
+	lock.unlock();
+
+	if (stop) endCapture();
+	if (start) beginCapture(request);
+}
+
+/* Snapshots the finished frame before it is presented. OpenGL frames
+   are read back asynchronously and copied a few frames later, frames
+   rendered in software are copied right away. Frames are dropped
+   instead of waiting whenever the readbacks or the writer fall behind. */
+auto CaptureFrame() -> void
+{
+	applyCaptureRequests();
+	if (!s_capturing) return;
+	ProfileScope zone(CoreZone::Capture);
+
+	uint64_t number = GetFrameCount();
+	{
+		std::lock_guard<std::mutex> lock(s_captureMutex);
+		s_captureStats.frames++;
+	}
+
+	if (IsHeadless())
+	{
+		uint width = 0, height = 0;
+		const Color *pixels = GetSoftwareFramebuffer(&width, &height);
+		if (s_captureWidth == 0)
+			beginCaptureFrames(width, height);
+
+		uint index;
+		CapturedFrame *frame = nullptr;
+		if (width == s_captureWidth && height == s_captureHeight)
+			frame = acquireFrame(index);
+		else
+		{
+			std::lock_guard<std::mutex> lock(s_captureMutex);
+			s_captureStats.dropped++;
+		}
+
+		if (!frame) return;
+		std::copy(pixels, pixels + frame->pixels.size(), frame->pixels.data());
+		frame->number = number;
+		queueFrame(index);
+		return;
+	}
+
+	if (s_captureWidth == 0)
+	{
+		int viewport[4] = {0};
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		beginCaptureFrames((uint)(viewport[0] + viewport[2]),
+						   (uint)(viewport[1] + viewport[3]));
+	}
+
+	if (s_captureWidth == 0 || s_captureHeight == 0)
+	{
+		std::lock_guard<std::mutex> lock(s_captureMutex);
+		s_captureStats.dropped++;
+		return;
+	}
+
+	collectReadbacks(false);
+
+	// Every pack buffer is still being read into
+	if (s_pendingReads.size() == s_captureRingSize)
+	{
+		std::lock_guard<std::mutex> lock(s_captureMutex);
+		s_captureStats.dropped++;
+		return;
+	}
+
+	uint slot = s_nextPackBuffer;
+	s_nextPackBuffer = (s_nextPackBuffer + 1) % s_captureRingSize;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s_packBuffers[slot]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, s_captureWidth, s_captureHeight, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	s_packFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	s_packNumbers[slot] = number;
+	s_pendingReads.push_back(slot);
+}
+
+/* Starts capturing every presented frame to disk on a writer thread.
+   Y4M and Delta stream into one file at the path, PPM writes a file per
+   frame named with the path followed by the frame number. Up to
+   queueFrames frames wait for the writer before frames are dropped.
+   Safe from any thread, the capture begins with the next frame. */
+auto StartCapture(const char *path, CaptureFormat format, uint frameRate,
+				  uint queueFrames) -> bool
+{
+	// Errors are reported outside the lock, the callback may ask again
+	if (IsCapturing())
+	{
+		Error("A capture is already running!");
+		return false;
+	}
+
+	if (!path || (uint)format > (uint)CaptureFormat::Delta)
+	{
+		Error("Invalid capture path or format!");
+		return false;
+	}
+
+	FILE *file = nullptr;
+	if (format != CaptureFormat::PPM)
+	{
+		file = fopen(path, "wb");
+		if (!file)
+		{
+			Error("Failed to open capture output file!");
+			return false;
+		}
+
+		setvbuf(file, nullptr, _IOFBF, s_captureFileBuffer);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(s_captureRequestMutex);
+		bool running = s_startRequested || (s_capturing && !s_stopRequested);
+		if (!running)
+		{
+			s_captureRequest = {path, format, frameRate == 0 ? 60 : frameRate,
+								queueFrames == 0 ? s_defaultCaptureFrames : queueFrames, file};
+			s_startRequested = true;
+			s_captureRequested = true;
+			return true;
+		}
+	}
+
+	// Another thread started one in the meantime
+	if (file) fclose(file);
+	Error("A capture is already running!");
+	return false;
+}
+
+/* Stops the capture before the next frame, once the frames still waiting
+   are written and the output is closed. Safe from any thread. */
+auto StopCapture() -> void
+{
+	std::lock_guard<std::mutex> lock(s_captureRequestMutex);
+	if (s_startRequested)
+	{
+		if (s_captureRequest.file) fclose(s_captureRequest.file);
+		s_captureRequest = {};
+		s_startRequested = false;
+	}
+
+	if (s_capturing)
+	{
+		s_stopRequested = true;
+		s_captureRequested = true;
+	}
+}
+
+/* Stops any capture right away and drops one that never started. Call
+   it on the render thread once it stops rendering. */
+auto FinishCapture() -> void
+{
+	StopCapture();
+	applyCaptureRequests();
+}
+
+/* Whether presented frames are being captured, or will be from the
+   next frame on */
+auto IsCapturing() -> bool
+{
+	std::lock_guard<std::mutex> lock(s_captureRequestMutex);
+	return s_startRequested || (s_capturing && !s_stopRequested);
+}
+
+/* Returns the frames captured, written and dropped so far, kept after
+   the capture stops */
+auto GetCaptureStats() -> CaptureStats
+{
+	std::lock_guard<std::mutex> lock(s_captureMutex);
+	return s_captureStats;
+}
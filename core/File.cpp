@@ -0,0 +1,91 @@
+#include "SzarkCore.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Maps a whole file read-only into memory, pages are only read from
+   disk once they are touched */
+auto MapFile(const char *path, MappedFile &file) -> bool
+{
+	file = {nullptr, 0, nullptr, nullptr};
+	if (!path) return false;
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+								OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY,
+										0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(handle);
+		return false;
+	}
+
+	file = {static_cast<const unsigned char *>(data), (size_t)size.QuadPart,
+			handle, mapping};
+#else
+	int handle = open(path, O_RDONLY);
+	if (handle < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(handle, &info) != 0 || info.st_size == 0)
+	{
+		close(handle);
+		return false;
+	}
+
+	auto data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, handle, 0);
+	close(handle);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	madvise(data, info.st_size, MADV_SEQUENTIAL);
+	file = {static_cast<const unsigned char *>(data), (size_t)info.st_size,
+			nullptr, nullptr};
+#endif
+
+	return true;
+}
+
+/* Unmaps a file mapped with MapFile */
+auto UnmapFile(MappedFile &file) -> void
+{
+	if (!file.data) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(file.data);
+	CloseHandle(file.mapping);
+	CloseHandle(file.handle);
+#else
+	munmap(const_cast<unsigned char *>(file.data), file.size);
+#endif
+
+	file = {nullptr, 0, nullptr, nullptr};
+}
\ No newline at end of file
@@ -0,0 +1,1014 @@
+#include "SzarkCore.h"
+
+#include <cstring>
+
+// Images with fewer pixels than this are decoded on the calling thread
+static const uint64_t s_parallelImagePixels = 64 * 1024;
+
+// Rows converted by each job, enough to outweigh handing out the job
+static const uint s_imageRowsPerJob = 32;
+
+// Fast Huffman lookups cover codes up to this many bits
+static const int s_inflateFastBits = 10;
+
+enum class ImageType
+{
+	Unknown,
+	Bitmap,
+	Targa,
+	Png,
+};
+
+template <typename T>
+static T readLE(const unsigned char *data)
+{
+	T value = 0;
+	for (size_t i = 0; i < sizeof(T); i++)
+		value |= (T)data[i] << (i * 8);
+	return value;
+}
+
+static uint readBE32(const unsigned char *data)
+{
+	return (uint)data[0] << 24 | (uint)data[1] << 16 |
+		   (uint)data[2] << 8 | (uint)data[3];
+}
+
+/* Runs a callback for every row, spread over the job system when the
+   image is large enough for that to pay off */
+static void forEachRow(uint width, uint height, const std::function<void(uint)> &row)
+{
+	if ((uint64_t)width * height < s_parallelImagePixels)
+	{
+		for (uint y = 0; y < height; y++)
+			row(y);
+		return;
+	}
+
+	uint jobs = (height + s_imageRowsPerJob - 1) / s_imageRowsPerJob;
+	RunJobs(jobs, [&](uint job, uint) {
+		uint end = std::min(height, (job + 1) * s_imageRowsPerJob);
+		for (uint y = job * s_imageRowsPerJob; y < end; y++)
+			row(y);
+	});
+}
+
+/* Tells the format of an image from its first bytes. TGA has no magic
+   number, so anything with a sane TGA header is taken as one. */
+static ImageType detectImage(const unsigned char *data, uint64_t size)
+{
+	static const unsigned char pngSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+	if (size >= 8 && memcmp(data, pngSignature, 8) == 0)
+		return ImageType::Png;
+	if (size >= 54 && data[0] == 'B' && data[1] == 'M')
+		return ImageType::Bitmap;
+
+	if (size >= 18 && data[1] <= 1)
+	{
+		uint type = data[2], bpp = data[16];
+		bool known = type == 1 || type == 2 || type == 3 ||
+					 type == 9 || type == 10 || type == 11;
+		if (known && (bpp == 8 || bpp == 15 || bpp == 16 || bpp == 24 || bpp == 32))
+			return ImageType::Targa;
+	}
+
+	return ImageType::Unknown;
+}
+
+// ---------------------------------------------------------------- BMP
+
+struct BitmapInfo
+{
+	uint width, height, bpp;
+	bool topDown;
+	uint64_t pixelOffset, stride;
+	uint masks[3];
+	const unsigned char *palette;
+	uint paletteSize;
+};
+
+static bool readBitmapInfo(const unsigned char *data, uint64_t size, BitmapInfo &info)
+{
+	uint dibSize = readLE<uint>(data + 14);
+	if (dibSize < 40 || 14 + (uint64_t)dibSize > size)
+		return false;
+
+	int width = (int)readLE<uint>(data + 18);
+	int height = (int)readLE<uint>(data + 22);
+	uint compression = readLE<uint>(data + 30);
+	info.bpp = readLE<uint16_t>(data + 28);
+
+	if (width <= 0 || height == 0 || height == INT32_MIN)
+		return false;
+
+	info.width = (uint)width;
+	info.height = (uint)std::abs(height);
+	info.topDown = height < 0;
+	info.pixelOffset = readLE<uint>(data + 10);
+	info.stride = ((uint64_t)info.width * info.bpp + 31) / 32 * 4;
+
+	// Bit fields replace the default BGRX layout of 32 bit pixels
+	info.masks[0] = 0xff0000, info.masks[1] = 0xff00, info.masks[2] = 0xff;
+	if (compression == 3 && info.bpp == 32 && size >= 66)
+		for (int i = 0; i < 3; i++)
+			info.masks[i] = readLE<uint>(data + 54 + i * 4);
+	else if (compression != 0)
+		return false;
+
+	if (info.bpp != 1 && info.bpp != 4 && info.bpp != 8 &&
+		info.bpp != 24 && info.bpp != 32)
+		return false;
+
+	// The palette follows the header as BGRX entries
+	info.palette = data + 14 + dibSize;
+	info.paletteSize = 0;
+	if (info.bpp <= 8)
+	{
+		uint used = readLE<uint>(data + 46);
+		info.paletteSize = used ? std::min(used, 1u << info.bpp) : 1u << info.bpp;
+		uint64_t end = 14 + (uint64_t)dibSize + info.paletteSize * 4;
+		if (end > size)
+			info.paletteSize = (uint)((size - 14 - dibSize) / 4);
+	}
+
+	return info.pixelOffset + info.stride * info.height <= size;
+}
+
+/* Extracts a channel through a bit mask and scales it to 8 bits */
+static unsigned char maskChannel(uint pixel, uint mask)
+{
+	if (mask == 0) return 0;
+
+	int shift = 0;
+	while (!(mask & (1u << shift))) shift++;
+
+	uint bits = 0;
+	while (shift + bits < 32 && (mask & (1u << (shift + bits)))) bits++;
+
+	uint value = (pixel & mask) >> shift;
+	return bits >= 8 ? (unsigned char)(value >> (bits - 8)) :
+					   (unsigned char)(value * 255 / ((1u << bits) - 1));
+}
+
+static void decodeBitmap(const unsigned char *data, const BitmapInfo &info, Color *pixels)
+{
+	bool standardMasks = info.masks[0] == 0xff0000 && info.masks[1] == 0xff00 &&
+						 info.masks[2] == 0xff;
+
+	forEachRow(info.width, info.height, [&](uint y) {
+		// Rows are stored bottom-up unless the height was negative
+		uint sourceRow = info.topDown ? y : info.height - 1 - y;
+		auto source = data + info.pixelOffset + sourceRow * info.stride;
+		Color *target = pixels + (uint64_t)y * info.width;
+
+		switch (info.bpp)
+		{
+		case 24:
+			for (uint x = 0; x < info.width; x++, source += 3)
+				target[x] = {source[2], source[1], source[0]};
+			break;
+
+		case 32:
+			if (standardMasks)
+			{
+				for (uint x = 0; x < info.width; x++, source += 4)
+					target[x] = {source[2], source[1], source[0]};
+				break;
+			}
+
+			for (uint x = 0; x < info.width; x++, source += 4)
+			{
+				uint pixel = readLE<uint>(source);
+				target[x] = {maskChannel(pixel, info.masks[0]),
+							 maskChannel(pixel, info.masks[1]),
+							 maskChannel(pixel, info.masks[2])};
+			}
+			break;
+
+		default:
+			// Indexed pixels are packed most significant bits first
+			for (uint x = 0; x < info.width; x++)
+			{
+				uint bit = x * info.bpp;
+				uint index = (source[bit / 8] >> (8 - info.bpp - bit % 8)) &
+							 ((1u << info.bpp) - 1);
+
+				if (index < info.paletteSize)
+				{
+					auto entry = info.palette + index * 4;
+					target[x] = {entry[2], entry[1], entry[0]};
+				}
+				else
+					target[x] = {0, 0, 0};
+			}
+			break;
+		}
+	});
+}
+
+// ---------------------------------------------------------------- TGA
+
+struct TargaInfo
+{
+	uint width, height, type, bpp, pixelSize;
+	bool topDown, rightToLeft;
+	const unsigned char *palette;
+	uint paletteFirst, paletteSize, paletteEntrySize;
+	uint64_t pixelOffset;
+};
+
+static bool readTargaInfo(const unsigned char *data, uint64_t size, TargaInfo &info)
+{
+	info.type = data[2];
+	info.width = readLE<uint16_t>(data + 12);
+	info.height = readLE<uint16_t>(data + 14);
+	info.bpp = data[16];
+	info.pixelSize = (info.bpp + 7) / 8;
+	info.topDown = data[17] & 0x20;
+	info.rightToLeft = data[17] & 0x10;
+
+	info.paletteFirst = readLE<uint16_t>(data + 3);
+	info.paletteSize = data[1] ? readLE<uint16_t>(data + 5) : 0;
+	info.paletteEntrySize = (data[7] + 7) / 8;
+
+	uint64_t paletteOffset = 18 + (uint64_t)data[0];
+	info.palette = data + paletteOffset;
+	info.pixelOffset = paletteOffset + (uint64_t)info.paletteSize * info.paletteEntrySize;
+
+	uint baseType = info.type & 7;
+	if (baseType == 1 && (info.bpp != 8 || info.paletteSize == 0 ||
+						  info.paletteEntrySize < 2))
+		return false;
+	if (baseType == 3 && info.bpp != 8)
+		return false;
+	if (baseType == 2 && info.bpp != 15 && info.bpp != 16 && info.bpp != 24 &&
+		info.bpp != 32)
+		return false;
+
+	if (info.width == 0 || info.height == 0 || info.pixelOffset > size)
+		return false;
+
+	// RLE data is checked while it is decoded
+	if (info.type < 8)
+		return info.pixelOffset + (uint64_t)info.width * info.height * info.pixelSize <= size;
+	return true;
+}
+
+static Color targaPixel(const TargaInfo &info, const unsigned char *source)
+{
+	uint baseType = info.type & 7;
+
+	if (baseType == 3)
+		return {source[0], source[0], source[0]};
+
+	if (baseType == 1)
+	{
+		if (source[0] < info.paletteFirst) return {0, 0, 0};
+
+		uint index = source[0] - info.paletteFirst;
+		if (index >= info.paletteSize) return {0, 0, 0};
+
+		source = info.palette + index * info.paletteEntrySize;
+		if (info.paletteEntrySize == 2)
+		{
+			uint value = readLE<uint16_t>(source);
+			return {(unsigned char)((value >> 10 & 31) * 255 / 31),
+					(unsigned char)((value >> 5 & 31) * 255 / 31),
+					(unsigned char)((value & 31) * 255 / 31)};
+		}
+		return {source[2], source[1], source[0]};
+	}
+
+	// 15 and 16 bit pixels are ARRRRRGG GGGBBBBB
+	if (info.pixelSize == 2)
+	{
+		uint value = readLE<uint16_t>(source);
+		return {(unsigned char)((value >> 10 & 31) * 255 / 31),
+				(unsigned char)((value >> 5 & 31) * 255 / 31),
+				(unsigned char)((value & 31) * 255 / 31)};
+	}
+
+	return {source[2], source[1], source[0]};
+}
+
+static bool decodeTarga(const unsigned char *data, uint64_t size,
+						const TargaInfo &info, Color *pixels)
+{
+	auto target = [&](uint64_t index) -> Color & {
+		uint x = (uint)(index % info.width), y = (uint)(index / info.width);
+		if (!info.topDown) y = info.height - 1 - y;
+		if (info.rightToLeft) x = info.width - 1 - x;
+		return pixels[(uint64_t)y * info.width + x];
+	};
+
+	if (info.type < 8)
+	{
+		forEachRow(info.width, info.height, [&](uint row) {
+			auto source = data + info.pixelOffset +
+						  (uint64_t)row * info.width * info.pixelSize;
+			uint64_t first = (uint64_t)row * info.width;
+
+			for (uint x = 0; x < info.width; x++, source += info.pixelSize)
+				target(first + x) = targaPixel(info, source);
+		});
+		return true;
+	}
+
+	// Packets may run across rows, so RLE is decoded in one pass
+	uint64_t count = (uint64_t)info.width * info.height;
+	uint64_t offset = info.pixelOffset;
+
+	for (uint64_t index = 0; index < count;)
+	{
+		if (offset >= size) return false;
+
+		uint header = data[offset++];
+		uint length = std::min<uint64_t>((header & 0x7f) + 1, count - index);
+		bool repeated = header & 0x80;
+
+		uint64_t bytes = repeated ? info.pixelSize : (uint64_t)length * info.pixelSize;
+		if (offset + bytes > size) return false;
+
+		for (uint i = 0; i < length; i++)
+			target(index + i) = targaPixel(info, data + offset +
+										   (repeated ? 0 : i * info.pixelSize));
+
+		offset += bytes;
+		index += length;
+	}
+
+	return true;
+}
+
+// ------------------------------------------------------------- Inflate
+
+/* Canonical Huffman code, with a table that resolves short codes in a
+   single lookup. Each fast entry is the symbol and the code length << 9. */
+struct Huffman
+{
+	uint16_t counts[16];
+	uint16_t symbols[320];
+	uint16_t fast[1 << s_inflateFastBits];
+};
+
+struct Inflater
+{
+	const unsigned char *data;
+	size_t size, position;
+	uint64_t bits;
+	int bitCount;
+
+	unsigned char *out;
+	size_t outSize, written;
+};
+
+static bool buildHuffman(Huffman &code, const unsigned char *lengths, uint count)
+{
+	memset(code.counts, 0, sizeof(code.counts));
+	memset(code.fast, 0, sizeof(code.fast));
+
+	for (uint i = 0; i < count; i++)
+		code.counts[lengths[i]]++;
+	code.counts[0] = 0;
+
+	// Codes may be incomplete, but never over-subscribed
+	int left = 1;
+	for (int length = 1; length < 16; length++)
+	{
+		left = (left << 1) - code.counts[length];
+		if (left < 0) return false;
+	}
+
+	uint16_t offsets[16] = {0};
+	for (int length = 1; length < 15; length++)
+		offsets[length + 1] = offsets[length] + code.counts[length];
+
+	for (uint i = 0; i < count; i++)
+		if (lengths[i])
+			code.symbols[offsets[lengths[i]]++] = (uint16_t)i;
+
+	// Deflate sends codes most significant bit first, so the table is
+	// indexed by the reversed code
+	uint value = 0, index = 0;
+	for (int length = 1; length <= s_inflateFastBits; length++)
+	{
+		for (uint i = 0; i < code.counts[length]; i++, value++, index++)
+		{
+			uint reversed = 0;
+			for (int bit = 0; bit < length; bit++)
+				reversed |= (value >> bit & 1) << (length - 1 - bit);
+
+			for (uint fill = reversed; fill < (1u << s_inflateFastBits); fill += 1u << length)
+				code.fast[fill] = (uint16_t)(code.symbols[index] | length << 9);
+		}
+		value <<= 1;
+	}
+
+	return true;
+}
+
+static void refill(Inflater &state)
+{
+	while (state.bitCount <= 56 && state.position < state.size)
+	{
+		state.bits |= (uint64_t)state.data[state.position++] << state.bitCount;
+		state.bitCount += 8;
+	}
+}
+
+static bool readBits(Inflater &state, int count, uint &value)
+{
+	refill(state);
+	if (state.bitCount < count) return false;
+
+	value = (uint)(state.bits & ((1ull << count) - 1));
+	state.bits >>= count;
+	state.bitCount -= count;
+	return true;
+}
+
+static int decodeSymbol(Inflater &state, const Huffman &code)
+{
+	refill(state);
+
+	uint entry = code.fast[state.bits & ((1u << s_inflateFastBits) - 1)];
+	if (entry)
+	{
+		int length = entry >> 9;
+		if (length > state.bitCount) return -1;
+
+		state.bits >>= length;
+		state.bitCount -= length;
+		return entry & 511;
+	}
+
+	// Longer codes are walked one bit at a time
+	int value = 0, first = 0, index = 0;
+	for (int length = 1; length < 16 && length <= state.bitCount; length++)
+	{
+		value |= (int)(state.bits >> (length - 1) & 1);
+		int count = code.counts[length];
+
+		if (value - count < first)
+		{
+			state.bits >>= length;
+			state.bitCount -= length;
+			return code.symbols[index + value - first];
+		}
+
+		index += count;
+		first = (first + count) << 1;
+		value <<= 1;
+	}
+
+	return -1;
+}
+
+static bool inflateBlock(Inflater &state, const Huffman &literals, const Huffman &distances)
+{
+	static const uint16_t lengthBase[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+	static const unsigned char lengthExtra[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	static const uint16_t distanceBase[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+		8193, 12289, 16385, 24577};
+	static const unsigned char distanceExtra[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+	while (true)
+	{
+		int symbol = decodeSymbol(state, literals);
+		if (symbol < 0) return false;
+
+		if (symbol < 256)
+		{
+			if (state.written >= state.outSize) return false;
+			state.out[state.written++] = (unsigned char)symbol;
+			continue;
+		}
+
+		if (symbol == 256) return true;
+
+		symbol -= 257;
+		if (symbol >= 29) return false;
+
+		uint extra = 0;
+		if (!readBits(state, lengthExtra[symbol], extra)) return false;
+		size_t length = lengthBase[symbol] + extra;
+
+		int distanceSymbol = decodeSymbol(state, distances);
+		if (distanceSymbol < 0 || distanceSymbol >= 30) return false;
+		if (!readBits(state, distanceExtra[distanceSymbol], extra)) return false;
+		size_t distance = distanceBase[distanceSymbol] + extra;
+
+		if (distance > state.written || length > state.outSize - state.written)
+			return false;
+
+		unsigned char *target = state.out + state.written;
+		const unsigned char *source = target - distance;
+
+		// Overlapping copies repeat the last bytes, so they go one at a time
+		if (distance >= length)
+			memcpy(target, source, length);
+		else
+			for (size_t i = 0; i < length; i++)
+				target[i] = source[i];
+
+		state.written += length;
+	}
+}
+
+static bool inflateDynamic(Inflater &state, Huffman &literals, Huffman &distances)
+{
+	static const unsigned char order[19] = {
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+	uint literalCount, distanceCount, lengthCount;
+	if (!readBits(state, 5, literalCount) || !readBits(state, 5, distanceCount) ||
+		!readBits(state, 4, lengthCount))
+		return false;
+
+	literalCount += 257, distanceCount += 1, lengthCount += 4;
+	if (literalCount > 286 || distanceCount > 30) return false;
+
+	unsigned char lengths[320] = {0};
+	for (uint i = 0; i < lengthCount; i++)
+	{
+		uint length;
+		if (!readBits(state, 3, length)) return false;
+		lengths[order[i]] = (unsigned char)length;
+	}
+
+	Huffman lengthCode;
+	if (!buildHuffman(lengthCode, lengths, 19)) return false;
+
+	memset(lengths, 0, sizeof(lengths));
+	for (uint i = 0; i < literalCount + distanceCount;)
+	{
+		int symbol = decodeSymbol(state, lengthCode);
+		if (symbol < 0) return false;
+
+		if (symbol < 16)
+		{
+			lengths[i++] = (unsigned char)symbol;
+			continue;
+		}
+
+		uint repeat, value = 0;
+		if (symbol == 16)
+		{
+			if (i == 0 || !readBits(state, 2, repeat)) return false;
+			value = lengths[i - 1];
+			repeat += 3;
+		}
+		else if (symbol == 17)
+		{
+			if (!readBits(state, 3, repeat)) return false;
+			repeat += 3;
+		}
+		else
+		{
+			if (!readBits(state, 7, repeat)) return false;
+			repeat += 11;
+		}
+
+		if (i + repeat > literalCount + distanceCount) return false;
+		while (repeat--)
+			lengths[i++] = (unsigned char)value;
+	}
+
+	return lengths[256] != 0 &&
+		   buildHuffman(literals, lengths, literalCount) &&
+		   buildHuffman(distances, lengths + literalCount, distanceCount);
+}
+
+/* Decompresses a zlib stream into a buffer of exactly the expected size */
+static bool inflateZlib(const unsigned char *data, size_t size,
+						unsigned char *out, size_t outSize)
+{
+	if (size < 2 || (data[0] & 15) != 8 || (data[0] << 8 | data[1]) % 31 != 0 ||
+		(data[1] & 0x20))
+		return false;
+
+	Inflater state = {data, size, 2, 0, 0, out, outSize, 0};
+
+	// Only the fixed codes are the same every time, build them once
+	static const struct FixedCodes
+	{
+		Huffman literals, distances;
+
+		FixedCodes()
+		{
+			unsigned char lengths[288];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			buildHuffman(literals, lengths, 288);
+
+			memset(lengths, 5, 30);
+			buildHuffman(distances, lengths, 30);
+		}
+	} fixed;
+
+	Huffman literals, distances;
+	uint last = 0;
+
+	while (!last)
+	{
+		uint type;
+		if (!readBits(state, 1, last) || !readBits(state, 2, type))
+			return false;
+
+		if (type == 0)
+		{
+			// Stored blocks start on a byte boundary after the header
+			state.position -= state.bitCount / 8;
+			state.bits = 0, state.bitCount = 0;
+
+			if (state.position + 4 > size) return false;
+			uint length = readLE<uint16_t>(data + state.position);
+			uint inverse = readLE<uint16_t>(data + state.position + 2);
+			state.position += 4;
+
+			if ((length ^ 0xffff) != inverse || state.position + length > size ||
+				length > outSize - state.written)
+				return false;
+
+			memcpy(out + state.written, data + state.position, length);
+			state.position += length;
+			state.written += length;
+		}
+		else if (type == 1)
+		{
+			if (!inflateBlock(state, fixed.literals, fixed.distances))
+				return false;
+		}
+		else if (type == 2)
+		{
+			if (!inflateDynamic(state, literals, distances) ||
+				!inflateBlock(state, literals, distances))
+				return false;
+		}
+		else
+			return false;
+	}
+
+	return state.written == outSize;
+}
+
+// ---------------------------------------------------------------- PNG
+
+struct PngInfo
+{
+	uint width, height, depth, colorType, channels;
+	bool interlaced;
+	const unsigned char *palette;
+	uint paletteSize;
+	std::vector<std::pair<const unsigned char *, uint>> chunks;
+};
+
+static bool readPngInfo(const unsigned char *data, uint64_t size, PngInfo &info)
+{
+	info = {};
+
+	for (uint64_t offset = 8; offset + 12 <= size;)
+	{
+		uint length = readBE32(data + offset);
+		auto type = data + offset + 4;
+		auto body = data + offset + 8;
+		if (offset + 12 + (uint64_t)length > size) return false;
+
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+		{
+			info.width = readBE32(body);
+			info.height = readBE32(body + 4);
+			info.depth = body[8];
+			info.colorType = body[9];
+			info.interlaced = body[12] == 1;
+
+			if (body[10] != 0 || body[11] != 0 || body[12] > 1)
+				return false;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			info.palette = body;
+			info.paletteSize = length / 3;
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+			info.chunks.push_back({body, length});
+		else if (memcmp(type, "IEND", 4) == 0)
+			break;
+
+		offset += 12 + (uint64_t)length;
+	}
+
+	switch (info.colorType)
+	{
+	case 0: info.channels = 1; break;
+	case 2: info.channels = 3; break;
+	case 3: info.channels = 1; break;
+	case 4: info.channels = 2; break;
+	case 6: info.channels = 4; break;
+	default: return false;
+	}
+
+	bool validDepth = info.colorType == 0 ?
+		(info.depth == 1 || info.depth == 2 || info.depth == 4 ||
+		 info.depth == 8 || info.depth == 16) :
+		info.colorType == 3 ?
+		(info.depth == 1 || info.depth == 2 || info.depth == 4 || info.depth == 8) :
+		(info.depth == 8 || info.depth == 16);
+
+	return validDepth && info.width > 0 && info.height > 0 &&
+		   info.width < (1u << 24) && info.height < (1u << 24) &&
+		   !info.chunks.empty() && (info.colorType != 3 || info.palette);
+}
+
+static uint64_t pngRowBytes(const PngInfo &info, uint width)
+{
+	return ((uint64_t)width * info.channels * info.depth + 7) / 8;
+}
+
+/* Reverses the filter of each row in place. Every row depends on the
+   one above, so this part can't be split up. */
+static bool unfilterPng(unsigned char *data, uint64_t rowBytes, uint rows, uint pixelBytes)
+{
+	unsigned char *previous = nullptr;
+
+	for (uint y = 0; y < rows; y++)
+	{
+		unsigned char filter = data[0];
+		unsigned char *row = data + 1;
+
+		switch (filter)
+		{
+		case 0:
+			break;
+
+		case 1:
+			for (uint64_t i = pixelBytes; i < rowBytes; i++)
+				row[i] += row[i - pixelBytes];
+			break;
+
+		case 2:
+			if (previous)
+				for (uint64_t i = 0; i < rowBytes; i++)
+					row[i] += previous[i];
+			break;
+
+		case 3:
+			for (uint64_t i = 0; i < rowBytes; i++)
+			{
+				uint left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+				uint up = previous ? previous[i] : 0;
+				row[i] += (unsigned char)((left + up) / 2);
+			}
+			break;
+
+		case 4:
+			for (uint64_t i = 0; i < rowBytes; i++)
+			{
+				int a = i >= pixelBytes ? row[i - pixelBytes] : 0;
+				int b = previous ? previous[i] : 0;
+				int c = previous && i >= pixelBytes ? previous[i - pixelBytes] : 0;
+
+				int p = a + b - c;
+				int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+				row[i] += (unsigned char)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+			}
+			break;
+
+		default:
+			return false;
+		}
+
+		previous = row;
+		data += rowBytes + 1;
+	}
+
+	return true;
+}
+
+/* Reads one sample of a pixel scaled to 8 bits. 16 bit samples keep
+   their high byte and low bit depths are stretched over 0 to 255. */
+static uint pngSample(const PngInfo &info, const unsigned char *row, uint x, uint channel)
+{
+	if (info.depth == 8)
+		return row[x * info.channels + channel];
+	if (info.depth == 16)
+		return row[(x * info.channels + channel) * 2];
+
+	uint bit = x * info.depth;
+	return (row[bit / 8] >> (8 - info.depth - bit % 8)) & ((1u << info.depth) - 1);
+}
+
+static Color pngPixel(const PngInfo &info, const unsigned char *row, uint x)
+{
+	switch (info.colorType)
+	{
+	case 3:
+	{
+		uint index = pngSample(info, row, x, 0);
+		if (index >= info.paletteSize) return {0, 0, 0};
+		auto entry = info.palette + index * 3;
+		return {entry[0], entry[1], entry[2]};
+	}
+
+	case 0:
+	case 4:
+	{
+		uint value = pngSample(info, row, x, 0);
+		if (info.depth < 8) value = value * 255 / ((1u << info.depth) - 1);
+		return {(unsigned char)value, (unsigned char)value, (unsigned char)value};
+	}
+
+	default:
+		return {(unsigned char)pngSample(info, row, x, 0),
+				(unsigned char)pngSample(info, row, x, 1),
+				(unsigned char)pngSample(info, row, x, 2)};
+	}
+}
+
+static bool decodePng(PngInfo &info, Color *pixels)
+{
+	uint pixelBytes = std::max(1u, info.channels * info.depth / 8);
+
+	// Adam7 splits the image into seven smaller images
+	static const uint passes[7][4] = {
+		{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+		{0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+
+	uint64_t total = (pngRowBytes(info, info.width) + 1) * info.height;
+	if (info.interlaced)
+	{
+		total = 0;
+		for (auto &p : passes)
+		{
+			if (info.width <= p[0] || info.height <= p[1]) continue;
+
+			uint width = (info.width - p[0] + p[2] - 1) / p[2];
+			uint height = (info.height - p[1] + p[3] - 1) / p[3];
+			total += (pngRowBytes(info, width) + 1) * height;
+		}
+	}
+
+	// A single IDAT is inflated straight from the mapped file
+	std::vector<unsigned char> joined;
+	const unsigned char *compressed = info.chunks[0].first;
+	size_t compressedSize = info.chunks[0].second;
+
+	if (info.chunks.size() > 1)
+	{
+		for (auto &[chunk, length] : info.chunks)
+			joined.insert(joined.end(), chunk, chunk + length);
+		compressed = joined.data(), compressedSize = joined.size();
+	}
+
+	std::vector<unsigned char> filtered(total);
+	if (!inflateZlib(compressed, compressedSize, filtered.data(), total))
+		return false;
+
+	if (!info.interlaced)
+	{
+		uint64_t rowBytes = pngRowBytes(info, info.width);
+		if (!unfilterPng(filtered.data(), rowBytes, info.height, pixelBytes))
+			return false;
+
+		forEachRow(info.width, info.height, [&](uint y) {
+			auto row = filtered.data() + y * (rowBytes + 1) + 1;
+			Color *target = pixels + (uint64_t)y * info.width;
+			for (uint x = 0; x < info.width; x++)
+				target[x] = pngPixel(info, row, x);
+		});
+		return true;
+	}
+
+	auto data = filtered.data();
+	for (auto &p : passes)
+	{
+		if (info.width <= p[0] || info.height <= p[1]) continue;
+
+		uint width = (info.width - p[0] + p[2] - 1) / p[2];
+		uint height = (info.height - p[1] + p[3] - 1) / p[3];
+		uint64_t rowBytes = pngRowBytes(info, width);
+
+		if (!unfilterPng(data, rowBytes, height, pixelBytes))
+			return false;
+
+		for (uint y = 0; y < height; y++)
+		{
+			auto row = data + y * (rowBytes + 1) + 1;
+			Color *target = pixels + (uint64_t)(p[1] + y * p[3]) * info.width;
+			for (uint x = 0; x < width; x++)
+				target[p[0] + x * p[2]] = pngPixel(info, row, x);
+		}
+
+		data += (rowBytes + 1) * height;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------------------
+
+/* Reads the size of a BMP, TGA or PNG image in memory */
+auto ReadImageSize(const void *image, uint64_t size, uint *width, uint *height) -> bool
+{
+	auto data = static_cast<const unsigned char *>(image);
+	if (!data || !width || !height) return false;
+
+	switch (detectImage(data, size))
+	{
+	case ImageType::Bitmap:
+	{
+		BitmapInfo info;
+		if (!readBitmapInfo(data, size, info)) return false;
+		*width = info.width, *height = info.height;
+		return true;
+	}
+
+	case ImageType::Targa:
+	{
+		TargaInfo info;
+		if (!readTargaInfo(data, size, info)) return false;
+		*width = info.width, *height = info.height;
+		return true;
+	}
+
+	case ImageType::Png:
+	{
+		PngInfo info;
+		if (!readPngInfo(data, size, info)) return false;
+		*width = info.width, *height = info.height;
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+/* Decodes a BMP, TGA or PNG image in memory into width by height RGB
+   pixels, top row first. Rows are converted in parallel on the job
+   system. Alpha is dropped. */
+auto DecodeImage(const void *image, uint64_t size, Color *pixels,
+				 uint width, uint height) -> bool
+{
+	auto data = static_cast<const unsigned char *>(image);
+	uint imageWidth = 0, imageHeight = 0;
+
+	if (!pixels || !ReadImageSize(image, size, &imageWidth, &imageHeight))
+	{
+		Error("Unsupported or invalid image!");
+		return false;
+	}
+
+	if (imageWidth != width || imageHeight != height)
+	{
+		Error("Image size does not match the pixel buffer!");
+		return false;
+	}
+
+	bool decoded = false;
+	switch (detectImage(data, size))
+	{
+	case ImageType::Bitmap:
+	{
+		BitmapInfo info;
+		readBitmapInfo(data, size, info);
+		decodeBitmap(data, info, pixels);
+		decoded = true;
+		break;
+	}
+
+	case ImageType::Targa:
+	{
+		TargaInfo info;
+		readTargaInfo(data, size, info);
+		decoded = decodeTarga(data, size, info, pixels);
+		break;
+	}
+
+	case ImageType::Png:
+	{
+		PngInfo info;
+		readPngInfo(data, size, info);
+		decoded = decodePng(info, pixels);
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	if (!decoded)
+		Error("Image data is corrupt!");
+	return decoded;
+}
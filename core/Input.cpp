@@ -0,0 +1,118 @@
+#include "SzarkCore.h"
+
+#include <atomic>
+
+using InputClock = std::chrono::steady_clock;
+
+// Events waiting to be drained, newer ones are dropped while it is full
+static const uint s_inputRingSize = 4096;
+
+/* Single producer, single consumer ring. The thread polling the window
+   writes the head, the render thread draining it writes the tail. */
+struct InputRing
+{
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+	alignas(64) InputEvent events[s_inputRingSize];
+};
+
+static InputRing s_inputRing = {};
+static std::atomic<uint64_t> s_inputEvents{0};
+static std::atomic<uint64_t> s_droppedInputEvents{0};
+static const InputClock::time_point s_inputEpoch = InputClock::now();
+
+// Oldest and newest event drained since the last present, on the render thread
+static double s_oldestDrained = -1, s_newestDrained = -1;
+static std::atomic<double> s_inputLatency{0}, s_worstInputLatency{0};
+
+/* Seconds since the core was loaded, the clock of every input event */
+auto GetInputTime() -> double
+{
+	return std::chrono::duration<double>(InputClock::now() - s_inputEpoch).count();
+}
+
+/* Stamps an event and appends it to the ring */
+static void pushInputEvent(InputEventType type, int code, int action,
+						   int mods, double x, double y)
+{
+	s_inputEvents.fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t head = s_inputRing.head.load(std::memory_order_relaxed);
+	if (head - s_inputRing.tail.load(std::memory_order_acquire) >= s_inputRingSize)
+	{
+		s_droppedInputEvents.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	s_inputRing.events[head % s_inputRingSize] = {GetInputTime(), x, y, type,
+												  code, action, mods};
+	s_inputRing.head.store(head + 1, std::memory_order_release);
+}
+
+/* Records a key event for the next drain */
+auto DispatchKeyEvent(int key, int action, int mods) -> void
+{
+	pushInputEvent(InputEventType::Key, key, action, mods, 0, 0);
+}
+
+/* Records a cursor position for the next drain */
+auto DispatchCursorEvent(double x, double y) -> void
+{
+	pushInputEvent(InputEventType::Cursor, 0, 0, 0, x, y);
+}
+
+/* Records a mouse button event for the next drain */
+auto DispatchMouseEvent(int button, int action, int mods) -> void
+{
+	pushInputEvent(InputEventType::Mouse, button, action, mods, 0, 0);
+}
+
+/* Records a mouse scroll for the next drain */
+auto DispatchScrollEvent(double dx, double dy) -> void
+{
+	pushInputEvent(InputEventType::Scroll, 0, 0, 0, dx, dy);
+}
+
+/* Moves up to capacity of the oldest events into the array and returns
+   how many were moved. Call it until it returns less than capacity. */
+auto DrainInputEvents(InputEvent *events, uint capacity) -> uint
+{
+	if (!events || capacity == 0) return 0;
+
+	uint64_t tail = s_inputRing.tail.load(std::memory_order_relaxed);
+	uint64_t head = s_inputRing.head.load(std::memory_order_acquire);
+	uint count = (uint)std::min<uint64_t>(head - tail, capacity);
+	if (count == 0) return 0;
+
+	// Copied in at most two runs, the second after wrapping around
+	uint start = (uint)(tail % s_inputRingSize);
+	uint first = std::min(count, s_inputRingSize - start);
+	std::copy_n(s_inputRing.events + start, first, events);
+	std::copy_n(s_inputRing.events, count - first, events + first);
+
+	s_inputRing.tail.store(tail + count, std::memory_order_release);
+
+	if (s_oldestDrained < 0) s_oldestDrained = events[0].time;
+	s_newestDrained = events[count - 1].time;
+	return count;
+}
+
+/* Called once a frame is presented. Latency runs from the drained events
+   to the end of the swap, the display adds its own scanout on top. */
+auto PresentInputFrame() -> void
+{
+	if (s_newestDrained < 0) return;
+
+	double now = GetInputTime();
+	s_inputLatency = now - s_newestDrained;
+	s_worstInputLatency = now - s_oldestDrained;
+	s_oldestDrained = s_newestDrained = -1;
+}
+
+/* Returns the event counts and the latency of the last frame with input */
+auto GetInputStats() -> InputStats
+{
+	return {s_inputEvents.load(std::memory_order_relaxed),
+			s_droppedInputEvents.load(std::memory_order_relaxed),
+			s_inputLatency, s_worstInputLatency};
+}
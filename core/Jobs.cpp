@@ -0,0 +1,278 @@
+#include "SzarkCore.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using JobClock = std::chrono::steady_clock;
+
+/* Jobs owned by one worker. The owner pops from the back, thieves take
+   from the front so they grab the work furthest from the owner's. The
+   mutex guards the stats as well, they are read from other threads. */
+struct JobQueue
+{
+	std::mutex mutex;
+	std::deque<uint> jobs;
+	JobStats stats;
+};
+
+static std::vector<std::unique_ptr<JobQueue>> s_jobQueues;
+static std::vector<std::thread> s_jobWorkers;
+
+static std::mutex s_jobMutex;
+static std::condition_variable s_jobWake;
+static std::condition_variable s_jobDone;
+static uint64_t s_jobGeneration = 0;
+static bool s_jobShutdown = false;
+
+static const std::function<void(uint, uint)> *s_jobBatch = nullptr;
+static std::atomic<uint> s_jobsPending{0};
+static std::atomic<bool> s_dispatching{false};
+static double s_dispatchTime = 0;
+
+/* Takes a job from the worker's own queue or steals one from another */
+static bool takeJob(uint worker, uint &job)
+{
+	auto &own = *s_jobQueues[worker];
+	{
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = own.jobs.back();
+			own.jobs.pop_back();
+			return true;
+		}
+	}
+
+	uint count = (uint)s_jobQueues.size();
+	for (uint i = 1; i < count; i++)
+	{
+		auto &victim = *s_jobQueues[(worker + i) % count];
+		{
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (victim.jobs.empty()) continue;
+
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+		}
+
+		// Never held together with the victim's, two thieves would deadlock
+		std::lock_guard<std::mutex> lock(own.mutex);
+		own.stats.steals++;
+		return true;
+	}
+
+	return false;
+}
+
+/* Runs jobs until every queue is empty */
+static void drainJobs(uint worker)
+{
+	auto &own = *s_jobQueues[worker];
+	uint job = 0;
+
+	while (takeJob(worker, job))
+	{
+		auto start = JobClock::now();
+		(*s_jobBatch)(job, worker);
+		double busyTime = std::chrono::duration<double>(
+			JobClock::now() - start).count();
+
+		{
+			std::lock_guard<std::mutex> lock(own.mutex);
+			own.stats.busyTime += busyTime;
+			own.stats.jobs++;
+		}
+
+		if (--s_jobsPending == 0)
+		{
+			std::lock_guard<std::mutex> lock(s_jobMutex);
+			s_jobDone.notify_all();
+		}
+	}
+}
+
+/* Sleeps until a batch is dispatched, then helps finish it */
+static void workerLoop(uint worker)
+{
+	uint64_t seen = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(s_jobMutex);
+			s_jobWake.wait(lock, [&] {
+				return s_jobShutdown || s_jobGeneration != seen;
+			});
+
+			if (s_jobShutdown) return;
+			seen = s_jobGeneration;
+		}
+
+		drainJobs(worker);
+	}
+}
+
+/* Joins the workers when the library unloads */
+static struct JobSystemShutdown
+{
+	~JobSystemShutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(s_jobMutex);
+			s_jobShutdown = true;
+		}
+
+		s_jobWake.notify_all();
+		for (auto &thread : s_jobWorkers)
+			thread.join();
+	}
+} s_jobSystemShutdown;
+
+/* Hands a batch of jobs to every worker and waits for all of them. The
+   calling thread works as worker 0. Each worker starts with a contiguous
+   range of jobs so neighbouring jobs tend to share a core. */
+auto RunJobs(uint count, const std::function<void(uint, uint)> &batch) -> void
+{
+	if (count == 0) return;
+
+	if (s_jobQueues.empty())
+		InitializeJobSystem(0);
+
+	// Nested dispatches run inline, the workers are already busy
+	if (s_dispatching.exchange(true))
+	{
+		for (uint i = 0; i < count; i++)
+			batch(i, 0);
+		return;
+	}
+
+	auto start = JobClock::now();
+	uint workers = (uint)s_jobQueues.size();
+
+	s_jobBatch = &batch;
+	s_jobsPending = count;
+
+	for (uint w = 0; w < workers; w++)
+	{
+		uint begin = (uint)((uint64_t)count * w / workers);
+		uint end = (uint)((uint64_t)count * (w + 1) / workers);
+
+		// Pushed in reverse so the owner pops its range in order
+		std::lock_guard<std::mutex> lock(s_jobQueues[w]->mutex);
+		for (uint job = end; job > begin; job--)
+			s_jobQueues[w]->jobs.push_back(job - 1);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(s_jobMutex);
+		s_jobGeneration++;
+	}
+	s_jobWake.notify_all();
+
+	drainJobs(0);
+
+	// Barrier: jobs stolen by other workers may still be running
+	{
+		std::unique_lock<std::mutex> lock(s_jobMutex);
+		s_jobDone.wait(lock, [] { return s_jobsPending == 0; });
+	}
+
+	s_jobBatch = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(s_jobMutex);
+		s_dispatchTime += std::chrono::duration<double>(
+			JobClock::now() - start).count();
+	}
+	s_dispatching = false;
+}
+
+/* Starts the worker threads, 0 uses one worker per hardware thread.
+   The thread that dispatches jobs counts as one of the workers. */
+auto InitializeJobSystem(uint workers) -> void
+{
+	if (!s_jobQueues.empty())
+		return;
+
+	if (workers == 0)
+		workers = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (uint i = 0; i < workers; i++)
+	{
+		s_jobQueues.push_back(std::make_unique<JobQueue>());
+		s_jobQueues.back()->stats = {0};
+	}
+
+	for (uint i = 1; i < workers; i++)
+		s_jobWorkers.emplace_back(workerLoop, i);
+}
+
+/* Returns how many workers run jobs, including the dispatching thread */
+auto GetWorkerCount() -> uint { return (uint)s_jobQueues.size(); }
+
+/* Runs a callback for every index from 0 to count in parallel and
+   returns once all of them are done */
+auto DispatchJobs(uint count, void (*job)(uint index, uint worker)) -> void
+{
+	if (!job) return;
+	RunJobs(count, [job](uint index, uint worker) { job(index, worker); });
+}
+
+/* Splits a width by height area into square tiles and runs a callback
+   for each of them in parallel, returning once all tiles are done.
+   A tile size of 0 uses 64, where an RGB tile fits in L1 cache. */
+auto DispatchTiles(uint width, uint height, uint tileSize,
+				   void (*tile)(const Rect *tile, uint worker)) -> void
+{
+	if (!tile || width == 0 || height == 0) return;
+	if (tileSize == 0) tileSize = 64;
+
+	uint tilesX = (width + tileSize - 1) / tileSize;
+	uint tilesY = (height + tileSize - 1) / tileSize;
+
+	RunJobs(tilesX * tilesY, [&](uint index, uint worker) {
+		int x = (int)((index % tilesX) * tileSize);
+		int y = (int)((index / tilesX) * tileSize);
+
+		Rect rect = {x, y,
+					 (int)std::min(tileSize, width - x),
+					 (int)std::min(tileSize, height - y)};
+		tile(&rect, worker);
+	});
+}
+
+/* Copies the stats of up to count workers and returns the time spent
+   in dispatches since the last reset. Busy time summed over workers
+   divided by that time is how many cores were used on average. */
+auto GetJobStats(JobStats *stats, uint count) -> double
+{
+	if (stats)
+	{
+		count = std::min(count, (uint)s_jobQueues.size());
+		for (uint i = 0; i < count; i++)
+		{
+			std::lock_guard<std::mutex> lock(s_jobQueues[i]->mutex);
+			stats[i] = s_jobQueues[i]->stats;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(s_jobMutex);
+	return s_dispatchTime;
+}
+
+/* Clears the stats of every worker */
+auto ResetJobStats() -> void
+{
+	for (auto &queue : s_jobQueues)
+	{
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		queue->stats = {0};
+	}
+
+	std::lock_guard<std::mutex> lock(s_jobMutex);
+	s_dispatchTime = 0;
+}
\ No newline at end of file
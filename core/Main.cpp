@@ -12,5 +12,7 @@ auto SetErrorCallback(void(*callback)(const char* m)) -> void {
 	if (callback) s_errorCallback = callback;
 }
 
-/* Empty main to compile library */
-int main() { }
\ No newline at end of file
+#ifndef SZARK_BENCHMARK
+/* Empty main to compile library, the benchmark brings its own */
+int main() { }
+#endif
\ No newline at end of file
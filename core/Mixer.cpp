@@ -0,0 +1,410 @@
+#include "SzarkCore.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SZARK_SSE2
+#endif
+
+static const uint s_mixRate = 44100;
+static const uint s_mixBlockFrames = 512;
+static const uint s_mixBufferCount = 4;
+
+/* Samples of a sound resampled to the mix rate, right is empty for mono */
+struct Sound
+{
+	std::vector<float> left, right;
+};
+
+struct Voice
+{
+	uint sound, generation;
+	size_t position;
+	uint64_t started;
+	float gainLeft, gainRight;
+	int priority;
+	bool active;
+};
+
+static std::mutex s_mixerMutex;
+static std::unordered_map<uint, Sound> s_sounds;
+static uint s_nextSoundID = 1;
+static std::vector<Voice> s_voices;
+static uint64_t s_voicesStarted = 0;
+
+static uint s_mixerSource = 0;
+static uint s_mixerBuffers[s_mixBufferCount];
+static std::thread s_mixerThread;
+static std::atomic<bool> s_mixerRunning{false};
+
+static MixerStats s_mixerStats = {0};
+
+// Accumulators for one block, kept around between blocks
+alignas(16) static float s_mixLeft[s_mixBlockFrames];
+alignas(16) static float s_mixRight[s_mixBlockFrames];
+alignas(16) static int16_t s_mixOutput[s_mixBlockFrames * 2];
+
+/* Handles pack the voice index with its generation so stale handles
+   from a stolen voice can't touch the sound that replaced it */
+static uint voiceHandle(uint index) { return (s_voices[index].generation << 8) | index; }
+
+static Voice *findVoice(uint handle)
+{
+	uint index = handle & 0xFF;
+	if (handle == 0 || index >= s_voices.size()) return nullptr;
+
+	auto &voice = s_voices[index];
+	return voice.active && voiceHandle(index) == handle ? &voice : nullptr;
+}
+
+/* Constant power panning from -1 (left) to 1 (right) */
+static void setGain(Voice &voice, float volume, float pan)
+{
+	float angle = (std::clamp(pan, -1.0f, 1.0f) + 1.0f) * 0.785398f;
+	voice.gainLeft = volume * std::cos(angle);
+	voice.gainRight = volume * std::sin(angle);
+}
+
+/* Adds gain * src onto dst */
+static void mixInto(float *dst, const float *src, uint count, float gain)
+{
+	uint i = 0;
+
+#ifdef SZARK_SSE2
+	__m128 g = _mm_set1_ps(gain);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 sum = _mm_add_ps(_mm_load_ps(dst + i),
+								_mm_mul_ps(_mm_loadu_ps(src + i), g));
+		_mm_store_ps(dst + i, sum);
+	}
+#endif
+
+	for (; i < count; i++)
+		dst[i] += src[i] * gain;
+}
+
+static_assert(s_mixBlockFrames % 8 == 0, "Blocks are converted 8 frames at a time");
+
+/* Converts the accumulators to interleaved 16 bit, saturating */
+static void writeOutput()
+{
+#ifdef SZARK_SSE2
+	__m128 scale = _mm_set1_ps(32767.0f);
+	for (uint i = 0; i < s_mixBlockFrames; i += 8)
+	{
+		__m128i left = _mm_packs_epi32(
+			_mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(s_mixLeft + i), scale)),
+			_mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(s_mixLeft + i + 4), scale)));
+		__m128i right = _mm_packs_epi32(
+			_mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(s_mixRight + i), scale)),
+			_mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(s_mixRight + i + 4), scale)));
+
+		auto out = reinterpret_cast<__m128i *>(s_mixOutput + i * 2);
+		_mm_store_si128(out, _mm_unpacklo_epi16(left, right));
+		_mm_store_si128(out + 1, _mm_unpackhi_epi16(left, right));
+	}
+#else
+	for (uint i = 0; i < s_mixBlockFrames; i++)
+	{
+		s_mixOutput[i * 2] = (int16_t)std::clamp(
+			std::lrint(s_mixLeft[i] * 32767.0f), -32768L, 32767L);
+		s_mixOutput[i * 2 + 1] = (int16_t)std::clamp(
+			std::lrint(s_mixRight[i] * 32767.0f), -32768L, 32767L);
+	}
+#endif
+}
+
+/* Mixes every active voice into the next block of output */
+static void mixBlock(uint buffer)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::fill(std::begin(s_mixLeft), std::end(s_mixLeft), 0.0f);
+	std::fill(std::begin(s_mixRight), std::end(s_mixRight), 0.0f);
+
+	uint active = 0;
+	{
+		std::lock_guard<std::mutex> lock(s_mixerMutex);
+
+		for (auto &voice : s_voices)
+		{
+			if (!voice.active) continue;
+
+			auto &sound = s_sounds[voice.sound];
+			size_t length = sound.left.size();
+			uint count = (uint)std::min<size_t>(s_mixBlockFrames,
+												length - voice.position);
+
+			const float *left = sound.left.data() + voice.position;
+			const float *right = sound.right.empty()
+									 ? left
+									 : sound.right.data() + voice.position;
+
+			mixInto(s_mixLeft, left, count, voice.gainLeft);
+			mixInto(s_mixRight, right, count, voice.gainRight);
+
+			voice.position += count;
+			if (voice.position >= length)
+				voice.active = false;
+			else
+				active++;
+		}
+	}
+
+	writeOutput();
+	alBufferData(buffer, AL_FORMAT_STEREO16, s_mixOutput,
+				 sizeof(s_mixOutput), s_mixRate);
+
+	double elapsed = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(s_mixerMutex);
+	s_mixerStats.peakVoices = std::max(s_mixerStats.peakVoices, active);
+	s_mixerStats.blocks++;
+	s_mixerStats.mixTime = elapsed;
+	s_mixerStats.averageMixTime +=
+		(elapsed - s_mixerStats.averageMixTime) / s_mixerStats.blocks;
+}
+
+/* Keeps the mixer source fed with freshly mixed blocks */
+static void mixerLoop()
+{
+	for (uint i = 0; i < s_mixBufferCount; i++)
+		mixBlock(s_mixerBuffers[i]);
+
+	alSourceQueueBuffers(s_mixerSource, s_mixBufferCount, s_mixerBuffers);
+	alSourcePlay(s_mixerSource);
+
+	// Poll well within one block so the queue never runs dry
+	auto interval = std::chrono::microseconds(
+		1000000 * s_mixBlockFrames / s_mixRate / 4);
+
+	while (s_mixerRunning)
+	{
+		int processed = 0;
+		alGetSourcei(s_mixerSource, AL_BUFFERS_PROCESSED, &processed);
+
+		for (int i = 0; i < processed; i++)
+		{
+			uint buffer = 0;
+			alSourceUnqueueBuffers(s_mixerSource, 1, &buffer);
+			mixBlock(buffer);
+			alSourceQueueBuffers(s_mixerSource, 1, &buffer);
+		}
+
+		int state = 0;
+		alGetSourcei(s_mixerSource, AL_SOURCE_STATE, &state);
+		if (state != AL_PLAYING)
+		{
+			std::lock_guard<std::mutex> lock(s_mixerMutex);
+			s_mixerStats.underruns++;
+			alSourcePlay(s_mixerSource);
+		}
+
+		std::this_thread::sleep_for(interval);
+	}
+}
+
+/* Joins the mixer thread when the library unloads */
+static struct MixerShutdown
+{
+	~MixerShutdown()
+	{
+		s_mixerRunning = false;
+		if (s_mixerThread.joinable())
+			s_mixerThread.join();
+	}
+} s_mixerShutdown;
+
+/* Creates the voice pool and starts mixing into one streaming source,
+   a voice count of 0 uses 64 voices. The audio context is created when
+   there is none yet. Without a device the mixer stays off and voices
+   never start. */
+auto InitializeMixer(uint voices) -> void
+{
+	if (s_mixerRunning) return;
+
+	if (!alcGetCurrentContext())
+	{
+		// Headless runs don't go looking for a device they won't hear
+		if (IsHeadless()) return;
+
+		InitializeAudioContext();
+		if (!alcGetCurrentContext()) return;
+	}
+
+	// Handles keep 8 bits for the voice index
+	if (voices == 0) voices = 64;
+	voices = std::min(voices, 255u);
+
+	s_voices.assign(voices, Voice{0, 0, 0, 0, 0, 0, 0, false});
+	s_mixerStats = {0};
+
+	alGenSources(1, &s_mixerSource);
+	alGenBuffers(s_mixBufferCount, s_mixerBuffers);
+
+	s_mixerRunning = true;
+	s_mixerThread = std::thread(mixerLoop);
+}
+
+/* Converts PCM samples to floats at the mix rate. Resampling happens
+   once here so mixing is only multiplies and adds. */
+auto CreateSound(int format, const char *buffer, uint length, uint freq) -> uint
+{
+	if (!buffer || length == 0 || freq == 0) return 0;
+
+	bool stereo = format == AL_FORMAT_STEREO8 || format == AL_FORMAT_STEREO16;
+	bool wide = format == AL_FORMAT_MONO16 || format == AL_FORMAT_STEREO16;
+	uint channels = stereo ? 2 : 1;
+	size_t frames = length / (channels * (wide ? 2 : 1));
+	if (frames == 0) return 0;
+
+	auto sample = [&](size_t frame, uint channel) -> float {
+		size_t index = frame * channels + channel;
+		if (wide)
+		{
+			auto bytes = reinterpret_cast<const unsigned char *>(buffer) + index * 2;
+			return (int16_t)(bytes[0] | bytes[1] << 8) / 32768.0f;
+		}
+		return ((unsigned char)buffer[index] - 128) / 128.0f;
+	};
+
+	Sound sound;
+	size_t resampled = (size_t)((double)frames * s_mixRate / freq);
+	sound.left.resize(resampled);
+	if (stereo) sound.right.resize(resampled);
+
+	double step = (double)freq / s_mixRate;
+	for (size_t i = 0; i < resampled; i++)
+	{
+		double position = i * step;
+		size_t frame = (size_t)position;
+		size_t next = std::min(frame + 1, frames - 1);
+		float t = (float)(position - frame);
+
+		sound.left[i] = sample(frame, 0) + (sample(next, 0) - sample(frame, 0)) * t;
+		if (stereo)
+			sound.right[i] = sample(frame, 1) + (sample(next, 1) - sample(frame, 1)) * t;
+	}
+
+	std::lock_guard<std::mutex> lock(s_mixerMutex);
+	uint id = s_nextSoundID++;
+	s_sounds[id] = std::move(sound);
+	return id;
+}
+
+/* Stops every voice playing a sound and frees its samples */
+auto DestroySound(uint sound) -> void
+{
+	std::lock_guard<std::mutex> lock(s_mixerMutex);
+
+	for (auto &voice : s_voices)
+		if (voice.active && voice.sound == sound)
+			voice.active = false;
+
+	s_sounds.erase(sound);
+}
+
+/* Starts a sound on a free voice. When all voices are busy the lowest
+   priority voice that is closest to finishing is stolen, the oldest on a
+   tie, as long as its priority isn't above the new sound's.
+   Returns the voice handle or 0 if nothing could be stolen. */
+auto StartVoice(uint sound, float volume, float pan, int priority) -> uint
+{
+	std::lock_guard<std::mutex> lock(s_mixerMutex);
+
+	auto it = s_sounds.find(sound);
+	if (it == s_sounds.end() || s_voices.empty()) return 0;
+
+	int chosen = -1;
+	for (size_t i = 0; i < s_voices.size(); i++)
+	{
+		if (!s_voices[i].active)
+		{
+			chosen = (int)i;
+			break;
+		}
+	}
+
+	if (chosen < 0)
+	{
+		size_t remaining = SIZE_MAX;
+
+		for (size_t i = 0; i < s_voices.size(); i++)
+		{
+			auto &voice = s_voices[i];
+			if (voice.priority > priority) continue;
+
+			size_t left = s_sounds[voice.sound].left.size() - voice.position;
+			bool better = chosen < 0 || voice.priority < s_voices[chosen].priority;
+
+			if (!better && voice.priority == s_voices[chosen].priority)
+				better = left < remaining || (left == remaining &&
+											  voice.started < s_voices[chosen].started);
+
+			if (better)
+			{
+				chosen = (int)i;
+				remaining = left;
+			}
+		}
+
+		if (chosen < 0)
+		{
+			s_mixerStats.dropped++;
+			return 0;
+		}
+
+		s_mixerStats.steals++;
+	}
+
+	auto &voice = s_voices[chosen];
+	voice.sound = sound;
+	voice.generation = std::max((voice.generation + 1) & 0xFFFFFF, 1u);
+	voice.position = 0;
+	voice.started = s_voicesStarted++;
+	voice.priority = priority;
+	voice.active = true;
+	setGain(voice, volume, pan);
+	return voiceHandle(chosen);
+}
+
+/* Changes the volume and pan of a playing voice */
+auto SetVoiceGain(uint voice, float volume, float pan) -> void
+{
+	std::lock_guard<std::mutex> lock(s_mixerMutex);
+	if (auto found = findVoice(voice))
+		setGain(*found, volume, pan);
+}
+
+/* Stops a voice, stale handles are ignored */
+auto StopVoice(uint voice) -> void
+{
+	std::lock_guard<std::mutex> lock(s_mixerMutex);
+	if (auto found = findVoice(voice))
+		found->active = false;
+}
+
+/* Whether a voice is still playing its sound */
+auto IsVoicePlaying(uint voice) -> bool
+{
+	std::lock_guard<std::mutex> lock(s_mixerMutex);
+	return findVoice(voice) != nullptr;
+}
+
+/* Returns voice counts, steals and how long mixing takes per block */
+auto GetMixerStats() -> MixerStats
+{
+	std::lock_guard<std::mutex> lock(s_mixerMutex);
+
+	auto stats = s_mixerStats;
+	stats.voices = (uint)s_voices.size();
+	stats.activeVoices = (uint)std::count_if(s_voices.begin(), s_voices.end(),
+											 [](auto &voice) { return voice.active; });
+	return stats;
+}
\ No newline at end of file
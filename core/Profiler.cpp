@@ -0,0 +1,390 @@
+#include "SzarkCore.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+using ProfileClock = std::chrono::steady_clock;
+
+static const uint s_maxProfileZones = 256;
+
+// Handed out once every zone is taken, its samples are dropped
+static const uint s_invalidProfileZone = UINT32_MAX;
+static const uint s_maxZoneDepth = 64;
+
+// Stats are taken over the newest samples of each zone
+static const uint s_profileWindow = 240;
+
+// Raw samples for the trace, the oldest are overwritten
+static const uint s_profileRingSize = 1 << 16;
+
+// Queries waiting for their result, more are dropped
+static const uint s_maxGpuQueries = 64;
+
+// The trace lane of GPU samples, threads start after it
+static const uint s_gpuThread = 0;
+
+/* The newest durations of one zone, written without locks */
+struct ZoneWindow
+{
+	std::atomic<uint64_t> count;
+	std::atomic<double> samples[s_profileWindow];
+};
+
+struct ProfileZoneInfo
+{
+	char name[64];
+	ZoneWindow cpu, gpu;
+};
+
+/* One sample of the trace ring. The sequence is odd while a writer is
+   filling the slot, readers skip slots that changed under them. */
+struct ProfileSample
+{
+	std::atomic<uint64_t> sequence;
+	std::atomic<uint> zone, thread;
+	std::atomic<double> start, duration;
+};
+
+struct OpenZone
+{
+	uint zone;
+	double start;
+};
+
+struct GpuQuery
+{
+	uint query, zone;
+	double start;
+};
+
+static ProfileZoneInfo s_profileZones[s_maxProfileZones];
+static std::atomic<uint> s_profileZoneCount{0};
+static std::mutex s_profileZoneMutex;
+
+static ProfileSample s_profileRing[s_profileRingSize];
+static std::atomic<uint64_t> s_profileHead{0};
+
+static std::atomic<bool> s_profilerEnabled{false};
+static std::atomic<uint> s_nextProfileThread{s_gpuThread + 1};
+static std::atomic<uint> s_renderThread{0};
+static const ProfileClock::time_point s_profileEpoch = ProfileClock::now();
+
+static thread_local OpenZone s_openZones[s_maxZoneDepth];
+static thread_local uint s_openDepth = 0;
+static thread_local uint s_profileThread = 0;
+
+// Only touched on the render thread
+static std::vector<GpuQuery> s_pendingQueries;
+static std::vector<uint> s_freeQueries;
+static bool s_gpuZoneOpen = false;
+
+static const char *s_coreZoneNames[] = {"Frame", "Poll", "Render",
+										"Upload", "Draw", "Swap", "Capture"};
+
+static double profileTime()
+{
+	return std::chrono::duration<double>(ProfileClock::now() - s_profileEpoch).count();
+}
+
+static uint profileThread()
+{
+	if (s_profileThread == 0)
+		s_profileThread = s_nextProfileThread++;
+	return s_profileThread;
+}
+
+/* Names the core zones so they always have the first ids */
+static void registerCoreZones()
+{
+	if (s_profileZoneCount.load(std::memory_order_acquire) > 0) return;
+
+	std::lock_guard<std::mutex> lock(s_profileZoneMutex);
+	if (s_profileZoneCount > 0) return;
+
+	uint count = sizeof(s_coreZoneNames) / sizeof(*s_coreZoneNames);
+	for (uint i = 0; i < count; i++)
+		snprintf(s_profileZones[i].name, sizeof(s_profileZones[i].name),
+				 "%s", s_coreZoneNames[i]);
+
+	s_profileZoneCount.store(count, std::memory_order_release);
+}
+
+static void recordSample(uint zone, uint thread, double start, double duration)
+{
+	auto &info = s_profileZones[zone];
+	auto &window = thread == s_gpuThread ? info.gpu : info.cpu;
+
+	uint64_t index = window.count.fetch_add(1, std::memory_order_relaxed);
+	window.samples[index % s_profileWindow].store(duration, std::memory_order_relaxed);
+
+	uint64_t ticket = s_profileHead.fetch_add(1, std::memory_order_relaxed);
+	auto &sample = s_profileRing[ticket & (s_profileRingSize - 1)];
+
+	sample.sequence.store(ticket * 2 + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	sample.zone.store(zone, std::memory_order_relaxed);
+	sample.thread.store(thread, std::memory_order_relaxed);
+	sample.start.store(start, std::memory_order_relaxed);
+	sample.duration.store(duration, std::memory_order_relaxed);
+	sample.sequence.store(ticket * 2 + 2, std::memory_order_release);
+}
+
+/* Starts a GL_TIME_ELAPSED query. They can't nest, so only the
+   outermost GPU zone is measured. */
+static bool beginGpuZone(uint zone)
+{
+	if (IsHeadless() || s_gpuZoneOpen || !glGenQueries ||
+		s_pendingQueries.size() >= s_maxGpuQueries)
+		return false;
+
+	uint query = 0;
+	if (!s_freeQueries.empty())
+	{
+		query = s_freeQueries.back();
+		s_freeQueries.pop_back();
+	}
+	else
+		glGenQueries(1, &query);
+
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	s_pendingQueries.push_back({query, zone, profileTime()});
+	s_gpuZoneOpen = true;
+	return true;
+}
+
+static void endGpuZone()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	s_gpuZoneOpen = false;
+}
+
+/* Reads the queries the GPU has finished, a few frames after they were
+   issued, so the render thread never waits on them */
+static void collectGpuQueries()
+{
+	size_t done = 0;
+	for (; done < s_pendingQueries.size(); done++)
+	{
+		auto &pending = s_pendingQueries[done];
+
+		int available = 0;
+		glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed);
+		recordSample(pending.zone, s_gpuThread, pending.start, elapsed * 1e-9);
+		s_freeQueries.push_back(pending.query);
+	}
+
+	s_pendingQueries.erase(s_pendingQueries.begin(), s_pendingQueries.begin() + done);
+}
+
+/* Writes a string as a JSON string literal */
+static void writeJsonString(FILE *file, const char *text)
+{
+	fputc('"', file);
+	for (; *text; text++)
+	{
+		if (*text == '"' || *text == '\\')
+			fputc('\\', file);
+
+		if ((unsigned char)*text >= 0x20)
+			fputc(*text, file);
+	}
+	fputc('"', file);
+}
+
+ProfileScope::ProfileScope(CoreZone zone, bool gpu) : gpu(false)
+{
+	if (!s_profilerEnabled.load(std::memory_order_relaxed))
+	{
+		active = false;
+		return;
+	}
+
+	active = true;
+	BeginProfileZone((uint)zone);
+	if (gpu) this->gpu = beginGpuZone((uint)zone);
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (gpu) endGpuZone();
+	if (active) EndProfileZone();
+}
+
+/* Marks the start of a frame on the render thread and picks up the GPU
+   timings that finished since the last one */
+auto BeginProfilerFrame() -> void
+{
+	s_renderThread = profileThread();
+	if (!IsHeadless() && !s_pendingQueries.empty())
+		collectGpuQueries();
+}
+
+/* Turns recording on or off. Off, zones cost one atomic load. */
+auto SetProfilerEnabled(bool enabled) -> void
+{
+	registerCoreZones();
+	s_profilerEnabled = enabled;
+}
+
+/* Whether zones are being recorded */
+auto IsProfilerEnabled() -> bool { return s_profilerEnabled; }
+
+/* Returns the id of a named zone, registering it the first time. Past
+   the zone limit the id is invalid and the zone is never recorded. */
+auto RegisterProfileZone(const char *name) -> uint
+{
+	registerCoreZones();
+	if (!name) name = "";
+
+	std::lock_guard<std::mutex> lock(s_profileZoneMutex);
+
+	uint count = s_profileZoneCount;
+	for (uint i = 0; i < count; i++)
+		if (strncmp(s_profileZones[i].name, name, sizeof(s_profileZones[i].name) - 1) == 0)
+			return i;
+
+	if (count >= s_maxProfileZones)
+	{
+		Error("Too many profiler zones, the limit is 256! The zone is not recorded.");
+		return s_invalidProfileZone;
+	}
+
+	snprintf(s_profileZones[count].name, sizeof(s_profileZones[count].name), "%s", name);
+	s_profileZoneCount.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+/* Returns how many zones were registered, including the core's own */
+auto GetProfileZoneCount() -> uint
+{
+	registerCoreZones();
+	return s_profileZoneCount;
+}
+
+/* Returns the name of a zone */
+auto GetProfileZoneName(uint zone) -> const char *
+{
+	return zone < s_profileZoneCount ? s_profileZones[zone].name : "";
+}
+
+/* Opens a zone on the calling thread. Zones nest and are closed in
+   reverse order by EndProfileZone. */
+auto BeginProfileZone(uint zone) -> void
+{
+	uint depth = s_openDepth++;
+	if (depth >= s_maxZoneDepth) return;
+
+	bool record = s_profilerEnabled.load(std::memory_order_relaxed) &&
+				  zone < s_profileZoneCount.load(std::memory_order_acquire);
+	s_openZones[depth] = {zone, record ? profileTime() : -1.0};
+}
+
+/* Closes the innermost open zone of the calling thread */
+auto EndProfileZone() -> void
+{
+	if (s_openDepth == 0) return;
+
+	uint depth = --s_openDepth;
+	if (depth >= s_maxZoneDepth) return;
+
+	auto &open = s_openZones[depth];
+	if (open.start < 0) return;
+
+	recordSample(open.zone, profileThread(), open.start, profileTime() - open.start);
+}
+
+/* Minimum, average and 99th percentile of the newest samples of a zone,
+   in seconds. GPU stats are only there for core upload and draw zones. */
+auto GetProfileStats(uint zone, bool gpu) -> ProfileStats
+{
+	ProfileStats stats = {};
+	if (zone >= s_profileZoneCount) return stats;
+
+	auto &window = gpu ? s_profileZones[zone].gpu : s_profileZones[zone].cpu;
+	stats.count = window.count.load(std::memory_order_relaxed);
+
+	uint count = (uint)std::min<uint64_t>(stats.count, s_profileWindow);
+	if (count == 0) return stats;
+
+	double samples[s_profileWindow];
+	for (uint i = 0; i < count; i++)
+		samples[i] = window.samples[i].load(std::memory_order_relaxed);
+
+	stats.last = window.samples[(stats.count - 1) % s_profileWindow];
+
+	std::sort(samples, samples + count);
+	stats.min = samples[0];
+	stats.p99 = samples[(count * 99 + 99) / 100 - 1];
+
+	for (uint i = 0; i < count; i++)
+		stats.average += samples[i];
+	stats.average /= count;
+
+	return stats;
+}
+
+/* Saves the newest samples as Chrome trace events, which can be opened
+   in chrome://tracing or Perfetto */
+auto SaveProfileTrace(const char *path) -> bool
+{
+	FILE *file = path ? fopen(path, "w") : nullptr;
+	if (!file)
+	{
+		Error("Failed to open the profile trace file!");
+		return false;
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+				  "\"args\":{\"name\":\"GPU\"}}",
+			s_gpuThread);
+
+	uint renderThread = s_renderThread;
+	for (uint thread = s_gpuThread + 1; thread < s_nextProfileThread; thread++)
+	{
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+					  "\"args\":{\"name\":",
+				thread);
+
+		char name[32];
+		snprintf(name, sizeof(name), "Thread %u", thread);
+		writeJsonString(file, thread == renderThread ? "Render" : name);
+		fprintf(file, "}}");
+	}
+
+	uint64_t head = s_profileHead.load(std::memory_order_acquire);
+	uint64_t first = head > s_profileRingSize ? head - s_profileRingSize : 0;
+
+	for (uint64_t ticket = first; ticket < head; ticket++)
+	{
+		auto &sample = s_profileRing[ticket & (s_profileRingSize - 1)];
+
+		uint64_t sequence = sample.sequence.load(std::memory_order_acquire);
+		uint zone = sample.zone.load(std::memory_order_relaxed);
+		uint thread = sample.thread.load(std::memory_order_relaxed);
+		double start = sample.start.load(std::memory_order_relaxed);
+		double duration = sample.duration.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// Skip slots being written or already overwritten
+		if (sequence != ticket * 2 + 2 ||
+			sample.sequence.load(std::memory_order_relaxed) != sequence ||
+			zone >= s_profileZoneCount)
+			continue;
+
+		fprintf(file, ",\n{\"name\":");
+		writeJsonString(file, s_profileZones[zone].name);
+		fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+					  "\"ts\":%.3f,\"dur\":%.3f}",
+				thread == s_gpuThread ? "gpu" : "cpu", thread,
+				start * 1e6, duration * 1e6);
+	}
+
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
@@ -0,0 +1,404 @@
+#include "SzarkCore.h"
+
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SZARK_SSE2
+#endif
+
+/* Fills a span of pixels with one color, 16 pixels (48 bytes) at a time */
+static void fillSpan(Color *dst, int count, Color color)
+{
+#ifdef SZARK_SSE2
+	if (count >= 16)
+	{
+		// Three registers hold 16 pixels, the pattern repeats every 48 bytes
+		alignas(16) Color pattern[16];
+		for (auto &pixel : pattern)
+			pixel = color;
+
+		auto bytes = reinterpret_cast<const __m128i *>(pattern);
+		__m128i a = _mm_load_si128(bytes);
+		__m128i b = _mm_load_si128(bytes + 1);
+		__m128i c = _mm_load_si128(bytes + 2);
+
+		for (; count >= 16; count -= 16, dst += 16)
+		{
+			auto out = reinterpret_cast<__m128i *>(dst);
+			_mm_storeu_si128(out, a);
+			_mm_storeu_si128(out + 1, b);
+			_mm_storeu_si128(out + 2, c);
+		}
+	}
+#endif
+
+	for (int i = 0; i < count; i++)
+		dst[i] = color;
+}
+
+/* Fills a span of 4 byte pixels, 4 per aligned store once aligned */
+static void fillSpan(Color32 *dst, int count, Color32 color)
+{
+#ifdef SZARK_SSE2
+	while (count > 0 && (reinterpret_cast<uintptr_t>(dst) & 15))
+		*dst++ = color, count--;
+
+	if (count >= 4)
+	{
+		uint packed;
+		memcpy(&packed, &color, 4);
+		__m128i pattern = _mm_set1_epi32((int)packed);
+
+		for (; count >= 4; count -= 4, dst += 4)
+			_mm_store_si128(reinterpret_cast<__m128i *>(dst), pattern);
+	}
+#endif
+
+	for (int i = 0; i < count; i++)
+		dst[i] = color;
+}
+
+/* Fills a span of palette indices */
+static void fillSpan(unsigned char *dst, int count, unsigned char index)
+{
+	memset(dst, index, count);
+}
+
+/* Calls draw with the target cast to its pixel type and the color
+   converted to that type. Indexed targets use red as the index. */
+template <typename Draw>
+static void withPixels(void *target, PixelFormat format, Color color, Draw draw)
+{
+	switch (format)
+	{
+	case PixelFormat::RGBA32:
+		draw(static_cast<Color32 *>(target), Color32{color.r, color.g, color.b, 255});
+		break;
+	case PixelFormat::Indexed8:
+		draw(static_cast<unsigned char *>(target), color.r);
+		break;
+	default:
+		draw(static_cast<Color *>(target), color);
+		break;
+	}
+}
+
+static inline Color toColor(Color pixel) { return pixel; }
+static inline Color toColor(Color32 pixel) { return {pixel.r, pixel.g, pixel.b}; }
+static inline Color toColor(unsigned char index) { return GetPaletteColors()[index]; }
+
+/* Converts a pixel between formats, same formats are copied as they are */
+template <typename To, typename From>
+static inline To convertPixel(From pixel)
+{
+	if constexpr (std::is_same_v<To, From>)
+		return pixel;
+	else if constexpr (std::is_same_v<To, Color32>)
+	{
+		Color color = toColor(pixel);
+		return {color.r, color.g, color.b, 255};
+	}
+	else if constexpr (std::is_same_v<To, unsigned char>)
+		return toColor(pixel).r;
+	else
+		return toColor(pixel);
+}
+
+/* Writes a single pixel if it lies inside the target */
+template <typename Pixel>
+static inline void plot(Pixel *target, uint width, uint height,
+						int x, int y, Pixel color)
+{
+	if ((uint)x < width && (uint)y < height)
+		target[(size_t)y * width + x] = color;
+}
+
+/* Floor division for a positive divisor */
+static inline int64_t floorDiv(int64_t a, int64_t b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+template <typename Pixel>
+static void fillRect(Pixel *target, uint width, uint height,
+					 int x, int y, int w, int h, Pixel color)
+{
+	if (w <= 0 || h <= 0) return;
+
+	int x0 = std::max(x, 0), y0 = std::max(y, 0);
+	int x1 = (int)std::min<int64_t>((int64_t)x + w, width);
+	int y1 = (int)std::min<int64_t>((int64_t)y + h, height);
+	if (x0 >= x1 || y0 >= y1) return;
+
+	// A full width rectangle is one contiguous span
+	if (x0 == 0 && x1 == (int)width)
+	{
+		fillSpan(target + (size_t)y0 * width, (y1 - y0) * width, color);
+		return;
+	}
+
+	for (int row = y0; row < y1; row++)
+		fillSpan(target + (size_t)row * width + x0, x1 - x0, color);
+}
+
+template <typename Pixel>
+static void fillCircle(Pixel *target, uint width, uint height,
+					   int x, int y, int radius, Pixel color)
+{
+	if (radius <= 0) return;
+
+	int64_t radiusSq = (int64_t)radius * radius;
+	int cx = x - 1 + radius;
+
+	for (int j = 0; j < radius * 2; j++)
+	{
+		int row = y - 1 + j;
+		if ((uint)row >= height) continue;
+
+		// Widest offset k where k^2 + dy^2 < r^2, one sqrt per row
+		int64_t dy = radius - j;
+		int64_t remaining = radiusSq - dy * dy;
+		if (remaining <= 0) continue;
+
+		int64_t k = (int64_t)std::sqrt((double)remaining);
+		while (k * k >= remaining) k--;
+		while ((k + 1) * (k + 1) < remaining) k++;
+
+		int x0 = std::max<int64_t>(cx - k, 0);
+		int x1 = (int)std::min<int64_t>(cx + k + 1, width);
+		if (x0 < x1)
+			fillSpan(target + (size_t)row * width + x0, x1 - x0, color);
+	}
+}
+
+/* Fills a triangle with per-row spans solved from its edge functions.
+   Pixels on the edges are included, the bounding box is half open. */
+template <typename Pixel>
+static void fillTriangle(Pixel *target, uint width, uint height,
+						 int x1, int y1, int x2, int y2, int x3, int y3,
+						 Pixel color)
+{
+	int minX = std::max(std::min({x1, x2, x3}), 0);
+	int maxX = std::min<int64_t>(std::max({x1, x2, x3}), width);
+	int minY = std::max(std::min({y1, y2, y3}), 0);
+	int maxY = std::min<int64_t>(std::max({y1, y2, y3}), height);
+	if (minX >= maxX || minY >= maxY) return;
+
+	const int64_t vx[3] = {x1, x2, x3}, vy[3] = {y1, y2, y3};
+
+	// Edge i runs from vertex i to vertex i + 1: E(x, y) = A * x + B * y + C
+	int64_t A[3], B[3], C[3];
+	for (int i = 0; i < 3; i++)
+	{
+		int n = (i + 1) % 3;
+		A[i] = vy[i] - vy[n];
+		B[i] = vx[n] - vx[i];
+		C[i] = vx[i] * vy[n] - vy[i] * vx[n];
+	}
+
+	// Collinear vertices only cover the pixels on their shared line
+	int64_t area = A[0] * vx[2] + B[0] * vy[2] + C[0];
+	if (area == 0)
+	{
+		int e = (A[0] || B[0]) ? 0 : (A[1] || B[1]) ? 1 : 2;
+
+		for (int y = minY; y < maxY; y++)
+		{
+			int64_t rowConstant = B[e] * y + C[e];
+
+			if (A[e] == 0)
+			{
+				if (rowConstant == 0)
+					fillSpan(target + (size_t)y * width + minX, maxX - minX, color);
+			}
+			else if (rowConstant % A[e] == 0)
+			{
+				int64_t x = -rowConstant / A[e];
+				if (x >= minX && x < maxX)
+					target[(size_t)y * width + x] = color;
+			}
+		}
+		return;
+	}
+
+	// Orient the edges so the inside is positive
+	if (area < 0)
+	{
+		for (int i = 0; i < 3; i++)
+			A[i] = -A[i], B[i] = -B[i], C[i] = -C[i];
+	}
+
+	for (int y = minY; y < maxY; y++)
+	{
+		int64_t left = minX, right = maxX - 1;
+
+		for (int i = 0; i < 3 && left <= right; i++)
+		{
+			int64_t rowConstant = B[i] * y + C[i];
+
+			if (A[i] > 0)
+				left = std::max(left, -floorDiv(rowConstant, A[i]));
+			else if (A[i] < 0)
+				right = std::min(right, floorDiv(rowConstant, -A[i]));
+			else if (rowConstant < 0)
+				left = right + 1;
+		}
+
+		if (left <= right)
+			fillSpan(target + (size_t)y * width + left,
+					 (int)(right - left + 1), color);
+	}
+}
+
+/* Draws a line by stepping along its longest axis */
+template <typename Pixel>
+static void drawLine(Pixel *target, uint width, uint height,
+					 int x1, int y1, int x2, int y2, Pixel color,
+					 int thickness)
+{
+	float dx = (float)(x2 - x1);
+	float dy = (float)(y2 - y1);
+	float step = std::max(std::abs(dx), std::abs(dy));
+	if (step < 1) return;
+
+	// Reject lines whose bounds (with thickness) miss the target entirely
+	int extra = std::max(thickness, 1) - 1;
+	int minX = std::min(x1, x2), maxX = std::max(x1, x2) + extra;
+	int minY = std::min(y1, y2), maxY = std::max(y1, y2) + extra;
+	if (maxX < 0 || maxY < 0 || minX >= (int)width || minY >= (int)height)
+		return;
+
+	dx /= step;
+	dy /= step;
+
+	float x = (float)x1, y = (float)y1;
+	for (int i = 1; i <= step; i++)
+	{
+		int px = (int)x, py = (int)y;
+		plot(target, width, height, px, py, color);
+
+		for (int j = 1; j < thickness; j++)
+		{
+			plot(target, width, height, px + j, py, color);
+			plot(target, width, height, px, py + j, color);
+		}
+
+		x += dx;
+		y += dy;
+	}
+}
+
+/* Stretches a texture over the w by h rectangle at (x, y) of the
+   target, converting the pixels when the formats differ */
+template <typename Pixel, typename Source>
+static void drawTexture(Pixel *target, uint width, uint height,
+						const Source *source, uint sourceWidth,
+						uint sourceHeight, int x, int y, int w, int h)
+{
+	if (w <= 0 || h <= 0 || sourceWidth == 0 || sourceHeight == 0) return;
+
+	int64_t x0 = std::max<int64_t>(x, 0);
+	int64_t y0 = std::max<int64_t>(y, 0);
+	int64_t x1 = std::min<int64_t>((int64_t)x + w, width);
+	int64_t y1 = std::min<int64_t>((int64_t)y + h, height);
+	if (x0 >= x1 || y0 >= y1) return;
+
+	size_t span = (size_t)(x1 - x0);
+
+	if ((uint)w == sourceWidth && (uint)h == sourceHeight)
+	{
+		for (int64_t row = y0; row < y1; row++)
+		{
+			const Source *src = source + (size_t)(row - y) * sourceWidth + (x0 - x);
+			Pixel *dst = target + (size_t)row * width + x0;
+
+			if constexpr (std::is_same_v<Pixel, Source>)
+				std::copy_n(src, span, dst);
+			else
+				for (size_t i = 0; i < span; i++)
+					dst[i] = convertPixel<Pixel>(src[i]);
+		}
+		return;
+	}
+
+	// Expand each source row once, then copy it for every row it covers
+	std::vector<Pixel> expanded(span);
+	int64_t lastRow = -1;
+
+	for (int64_t row = y0; row < y1; row++)
+	{
+		int64_t sourceRow = (row - y) * sourceHeight / h;
+
+		if (sourceRow != lastRow)
+		{
+			const Source *src = source + (size_t)sourceRow * sourceWidth;
+			for (size_t i = 0; i < span; i++)
+				expanded[i] = convertPixel<Pixel>(
+					src[(x0 - x + (int64_t)i) * sourceWidth / w]);
+			lastRow = sourceRow;
+		}
+
+		std::copy_n(expanded.data(), span, target + (size_t)row * width + x0);
+	}
+}
+
+/* Fills a clipped rectangle on the target */
+auto CanvasFillRect(void *target, PixelFormat format, uint width, uint height,
+					int x, int y, int w, int h, Color color) -> void
+{
+	if (!target) return;
+	withPixels(target, format, color, [&](auto *pixels, auto pixel) {
+		fillRect(pixels, width, height, x, y, w, h, pixel);
+	});
+}
+
+/* Fills a circle whose bounding box starts at (x - 1, y - 1) */
+auto CanvasFillCircle(void *target, PixelFormat format, uint width, uint height,
+					  int x, int y, int radius, Color color) -> void
+{
+	if (!target) return;
+	withPixels(target, format, color, [&](auto *pixels, auto pixel) {
+		fillCircle(pixels, width, height, x, y, radius, pixel);
+	});
+}
+
+/* Fills a triangle, edges included */
+auto CanvasFillTriangle(void *target, PixelFormat format, uint width, uint height,
+						int x1, int y1, int x2, int y2, int x3, int y3,
+						Color color) -> void
+{
+	if (!target) return;
+	withPixels(target, format, color, [&](auto *pixels, auto pixel) {
+		fillTriangle(pixels, width, height, x1, y1, x2, y2, x3, y3, pixel);
+	});
+}
+
+/* Draws a line that is thickness pixels wide */
+auto CanvasDrawLine(void *target, PixelFormat format, uint width, uint height,
+					int x1, int y1, int x2, int y2, Color color,
+					int thickness) -> void
+{
+	if (!target) return;
+	withPixels(target, format, color, [&](auto *pixels, auto pixel) {
+		drawLine(pixels, width, height, x1, y1, x2, y2, pixel, thickness);
+	});
+}
+
+/* Stretches a texture of any format over a rectangle of the target */
+auto CanvasDrawTexture(void *target, PixelFormat format, uint width, uint height,
+					   const void *source, PixelFormat sourceFormat,
+					   uint sourceWidth, uint sourceHeight, int x, int y,
+					   int w, int h) -> void
+{
+	if (!target || !source) return;
+
+	// The color is unused, it only picks the pixel types
+	withPixels(target, format, {}, [&](auto *pixels, auto) {
+		withPixels(const_cast<void *>(source), sourceFormat, {}, [&](auto *sourcePixels, auto) {
+			drawTexture(pixels, width, height, sourcePixels, sourceWidth,
+						sourceHeight, x, y, w, h);
+		});
+	});
+}
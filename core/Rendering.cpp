@@ -1,9 +1,39 @@
 #include "SzarkCore.h"
 
+#include <array>
+#include <unordered_map>
+
 static bool s_rendererInitialized = false;
 
+/* A texture made with GenerateTextureID. Only the top left region of
+   the used size is drawn by RenderQuad, the rest is spare storage. */
+struct TextureInfo
+{
+	PixelFormat format;
+	uint width, height, usedWidth, usedHeight;
+	bool linear;
+};
+
+static std::unordered_map<uint, TextureInfo> s_textureInfo;
+static uint s_boundTexture = 0;
+
+// Indexed textures look their colors up in this, starting as a grey ramp
+static std::array<Color, 256> s_palette = [] {
+	std::array<Color, 256> ramp;
+	for (uint i = 0; i < 256; i++)
+		ramp[i] = {(unsigned char)i, (unsigned char)i, (unsigned char)i};
+	return ramp;
+}();
+static uint s_paletteTexture = 0;
+static const uint s_paletteUnit = 1;
+
+static uint s_defaultQuadVAO;
+static uint s_defaultQuadVBO;
 static uint s_defaultQuadEBO;
 
+// Texture coordinates the quad currently has, as the far corner
+static float s_quadCoords[4] = {0, 0, 1, 1};
+
 static const float s_quadVertexData[] = {
 	// Pos   | Coords
 	1.0, 1.0, 1.0, 1.0,
@@ -14,8 +44,62 @@ static const float s_quadVertexData[] = {
 static const uint s_quadIndices[] = {
 	0, 1, 3, 1, 2, 3};
 
+/* Returns how many bytes a pixel of a format takes */
+auto PixelSize(PixelFormat format) -> uint
+{
+	switch (format)
+	{
+	case PixelFormat::RGBA32: return 4;
+	case PixelFormat::Indexed8: return 1;
+	default: return 3;
+	}
+}
+
+/* Returns the format a texture was created with */
+auto GetTextureFormat(uint id) -> PixelFormat
+{
+	auto it = s_textureInfo.find(id);
+	return it != s_textureInfo.end() ? it->second.format : PixelFormat::RGB24;
+}
+
+/* Limits what RenderQuad draws of a texture to its top left corner */
+auto SetTextureRegion(uint id, uint width, uint height) -> void
+{
+	auto it = s_textureInfo.find(id);
+	if (it == s_textureInfo.end()) return;
+
+	auto &info = it->second;
+	info.usedWidth = std::min(width, info.width);
+	info.usedHeight = std::min(height, info.height);
+}
+
+/* Returns all 256 palette entries */
+auto GetPaletteColors() -> const Color *
+{
+	return s_palette.data();
+}
+
+/* The OpenGL layout of a pixel format. Indexed pixels are a single
+   normalized channel that the shaders turn back into an index. */
+static void glPixelFormat(PixelFormat format, GLenum &internal, GLenum &layout)
+{
+	switch (format)
+	{
+	case PixelFormat::RGBA32:
+		internal = GL_RGBA8, layout = GL_RGBA;
+		break;
+	case PixelFormat::Indexed8:
+		internal = GL_R8, layout = GL_RED;
+		break;
+	default:
+		internal = GL_RGB8, layout = GL_RGB;
+		break;
+	}
+}
+
 /* Creates a render texture */
-auto GenerateTextureID(Color *pixels, uint width, uint height) -> uint
+auto GenerateTextureID(const void *pixels, uint width, uint height,
+					   PixelFormat format) -> uint
 {
 	if (width == 0 || height == 0 || pixels == nullptr)
 	{
@@ -24,29 +108,175 @@ auto GenerateTextureID(Color *pixels, uint width, uint height) -> uint
 
 	uint id = 0;
 
+	if (IsHeadless())
+	{
+		id = SoftwareGenerateTexture(pixels, width, height, format);
+		s_textureInfo[id] = {format, width, height, width, height, false};
+		return id;
+	}
+
+	GLenum internal, layout;
+	glPixelFormat(format, internal, layout);
+
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D, id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width,
-				 height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+	glTexImage2D(GL_TEXTURE_2D, 0, internal, width,
+				 height, 0, layout, GL_UNSIGNED_BYTE, pixels);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
+	s_textureInfo[id] = {format, width, height, width, height, false};
 	return id;
 }
 
 /* Updates a texture on the graphics card */
-auto inline UpdateTexture(uint id, Color *pixels, uint width, uint height) -> void
+auto UpdateTexture(uint id, const void *pixels, uint width, uint height) -> void
 {
+	ProfileScope zone(CoreZone::Upload, true);
+
+	if (IsHeadless())
+	{
+		SoftwareUpdateTexture(id, pixels, width, height);
+		return;
+	}
+
+	GLenum internal, layout;
+	glPixelFormat(GetTextureFormat(id), internal, layout);
+
 	glBindTexture(GL_TEXTURE_2D, id);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
-					GL_RGB, GL_UNSIGNED_BYTE, pixels);
+					layout, GL_UNSIGNED_BYTE, pixels);
+}
+
+/* Uploads regions of a texture from a pixel buffer with the given row
+   width. GL_UNPACK_ROW_LENGTH lets OpenGL read each region straight out
+   of the full buffer. With an unpack buffer bound, pixels is an offset. */
+auto UploadTextureRegions(uint id, const void *pixels, uint width,
+						  const Rect *regions, uint count) -> void
+{
+	GLenum internal, layout;
+	glPixelFormat(GetTextureFormat(id), internal, layout);
+
+	glBindTexture(GL_TEXTURE_2D, id);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+
+	for (uint i = 0; i < count; i++)
+	{
+		const Rect &region = regions[i];
+		if (region.width <= 0 || region.height <= 0)
+			continue;
+
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, region.x);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, region.y);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width,
+						region.height, layout, GL_UNSIGNED_BYTE, pixels);
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+}
+
+/* Replaces count palette entries from first on. Changing the palette
+   recolors every indexed texture without uploading any of them. */
+auto SetPalette(const Color *colors, uint first, uint count) -> void
+{
+	if (!colors || first >= 256) return;
+	count = std::min(count, 256 - first);
+
+	std::copy(colors, colors + count, s_palette.begin() + first);
+
+	if (IsHeadless() || s_paletteTexture == 0) return;
+
+	glActiveTexture(GL_TEXTURE0 + s_paletteUnit);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, first, 0, count, 1,
+					GL_RGB, GL_UNSIGNED_BYTE, s_palette.data() + first);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/* Uploads only the given regions of a texture */
+auto UpdateTextureRegions(uint id, const void *pixels, uint width, uint height,
+						  const Rect *regions, uint count) -> void
+{
+	if (pixels == nullptr || regions == nullptr || count == 0)
+		return;
+
+	ProfileScope zone(CoreZone::Upload, true);
+
+	if (IsHeadless())
+	{
+		SoftwareUpdateTextureRegions(id, pixels, width, height, regions, count);
+		return;
+	}
+
+	UploadTextureRegions(id, pixels, width, regions, count);
+}
+
+/* Samples a texture bilinearly when it is scaled instead of taking the
+   nearest pixel. The software renderer always takes the nearest. */
+auto SetTextureFilter(uint id, bool linear) -> void
+{
+	auto it = s_textureInfo.find(id);
+	if (it == s_textureInfo.end()) return;
+
+	it->second.linear = linear;
+	if (IsHeadless()) return;
+
+	GLint filter = linear ? GL_LINEAR : GL_NEAREST;
+	glBindTexture(GL_TEXTURE_2D, id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
 }
 
 /* Uses a texture */
-auto inline UseTexture(uint id) -> void
+auto UseTexture(uint id) -> void
 {
+	if (IsHeadless())
+	{
+		SoftwareUseTexture(id);
+		return;
+	}
+
+	s_boundTexture = id;
 	glBindTexture(GL_TEXTURE_2D, id);
+	SetDefaultShaderIndexed(GetTextureFormat(id) == PixelFormat::Indexed8);
+}
+
+/* Points the quad's texture coordinates at the used region of the bound
+   texture. Filtered textures stop half a texel short of the region's
+   edges, so the spare storage next to it never bleeds in. */
+static void fitQuadToTexture()
+{
+	float coords[4] = {0, 0, 1, 1};
+
+	auto it = s_textureInfo.find(s_boundTexture);
+	if (it != s_textureInfo.end())
+	{
+		auto &info = it->second;
+		if (info.usedWidth != info.width || info.usedHeight != info.height)
+		{
+			float inset = info.linear ? 0.5f : 0.0f;
+			coords[0] = inset / info.width;
+			coords[1] = inset / info.height;
+			coords[2] = (info.usedWidth - inset) / info.width;
+			coords[3] = (info.usedHeight - inset) / info.height;
+		}
+	}
+
+	if (std::equal(coords, coords + 4, s_quadCoords)) return;
+	std::copy(coords, coords + 4, s_quadCoords);
+
+	float vertices[16];
+	std::copy(s_quadVertexData, s_quadVertexData + 16, vertices);
+	for (uint i = 0; i < 4; i++)
+	{
+		vertices[i * 4 + 2] = s_quadVertexData[i * 4 + 2] > 0 ? coords[2] : coords[0];
+		vertices[i * 4 + 3] = s_quadVertexData[i * 4 + 3] > 0 ? coords[3] : coords[1];
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, s_defaultQuadVBO);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
 }
 
 /* Renders a quad on screen */
@@ -59,6 +289,17 @@ auto RenderQuad() -> void
 		return;
 	}
 
+	ProfileScope zone(CoreZone::Draw, true);
+
+	if (IsHeadless())
+	{
+		SoftwareRenderQuad();
+		return;
+	}
+
+	fitQuadToTexture();
+
+	glBindVertexArray(s_defaultQuadVAO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_defaultQuadEBO);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 }
@@ -66,9 +307,30 @@ auto RenderQuad() -> void
 /* Initializes Quad and Shaders for rendering */
 auto InitializeRenderer() -> void
 {
+	// The software path needs no quad or shaders
+	if (IsHeadless())
+	{
+		InitSpriteRenderer();
+		s_rendererInitialized = true;
+		return;
+	}
+
 	glEnable(GL_TEXTURE_2D);
 	glEnable(GL_DEPTH);
 
+	// Rows are tightly packed, RGB and indexed rows aren't 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// The palette stays bound to its own unit for the whole run
+	glGenTextures(1, &s_paletteTexture);
+	glActiveTexture(GL_TEXTURE0 + s_paletteUnit);
+	glBindTexture(GL_TEXTURE_2D, s_paletteTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 256, 1, 0, GL_RGB,
+				 GL_UNSIGNED_BYTE, s_palette.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glActiveTexture(GL_TEXTURE0);
+
 	if (!InitDefaultShader())
 	{
 		Error("Failed to compile default shader!");
@@ -96,12 +358,90 @@ auto InitializeRenderer() -> void
 	glVertexAttribPointer(1, 2, GL_FLOAT, false, 16, (void *)8);
 	glEnableVertexAttribArray(1);
 
+	s_defaultQuadVAO = vao;
+	s_defaultQuadVBO = vbo;
 	s_defaultQuadEBO = ebo;
+
+	if (!InitSpriteRenderer())
+		Error("Failed to compile sprite shader!");
+
 	s_rendererInitialized = true;
 }
 
 /* Sets the OpenGL Viewport */
 auto SetViewport(int x, int y, int w, int h) -> void
 {
+	if (IsHeadless())
+	{
+		SoftwareSetViewport(x, y, w, h);
+		return;
+	}
+
 	glViewport(x, y, w, h);
+}
+
+/* Copies the presented frame into pixels, top row first */
+auto ReadFramebuffer(Color *pixels, uint width, uint height) -> bool
+{
+	if (pixels == nullptr || width == 0 || height == 0)
+		return false;
+
+	if (IsHeadless())
+	{
+		uint fbWidth = 0, fbHeight = 0;
+		auto framebuffer = GetSoftwareFramebuffer(&fbWidth, &fbHeight);
+		if (fbWidth != width || fbHeight != height)
+		{
+			Error("Framebuffer read size does not match the framebuffer!");
+			return false;
+		}
+
+		std::copy(framebuffer, framebuffer + (size_t)width * height, pixels);
+		return true;
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+
+	// OpenGL reads bottom row first
+	for (uint y = 0; y < height / 2; y++)
+		std::swap_ranges(pixels + (size_t)y * width,
+						 pixels + (size_t)(y + 1) * width,
+						 pixels + (size_t)(height - y - 1) * width);
+
+	return true;
+}
+
+/* Writes the presented frame to a binary PPM file */
+auto SaveFramebuffer(const char *path) -> bool
+{
+	uint width = 0, height = 0;
+
+	if (IsHeadless())
+	{
+		GetSoftwareFramebuffer(&width, &height);
+	}
+	else
+	{
+		int viewport[4] = {0};
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		width = (uint)(viewport[0] + viewport[2]);
+		height = (uint)(viewport[1] + viewport[3]);
+	}
+
+	std::vector<Color> pixels((size_t)width * height);
+	if (!ReadFramebuffer(pixels.data(), width, height))
+		return false;
+
+	FILE *file = fopen(path, "wb");
+	if (!file)
+	{
+		Error("Failed to open framebuffer output file!");
+		return false;
+	}
+
+	fprintf(file, "P6\n%u %u\n255\n", width, height);
+	fwrite(pixels.data(), sizeof(Color), pixels.size(), file);
+	fclose(file);
+	return true;
 }
\ No newline at end of file
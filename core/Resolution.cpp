@@ -0,0 +1,118 @@
+#include "SzarkCore.h"
+
+#include <mutex>
+
+// Frames of history kept for tuning the budget
+static const size_t s_resolutionSamples = 240;
+
+// Frames rendered at a new scale before it is judged
+static const uint s_scaleCooldown = 15;
+
+// Scales are multiples of this, so noise can't resize every frame
+static const float s_scaleStep = 1.0f / 16;
+
+// Scales are picked to land this far under the budget
+static const double s_budgetTarget = 0.9;
+
+static std::mutex s_resolutionMutex;
+static double s_frameBudget = 0;
+static float s_minScale = 1, s_maxScale = 1, s_renderScale = 1;
+static double s_averageRenderTime = 0;
+static uint s_framesSinceChange = 0;
+
+static ResolutionSample s_resolutionHistory[s_resolutionSamples];
+static size_t s_historyCount = 0, s_historyNext = 0;
+
+/* Rounds a scale down to a step inside the bounds */
+static float snapScale(float scale)
+{
+	scale = std::floor(scale / s_scaleStep + 1e-4f) * s_scaleStep;
+	return std::clamp(scale, s_minScale, s_maxScale);
+}
+
+/* Records how long the game took to render a frame and picks the scale
+   of the next one. Rendering cost follows the pixel count, the square
+   of the scale, so the scale that fits the budget can be estimated. */
+auto UpdateRenderScale(double renderTime) -> void
+{
+	std::lock_guard<std::mutex> lock(s_resolutionMutex);
+
+	// Rises fast so a spike is answered within a few frames, and falls
+	// slowly so a single quick frame doesn't raise the scale
+	if (s_averageRenderTime <= 0)
+		s_averageRenderTime = renderTime;
+	else
+		s_averageRenderTime += (renderTime - s_averageRenderTime) *
+							   (renderTime > s_averageRenderTime ? 0.3 : 0.05);
+
+	s_resolutionHistory[s_historyNext] = {renderTime, s_averageRenderTime, s_renderScale};
+	s_historyNext = (s_historyNext + 1) % s_resolutionSamples;
+	s_historyCount = std::min(s_historyCount + 1, s_resolutionSamples);
+
+	if (s_frameBudget <= 0 || ++s_framesSinceChange < s_scaleCooldown)
+		return;
+
+	float scale = s_renderScale;
+	double target = s_frameBudget * s_budgetTarget;
+
+	if (s_averageRenderTime > s_frameBudget)
+	{
+		scale = snapScale(scale * (float)std::sqrt(target / s_averageRenderTime));
+	}
+	else
+	{
+		// Only raised when the larger scale is expected to fit as well
+		float larger = std::min(scale + s_scaleStep, s_maxScale);
+		double growth = (double)larger * larger / ((double)scale * scale);
+		if (s_averageRenderTime * growth < target)
+			scale = larger;
+	}
+
+	if (scale == s_renderScale) return;
+
+	// Frames at the old scale would misjudge the new one
+	s_averageRenderTime *= (double)scale * scale / ((double)s_renderScale * s_renderScale);
+	s_renderScale = scale;
+	s_framesSinceChange = 0;
+}
+
+/* Sets the seconds a frame may take to render and the bounds of the
+   scale. A budget of 0 stops scaling and renders at a scale of 1, or
+   the nearest bound. */
+auto SetResolutionScaling(double frameBudget, float minScale, float maxScale) -> void
+{
+	if (!(minScale > 0) || !(maxScale >= minScale))
+	{
+		Error("Resolution scale bounds must be positive and in order!");
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(s_resolutionMutex);
+	s_frameBudget = std::max(frameBudget, 0.0);
+	s_minScale = minScale;
+	s_maxScale = maxScale;
+	s_renderScale = std::clamp(s_frameBudget > 0 ? s_renderScale : 1.0f, minScale, maxScale);
+	s_framesSinceChange = 0;
+}
+
+/* Returns the scale of the screen resolution to render the next frame at */
+auto GetRenderScale() -> float
+{
+	std::lock_guard<std::mutex> lock(s_resolutionMutex);
+	return s_renderScale;
+}
+
+/* Writes up to capacity of the latest frames, oldest first, and returns
+   how many were written */
+auto GetResolutionHistory(ResolutionSample *samples, uint capacity) -> uint
+{
+	if (!samples) return 0;
+
+	std::lock_guard<std::mutex> lock(s_resolutionMutex);
+	uint count = (uint)std::min<size_t>(capacity, s_historyCount);
+	size_t first = (s_historyNext + s_resolutionSamples - count) % s_resolutionSamples;
+
+	for (uint i = 0; i < count; i++)
+		samples[i] = s_resolutionHistory[(first + i) % s_resolutionSamples];
+	return count;
+}
@@ -1,6 +1,60 @@
 #include "SzarkCore.h"
 
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+static const uint s_shaderCacheVersion = 1;
+
+// How often watched shader files are checked for changes
+static const auto s_shaderWatchInterval = std::chrono::milliseconds(250);
+
+/* Stored in front of every cached program binary */
+struct ShaderCacheHeader
+{
+	char magic[4];
+	uint version;
+	uint64_t key;
+	uint format, length;
+};
+
+/* A program rebuilt on the reload context whenever its files change */
+struct ShaderWatch
+{
+	std::string vertexPath, fragmentPath;
+	int64_t vertexStamp, fragmentStamp;
+
+	// Waiting to be swapped in on the render thread
+	uint pending;
+	std::string error;
+};
+
 static uint s_defaultProgramID;
+static int s_defaultIndexedLocation = -1;
+static bool s_defaultIndexed = false;
+static uint s_softwareProgramCount = 0;
+static std::string s_shaderCacheDirectory;
+
+static std::mutex s_shaderWatchMutex;
+static std::unordered_map<uint, ShaderWatch> s_shaderWatches;
+static std::atomic<bool> s_shaderReloadPending{false};
+static std::atomic<bool> s_shaderReloadRunning{false};
+static std::thread s_shaderReloadThread;
+static GLFWwindow *s_shaderReloadContext = nullptr;
+
+// Only used on the render thread. Programs are always used through the
+// id they were first compiled with, so reloads redirect that id to the
+// newest program and the uniform locations handed out to the newest ones.
+static std::unordered_map<uint, uint> s_programRedirects;
+static std::unordered_map<uint, std::unordered_map<int, int>> s_locationRedirects;
+static std::unordered_map<uint, std::unordered_map<std::string, int>> s_uniformNames;
+static std::unordered_map<uint, int> s_addedUniformCounts;
+static const int s_addedUniformBase = 1 << 24;
+static const std::unordered_map<int, int> *s_currentLocations = nullptr;
 
 static const char *s_defaultVertexShader =
 	"#version 420\n"
@@ -17,134 +71,594 @@ static const char *s_defaultFragmentShader =
 	"out vec4 FragColor;"
 	"in vec2 texCoord;"
 	"uniform sampler2D tex;"
+	"layout(binding = 1) uniform sampler2D palette;"
+	"uniform bool indexed;"
 	"void main() {"
-	"	FragColor = texture(tex, texCoord);"
+	"	vec4 texel = texture(tex, texCoord);"
+	"	FragColor = indexed ?"
+	"		texelFetch(palette, ivec2(texel.r * 255.0 + 0.5, 0), 0) : texel;"
 	"}";
 
-/* Prints a most recent shader error log and deletes the shader */
-static void shaderCompileError(uint id)
+/* Returns the most recent compile log of a shader */
+static std::string shaderLog(uint id)
 {
 	int length = 0;
 	glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
 
 	std::vector<char> logBuffer(length);
 	glGetShaderInfoLog(id, length, nullptr, logBuffer.data());
-	std::string errorLog(logBuffer.begin(), logBuffer.end());
-
-	Error(errorLog.c_str());
-	glDeleteShader(id);
+	return std::string(logBuffer.begin(), logBuffer.end());
 }
 
-/* Prints a most recent program link error log and deletes the program */
-static void linkCompileError(uint id)
+/* Returns the most recent link log of a program */
+static std::string programLog(uint id)
 {
 	int length = 0;
 	glGetProgramiv(id, GL_INFO_LOG_LENGTH, &length);
 
 	std::vector<char> logBuffer(length);
 	glGetProgramInfoLog(id, length, nullptr, logBuffer.data());
-	std::string errorLog(logBuffer.begin(), logBuffer.end());
-
-	Error(errorLog.c_str());
-	glDeleteProgram(id);
+	return std::string(logBuffer.begin(), logBuffer.end());
 }
 
-/* Compiles a Shader program from a vertex and fragment shader */
-auto CompileShader(const char *vertexSrc, const char *fragmentSrc) -> uint
+/* Compiles one stage of a program, returns 0 and the log on failure */
+static uint compileStage(GLenum type, const char *src, std::string &log)
 {
 	int success = 0;
-	uint vertID = glCreateShader(GL_VERTEX_SHADER);
-	uint fragID = glCreateShader(GL_FRAGMENT_SHADER);
+	uint id = glCreateShader(type);
 
-	glShaderSource(vertID, 1, &vertexSrc, nullptr);
-	glCompileShader(vertID);
+	glShaderSource(id, 1, &src, nullptr);
+	glCompileShader(id);
 
-	glGetShaderiv(vertID, GL_COMPILE_STATUS, &success);
+	glGetShaderiv(id, GL_COMPILE_STATUS, &success);
 
 	if (success == GL_FALSE)
 	{
-		shaderCompileError(vertID);
+		log = shaderLog(id);
+		glDeleteShader(id);
 		return 0;
 	}
 
-	glShaderSource(fragID, 1, &fragmentSrc, nullptr);
-	glCompileShader(fragID);
+	return id;
+}
 
-	glGetShaderiv(fragID, GL_COMPILE_STATUS, &success);
+/* Compiles and links a program from source. A retrievable program can
+   have its binary read back for the cache. */
+static uint linkProgram(const char *vertexSrc, const char *fragmentSrc,
+						bool retrievable, std::string &log)
+{
+	uint vertID = compileStage(GL_VERTEX_SHADER, vertexSrc, log);
+	if (!vertID) return 0;
 
-	if (success == GL_FALSE)
+	uint fragID = compileStage(GL_FRAGMENT_SHADER, fragmentSrc, log);
+	if (!fragID)
 	{
-		shaderCompileError(fragID);
+		glDeleteShader(vertID);
 		return 0;
 	}
 
-	int programID = glCreateProgram();
+	int success = 0;
+	uint programID = glCreateProgram();
+
+	if (retrievable)
+		glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	glAttachShader(programID, vertID);
 	glAttachShader(programID, fragID);
 	glLinkProgram(programID);
 
+	glDetachShader(programID, vertID);
+	glDetachShader(programID, fragID);
+	glDeleteShader(vertID);
+	glDeleteShader(fragID);
+
 	glGetProgramiv(programID, GL_LINK_STATUS, &success);
 
 	if (success == GL_FALSE)
 	{
-		linkCompileError(programID);
-		glDeleteShader(vertID);
-		glDeleteShader(fragID);
+		log = programLog(programID);
+		glDeleteProgram(programID);
 		return 0;
 	}
 
-	glDetachShader(programID, vertID);
-	glDetachShader(programID, fragID);
+	return programID;
+}
+
+/* FNV-1a over a null terminated string, including the terminator so
+   neighbouring strings can't run into each other */
+static uint64_t hashString(uint64_t hash, const char *text)
+{
+	if (!text) text = "";
+
+	do
+	{
+		hash ^= (unsigned char)*text;
+		hash *= 1099511628211ull;
+	} while (*text++);
+
+	return hash;
+}
+
+/* Binaries only load on the driver that made them, so the driver is
+   part of the key next to the sources */
+static uint64_t programKey(const char *vertexSrc, const char *fragmentSrc)
+{
+	uint64_t hash = 14695981039346656037ull ^ s_shaderCacheVersion;
+	hash = hashString(hash, vertexSrc);
+	hash = hashString(hash, fragmentSrc);
+	hash = hashString(hash, (const char *)glGetString(GL_VENDOR));
+	hash = hashString(hash, (const char *)glGetString(GL_RENDERER));
+	return hashString(hash, (const char *)glGetString(GL_VERSION));
+}
+
+static std::string cachePath(uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+	return s_shaderCacheDirectory + name;
+}
+
+/* Whether a cache directory is set and the driver can save binaries */
+static bool programCacheEnabled()
+{
+	if (s_shaderCacheDirectory.empty() || !glGetProgramBinary || !glProgramBinary)
+		return false;
+
+	int formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+/* Creates a program from a cached binary. Binaries the driver rejects,
+   after an update for example, are deleted so they get rebuilt. */
+static uint loadCachedProgram(uint64_t key)
+{
+	auto path = cachePath(key);
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file) return 0;
+
+	ShaderCacheHeader header = {};
+	std::vector<char> binary;
+
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+				 memcmp(header.magic, "SZSC", 4) == 0 &&
+				 header.version == s_shaderCacheVersion && header.key == key;
+
+	// A damaged length must not size the buffer past the file
+	if (valid && header.length > 0 &&
+		header.length <= (uint64_t)fileSize - sizeof(header))
+	{
+		binary.resize(header.length);
+		valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+	}
+	else
+		valid = false;
+
+	fclose(file);
+
+	uint programID = 0;
+	int success = 0;
+
+	if (valid)
+	{
+		programID = glCreateProgram();
+		glProgramBinary(programID, header.format, binary.data(), header.length);
+		glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	}
+
+	if (success == GL_FALSE)
+	{
+		if (programID) glDeleteProgram(programID);
+		remove(path.c_str());
+		return 0;
+	}
 
 	return programID;
 }
 
+/* Writes the binary of a linked program to the cache */
+static void saveCachedProgram(uint programID, uint64_t key)
+{
+	int length = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(programID, length, &length, &format, binary.data());
+
+	ShaderCacheHeader header = {{'S', 'Z', 'S', 'C'}, s_shaderCacheVersion,
+								key, (uint)format, (uint)length};
+
+	FILE *file = fopen(cachePath(key).c_str(), "wb");
+	if (!file) return;
+
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(binary.data(), 1, length, file);
+	fclose(file);
+}
+
+/* Loads a program from the cache, or builds it from source and caches
+   it. Returns 0 and the log when the sources don't compile. */
+static uint buildProgram(const char *vertexSrc, const char *fragmentSrc,
+						 std::string &log)
+{
+	bool cached = programCacheEnabled();
+	uint64_t key = cached ? programKey(vertexSrc, fragmentSrc) : 0;
+
+	if (cached)
+		if (uint programID = loadCachedProgram(key))
+			return programID;
+
+	uint programID = linkProgram(vertexSrc, fragmentSrc, cached, log);
+	if (programID && cached)
+		saveCachedProgram(programID, key);
+
+	return programID;
+}
+
+/* Changes whenever a file is written, 0 when it doesn't exist */
+static int64_t fileStamp(const std::string &path)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) return 0;
+	return (int64_t)info.st_mtime * 1000003 ^ (int64_t)info.st_size;
+}
+
+static bool readTextFile(const std::string &path, std::string &text)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file) return false;
+
+	char buffer[4096];
+	size_t read = 0;
+	text.clear();
+
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		text.append(buffer, read);
+
+	fclose(file);
+	return true;
+}
+
+/* Rebuilds changed programs on the hidden context so the render thread
+   never waits on the compiler. Finished programs are only swapped in by
+   the render thread, the next time they are used. */
+static void shaderReloadLoop()
+{
+	glfwMakeContextCurrent(s_shaderReloadContext);
+
+	while (s_shaderReloadRunning)
+	{
+		std::vector<std::pair<uint, ShaderWatch>> changed;
+
+		{
+			std::lock_guard<std::mutex> lock(s_shaderWatchMutex);
+			for (auto &[id, watch] : s_shaderWatches)
+			{
+				auto vertexStamp = fileStamp(watch.vertexPath);
+				auto fragmentStamp = fileStamp(watch.fragmentPath);
+
+				if (vertexStamp == watch.vertexStamp &&
+					fragmentStamp == watch.fragmentStamp)
+					continue;
+
+				watch.vertexStamp = vertexStamp;
+				watch.fragmentStamp = fragmentStamp;
+				changed.push_back({id, watch});
+			}
+		}
+
+		for (auto &[id, watch] : changed)
+		{
+			std::string vertexSrc, fragmentSrc, log;
+			uint programID = 0;
+
+			if (!readTextFile(watch.vertexPath, vertexSrc) ||
+				!readTextFile(watch.fragmentPath, fragmentSrc))
+				log = "Failed to read shader files for reloading!";
+			else if ((programID = buildProgram(vertexSrc.c_str(),
+											   fragmentSrc.c_str(), log)))
+				glFinish(); // Must be complete before the render thread uses it
+
+			std::lock_guard<std::mutex> lock(s_shaderWatchMutex);
+			auto it = s_shaderWatches.find(id);
+			if (it == s_shaderWatches.end())
+			{
+				if (programID) glDeleteProgram(programID);
+				continue;
+			}
+
+			if (programID)
+			{
+				if (it->second.pending)
+					glDeleteProgram(it->second.pending);
+				it->second.pending = programID;
+			}
+			else
+				it->second.error = log;
+
+			s_shaderReloadPending = true;
+		}
+
+		std::this_thread::sleep_for(s_shaderWatchInterval);
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+/* Joins the reload thread when the library unloads */
+static struct ShaderReloadShutdown
+{
+	~ShaderReloadShutdown()
+	{
+		s_shaderReloadRunning = false;
+		if (s_shaderReloadThread.joinable())
+			s_shaderReloadThread.join();
+	}
+} s_shaderReloadShutdown;
+
+/* Points every reloaded program's id at its new program and re-queries
+   the uniforms that were handed out for it */
+static void swapReloadedShaders()
+{
+	std::vector<std::string> errors;
+
+	{
+		std::lock_guard<std::mutex> lock(s_shaderWatchMutex);
+		for (auto &[id, watch] : s_shaderWatches)
+		{
+			if (!watch.error.empty())
+			{
+				errors.push_back(watch.error);
+				watch.error.clear();
+			}
+
+			if (!watch.pending) continue;
+
+			// The first program stays alive so its id is never reused
+			auto &program = s_programRedirects[id];
+			if (program)
+			{
+				ForgetProgram(program);
+				glDeleteProgram(program);
+			}
+
+			program = watch.pending;
+			watch.pending = 0;
+			ReflectProgram(program);
+			RebindParameterBlocks(id, program);
+
+			auto &locations = s_locationRedirects[id];
+			locations.clear();
+			for (auto &[name, location] : s_uniformNames[id])
+				locations[location] = FindUniform(program, name.c_str());
+		}
+	}
+
+	// Failed reloads keep the previous program running
+	for (auto &error : errors)
+		Error(error.c_str());
+}
+
+/* Maps a uniform location of the program in use to its reloaded one */
+static int uniformLocation(uint location)
+{
+	if (!s_currentLocations) return (int)location;
+
+	auto it = s_currentLocations->find((int)location);
+	return it != s_currentLocations->end() ? it->second : (int)location;
+}
+
+/* Compiles a Shader program from a vertex and fragment shader. With a
+   cache directory set, programs are loaded from their cached binary. */
+auto CompileShader(const char *vertexSrc, const char *fragmentSrc) -> uint
+{
+	// GLSL can't run on the software path, programs are only placeholders
+	if (IsHeadless())
+		return ++s_softwareProgramCount;
+
+	std::string log;
+	uint programID = buildProgram(vertexSrc, fragmentSrc, log);
+
+	if (programID)
+		ReflectProgram(programID);
+	else
+		Error(log.c_str());
+
+	return programID;
+}
+
+/* Returns the program currently standing in for a program id, which
+   differs from the id once the program was hot reloaded */
+auto ResolveProgram(uint id) -> uint
+{
+	auto it = s_programRedirects.find(id);
+	return it != s_programRedirects.end() ? it->second : id;
+}
+
+/* Sets the directory program binaries are cached in, which must exist.
+   Call it before the window opens, null or empty disables the cache. */
+auto SetShaderCacheDirectory(const char *path) -> void
+{
+	s_shaderCacheDirectory = path ? path : "";
+}
+
+/* Rebuilds a program in the background whenever one of its source files
+   changes. The program keeps its id and uniform locations, but uniform
+   values have to be sent again after a reload. */
+auto WatchShader(uint id, const char *vertexPath, const char *fragmentPath) -> bool
+{
+	if (IsHeadless() || !id || !vertexPath || !fragmentPath)
+		return false;
+
+	// The reload context is a window, which only the window thread can create
+	if (IsInputThreaded())
+	{
+		Error("Shaders can't be watched while input has its own thread!");
+		return false;
+	}
+
+	// A hidden window sharing objects with the current context
+	if (!s_shaderReloadContext)
+	{
+		auto current = glfwGetCurrentContext();
+		if (!current) return false;
+
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		s_shaderReloadContext = glfwCreateWindow(1, 1, "", nullptr, current);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+		if (!s_shaderReloadContext)
+		{
+			Error("Failed to create the shader reload context!");
+			return false;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(s_shaderWatchMutex);
+		s_shaderWatches[id] = {vertexPath, fragmentPath, fileStamp(vertexPath),
+							   fileStamp(fragmentPath), 0, ""};
+	}
+
+	if (!s_shaderReloadRunning.exchange(true))
+		s_shaderReloadThread = std::thread(shaderReloadLoop);
+
+	return true;
+}
+
+/* Stops watching shaders and frees the reload context, called by the
+   render thread before its context goes away */
+auto StopShaderReload() -> void
+{
+	s_shaderReloadRunning = false;
+	if (s_shaderReloadThread.joinable())
+		s_shaderReloadThread.join();
+
+	std::lock_guard<std::mutex> lock(s_shaderWatchMutex);
+	for (auto &[id, watch] : s_shaderWatches)
+		if (watch.pending)
+			glDeleteProgram(watch.pending);
+	s_shaderWatches.clear();
+
+	if (s_shaderReloadContext)
+	{
+		glfwDestroyWindow(s_shaderReloadContext);
+		s_shaderReloadContext = nullptr;
+	}
+}
+
 /* Creates a default flat shaded shader */
 auto InitDefaultShader() -> bool
 {
 	s_defaultProgramID = CompileShader(s_defaultVertexShader,
 									   s_defaultFragmentShader);
+	s_defaultIndexedLocation = FindUniform(s_defaultProgramID, "indexed");
 	return s_defaultProgramID != 0;
 }
 
+/* Makes the default shader look the texture up in the palette, set
+   whenever an indexed texture is bound in place of a color one */
+auto SetDefaultShaderIndexed(bool indexed) -> void
+{
+	if (indexed == s_defaultIndexed || s_defaultProgramID == 0) return;
+
+	glProgramUniform1i(s_defaultProgramID, s_defaultIndexedLocation, indexed);
+	s_defaultIndexed = indexed;
+}
+
 /* Uses the default renderer shader */
-auto inline UseDefaultShader() -> void
+auto UseDefaultShader() -> void
 {
 	UseShader(s_defaultProgramID);
 }
 
 /* Uses the Shader program */
-auto inline UseShader(uint id) -> void
+auto UseShader(uint id) -> void
 {
-	glUseProgram(id);
+	if (IsHeadless()) return;
+
+	if (s_shaderReloadPending.exchange(false))
+		swapReloadedShaders();
+
+	uint programID = id;
+	s_currentLocations = nullptr;
+
+	if (!s_programRedirects.empty())
+	{
+		auto it = s_programRedirects.find(id);
+		if (it != s_programRedirects.end())
+		{
+			programID = it->second;
+			s_currentLocations = &s_locationRedirects[id];
+		}
+	}
+
+	glUseProgram(programID);
 }
 
 /* Sends a uniform float to the shader */
-auto inline SendFloat(uint id, float value) -> void
+auto SendFloat(uint id, float value) -> void
 {
-	glUniform1f(id, value);
+	if (IsHeadless()) return;
+	glUniform1f(uniformLocation(id), value);
 }
 
 /* Sends a uniform float to the shader */
-auto inline SendVec2(uint id, float x, float y) -> void
+auto SendVec2(uint id, float x, float y) -> void
 {
-	glUniform2f(id, x, y);
+	if (IsHeadless()) return;
+	glUniform2f(uniformLocation(id), x, y);
 }
 
 /* Sends a uniform float to the shader */
-auto inline SendVec3(uint id, float x, float y, float z) -> void
+auto SendVec3(uint id, float x, float y, float z) -> void
 {
-	glUniform3f(id, x, y, z);
+	if (IsHeadless()) return;
+	glUniform3f(uniformLocation(id), x, y, z);
 }
 
 /* Sends a uniform float to the shader */
-auto inline SendVec4(uint id, float x, float y, float z, float w) -> void
+auto SendVec4(uint id, float x, float y, float z, float w) -> void
 {
-	glUniform4f(id, x, y, z, w);
+	if (IsHeadless()) return;
+	glUniform4f(uniformLocation(id), x, y, z, w);
 }
 
-/* Sends a uniform float to the shader */
-auto inline GetUniformLocation(uint program, const char *name) -> int
+/* Returns the location of a uniform from the program's reflection, so
+   looking it up every frame doesn't reach the driver */
+auto GetUniformLocation(uint program, const char *name) -> int
 {
-	return glGetUniformLocation(program, name);
+	if (IsHeadless()) return -1;
+
+	auto &names = s_uniformNames[program];
+	auto known = names.find(name);
+	if (known != names.end()) return known->second;
+
+	int location = FindUniform(program, name);
+	uint current = ResolveProgram(program);
+
+	// Locations are handed out in the first program's numbering. Once it
+	// was reloaded, the redirect to the running program is recorded here,
+	// and uniforms only the reloaded program has get a handle of their own.
+	if (current != program)
+	{
+		int currentLocation = FindUniform(current, name);
+		if (location < 0 && currentLocation >= 0)
+			location = s_addedUniformBase + s_addedUniformCounts[program]++;
+
+		if (location >= 0)
+			s_locationRedirects[program][location] = currentLocation;
+	}
+
+	// Remembered so the location can follow the program through reloads
+	if (location >= 0)
+		names.emplace(name, location);
+
+	return location;
 }
\ No newline at end of file
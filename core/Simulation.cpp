@@ -0,0 +1,220 @@
+#include "SzarkCore.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+using SimulationClock = std::chrono::steady_clock;
+
+static const size_t s_jitterSamples = 240;
+
+/* Rolling window of intervals between events */
+struct IntervalTracker
+{
+	double samples[s_jitterSamples];
+	size_t count, next;
+	uint64_t total;
+	SimulationClock::time_point last;
+};
+
+static double s_tickRate = 0;
+static std::atomic<bool> s_simulationRunning{false};
+static std::thread s_simulationThread;
+
+// Snapshots: one written by the tick, two shared, two read by the renderer
+static std::mutex s_snapshotMutex;
+static std::vector<unsigned char> s_tickSnapshot;
+static std::vector<unsigned char> s_sharedSnapshots[2];
+static std::vector<unsigned char> s_renderSnapshots[2];
+static uint64_t s_publishedTicks = 0;
+static uint64_t s_renderedTicks = 0;
+static uint s_currentShared = 0;
+
+static SimulationClock::time_point s_lastTickTime;
+static double s_interpolation = 0;
+
+static IntervalTracker s_tickIntervals = {};
+static IntervalTracker s_frameIntervals = {};
+static std::mutex s_statsMutex;
+
+/* Records the time since the previous call */
+static void recordInterval(IntervalTracker &tracker, SimulationClock::time_point now)
+{
+	std::lock_guard<std::mutex> lock(s_statsMutex);
+
+	if (tracker.total > 0)
+	{
+		tracker.samples[tracker.next] =
+			std::chrono::duration<double>(now - tracker.last).count();
+		tracker.next = (tracker.next + 1) % s_jitterSamples;
+		tracker.count = std::min(tracker.count + 1, s_jitterSamples);
+	}
+
+	tracker.last = now;
+	tracker.total++;
+}
+
+/* Mean and standard deviation of the tracked intervals */
+static void summarize(const IntervalTracker &tracker, double &mean, double &jitter)
+{
+	mean = jitter = 0;
+	if (tracker.count == 0) return;
+
+	for (size_t i = 0; i < tracker.count; i++)
+		mean += tracker.samples[i];
+	mean /= tracker.count;
+
+	for (size_t i = 0; i < tracker.count; i++)
+		jitter += (tracker.samples[i] - mean) * (tracker.samples[i] - mean);
+	jitter = std::sqrt(jitter / tracker.count);
+}
+
+/* Makes the tick snapshot the newest shared snapshot */
+static void publishSnapshot(SimulationClock::time_point tickTime)
+{
+	std::lock_guard<std::mutex> lock(s_snapshotMutex);
+
+	s_currentShared ^= 1;
+	s_sharedSnapshots[s_currentShared] = s_tickSnapshot;
+
+	// The first tick has nothing before it, so it is the previous state too
+	if (s_publishedTicks == 0)
+		s_sharedSnapshots[s_currentShared ^ 1] = s_tickSnapshot;
+
+	s_lastTickTime = tickTime;
+	s_publishedTicks++;
+}
+
+/* Runs ticks at a fixed rate until the simulation is stopped */
+static void simulationLoop(GLFWwindow *window,
+						   void (*callback)(GLFWwindow *, WindowEvent))
+{
+	auto interval = std::chrono::duration_cast<SimulationClock::duration>(
+		std::chrono::duration<double>(1.0 / s_tickRate));
+	auto next = SimulationClock::now();
+
+	while (s_simulationRunning)
+	{
+		std::this_thread::sleep_until(next);
+
+		auto start = SimulationClock::now();
+		recordInterval(s_tickIntervals, start);
+
+		if (callback)
+			callback(window, WindowEvent::Tick);
+
+		publishSnapshot(start);
+
+		// Drop ticks instead of spiraling when a tick runs long
+		next += interval;
+		if (SimulationClock::now() - next > interval * 4)
+			next = SimulationClock::now();
+	}
+}
+
+/* Starts the fixed rate simulation thread if a tick rate is set */
+auto StartSimulation(GLFWwindow *window,
+					 void (*callback)(GLFWwindow *, WindowEvent)) -> void
+{
+	s_tickIntervals = {};
+	s_frameIntervals = {};
+
+	{
+		std::lock_guard<std::mutex> lock(s_snapshotMutex);
+		s_publishedTicks = s_renderedTicks = 0;
+	}
+
+	if (s_tickRate <= 0 || s_simulationRunning)
+		return;
+
+	s_simulationRunning = true;
+	s_simulationThread = std::thread(simulationLoop, window, callback);
+}
+
+/* Stops the simulation thread and waits for the last tick */
+auto StopSimulation() -> void
+{
+	if (!s_simulationRunning)
+		return;
+
+	s_simulationRunning = false;
+	if (s_simulationThread.joinable())
+		s_simulationThread.join();
+}
+
+/* Called by the render loop before each frame. Pulls the newest pair of
+   snapshots and works out how far the frame is between those ticks. */
+auto BeginRenderFrame() -> void
+{
+	auto now = SimulationClock::now();
+	recordInterval(s_frameIntervals, now);
+
+	if (s_tickRate <= 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(s_snapshotMutex);
+
+	if (s_publishedTicks != s_renderedTicks)
+	{
+		s_renderSnapshots[0] = s_sharedSnapshots[s_currentShared ^ 1];
+		s_renderSnapshots[1] = s_sharedSnapshots[s_currentShared];
+		s_renderedTicks = s_publishedTicks;
+	}
+
+	double sinceTick = std::chrono::duration<double>(now - s_lastTickTime).count();
+	s_interpolation = std::clamp(sinceTick * s_tickRate, 0.0, 1.0);
+}
+
+/* Sets how many simulation ticks run per second, 0 disables the
+   simulation thread. Must be called before the window is shown. */
+auto SetTickRate(double ticksPerSecond) -> void
+{
+	if (s_simulationRunning)
+	{
+		Error("Tick rate can't change while the simulation is running!");
+		return;
+	}
+
+	s_tickRate = ticksPerSecond > 0 ? ticksPerSecond : 0;
+}
+
+/* Sets the size in bytes of the state handed from ticks to frames */
+auto SetSnapshotSize(uint size) -> void
+{
+	std::lock_guard<std::mutex> lock(s_snapshotMutex);
+
+	s_tickSnapshot.assign(size, 0);
+	for (auto &snapshot : s_sharedSnapshots)
+		snapshot.assign(size, 0);
+	for (auto &snapshot : s_renderSnapshots)
+		snapshot.assign(size, 0);
+}
+
+/* The snapshot a tick writes its state into, only valid during a tick */
+auto GetTickSnapshot() -> void *
+{
+	return s_tickSnapshot.empty() ? nullptr : s_tickSnapshot.data();
+}
+
+/* The previous or the newest tick state, stable for the whole frame */
+auto GetRenderSnapshot(bool previous) -> const void *
+{
+	auto &snapshot = s_renderSnapshots[previous ? 0 : 1];
+	return snapshot.empty() ? nullptr : snapshot.data();
+}
+
+/* How far the current frame is between the two render snapshots (0-1) */
+auto GetInterpolation() -> double { return s_interpolation; }
+
+/* Returns tick and frame timing including their jitter */
+auto GetLoopStats() -> LoopStats
+{
+	std::lock_guard<std::mutex> lock(s_statsMutex);
+
+	LoopStats stats = {0};
+	summarize(s_tickIntervals, stats.tickInterval, stats.tickJitter);
+	summarize(s_frameIntervals, stats.frameInterval, stats.frameJitter);
+	stats.ticks = s_tickIntervals.total;
+	stats.frames = s_frameIntervals.total;
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "SzarkCore.h"
+
+struct SoftwareTexture
+{
+	uint width, height;
+	PixelFormat format;
+	std::vector<unsigned char> pixels;
+};
+
+static std::vector<SoftwareTexture> s_textures;
+static std::vector<Color> s_framebuffer;
+
+static uint s_framebufferWidth = 0;
+static uint s_framebufferHeight = 0;
+static uint s_boundTexture = 0;
+
+static Rect s_viewport = {0};
+
+/* Allocates the CPU framebuffer that replaces the window surface */
+auto InitSoftwareFramebuffer(uint width, uint height) -> void
+{
+	s_framebufferWidth = width;
+	s_framebufferHeight = height;
+	s_framebuffer.assign((size_t)width * height, Color{0, 0, 0});
+	s_viewport = {0, 0, (int)width, (int)height};
+}
+
+/* Returns the CPU framebuffer (top row first) */
+auto GetSoftwareFramebuffer(uint *width, uint *height) -> const Color *
+{
+	if (width) *width = s_framebufferWidth;
+	if (height) *height = s_framebufferHeight;
+	return s_framebuffer.data();
+}
+
+/* Creates a CPU-side texture, ids start at 1 like OpenGL */
+auto SoftwareGenerateTexture(const void *pixels, uint width, uint height,
+							 PixelFormat format) -> uint
+{
+	auto bytes = static_cast<const unsigned char *>(pixels);
+	size_t size = (size_t)width * height * PixelSize(format);
+
+	SoftwareTexture texture = {width, height, format};
+	texture.pixels.assign(bytes, bytes + size);
+	s_textures.push_back(std::move(texture));
+	return (uint)s_textures.size();
+}
+
+/* Returns a CPU-side texture or null if the id is invalid */
+static auto getSoftwareTexture(uint id) -> SoftwareTexture *
+{
+	if (id == 0 || id > s_textures.size()) return nullptr;
+	return &s_textures[id - 1];
+}
+
+/* Reads one texel as a color, through the palette if it is indexed */
+static inline Color readTexel(const SoftwareTexture &texture, size_t index)
+{
+	const unsigned char *texel = texture.pixels.data() + index * PixelSize(texture.format);
+
+	if (texture.format == PixelFormat::Indexed8)
+		return GetPaletteColors()[*texel];
+	return {texel[0], texel[1], texel[2]};
+}
+
+/* Copies new pixels into a CPU-side texture */
+auto SoftwareUpdateTexture(uint id, const void *pixels, uint width, uint height) -> void
+{
+	auto texture = getSoftwareTexture(id);
+	if (!texture) return;
+
+	auto bytes = static_cast<const unsigned char *>(pixels);
+	texture->width = width;
+	texture->height = height;
+	texture->pixels.assign(bytes, bytes + (size_t)width * height *
+											  PixelSize(texture->format));
+}
+
+/* Changes the size of a CPU-side texture, keeping its storage */
+auto SoftwareResizeTexture(uint id, uint width, uint height) -> void
+{
+	auto texture = getSoftwareTexture(id);
+	if (!texture) return;
+
+	texture->width = width;
+	texture->height = height;
+	texture->pixels.resize((size_t)width * height * PixelSize(texture->format));
+}
+
+/* Copies only the given regions into a CPU-side texture */
+auto SoftwareUpdateTextureRegions(uint id, const void *pixels, uint width, uint height,
+								  const Rect *regions, uint count) -> void
+{
+	auto texture = getSoftwareTexture(id);
+	if (!texture || texture->width != width || texture->height != height)
+		return;
+
+	auto bytes = static_cast<const unsigned char *>(pixels);
+	size_t pixelSize = PixelSize(texture->format);
+
+	for (uint i = 0; i < count; i++)
+	{
+		int x0 = std::max(regions[i].x, 0);
+		int y0 = std::max(regions[i].y, 0);
+		int x1 = std::min(regions[i].x + regions[i].width, (int)width);
+		int y1 = std::min(regions[i].y + regions[i].height, (int)height);
+
+		for (int y = y0; y < y1 && x0 < x1; y++)
+		{
+			size_t row = (size_t)y * width;
+			std::copy(bytes + (row + x0) * pixelSize, bytes + (row + x1) * pixelSize,
+					  texture->pixels.begin() + (row + x0) * pixelSize);
+		}
+	}
+}
+
+/* Binds a CPU-side texture for the next quad */
+auto SoftwareUseTexture(uint id) -> void
+{
+	s_boundTexture = id;
+}
+
+/* Sets the software viewport, y is measured from the bottom like OpenGL */
+auto SoftwareSetViewport(int x, int y, int w, int h) -> void
+{
+	s_viewport = {x, y, w, h};
+}
+
+/* Scales the bound texture into the viewport with nearest sampling */
+auto SoftwareRenderQuad() -> void
+{
+	auto texture = getSoftwareTexture(s_boundTexture);
+	if (!texture || texture->width == 0 || texture->height == 0) return;
+	if (s_viewport.width <= 0 || s_viewport.height <= 0) return;
+
+	// Convert the bottom-left viewport origin to a top-left one
+	int top = (int)s_framebufferHeight - (s_viewport.y + s_viewport.height);
+	int left = s_viewport.x;
+
+	int x0 = left < 0 ? 0 : left;
+	int y0 = top < 0 ? 0 : top;
+	int x1 = left + s_viewport.width;
+	int y1 = top + s_viewport.height;
+	if (x1 > (int)s_framebufferWidth) x1 = s_framebufferWidth;
+	if (y1 > (int)s_framebufferHeight) y1 = s_framebufferHeight;
+
+	// Source column for every destination column is the same for each row
+	std::vector<uint> columns(x1 > x0 ? x1 - x0 : 0);
+	for (int x = x0; x < x1; x++)
+		columns[x - x0] = (uint)((uint64_t)(x - left) * texture->width /
+								 s_viewport.width);
+
+	for (int y = y0; y < y1; y++)
+	{
+		uint v = (uint)((uint64_t)(y - top) * texture->height /
+						s_viewport.height);
+		size_t src = (size_t)v * texture->width;
+		Color *dst = &s_framebuffer[(size_t)y * s_framebufferWidth];
+
+		for (int x = x0; x < x1; x++)
+			dst[x] = readTexel(*texture, src + columns[x - x0]);
+	}
+}
+
+/* Draws sprites into the viewport with nearest sampling, in order */
+auto SoftwareRenderSprites(uint atlas, const SpriteInstance *sprites,
+						   uint count, uint screenWidth, uint screenHeight,
+						   Color colorKey, bool colorKeyEnabled) -> void
+{
+	auto texture = getSoftwareTexture(atlas);
+	if (!texture || screenWidth == 0 || screenHeight == 0) return;
+
+	double scaleX = (double)s_viewport.width / screenWidth;
+	double scaleY = (double)s_viewport.height / screenHeight;
+	int top = (int)s_framebufferHeight - (s_viewport.y + s_viewport.height);
+
+	for (uint i = 0; i < count; i++)
+	{
+		const auto &sprite = sprites[i];
+		if (sprite.width <= 0 || sprite.height <= 0) continue;
+
+		int x0 = (int)std::ceil(s_viewport.x + sprite.x * scaleX - 0.5);
+		int y0 = (int)std::ceil(top + sprite.y * scaleY - 0.5);
+		int x1 = (int)std::ceil(s_viewport.x + (sprite.x + sprite.width) * scaleX - 0.5);
+		int y1 = (int)std::ceil(top + (sprite.y + sprite.height) * scaleY - 0.5);
+
+		x0 = std::max(x0, 0), y0 = std::max(y0, 0);
+		x1 = std::min(x1, (int)s_framebufferWidth);
+		y1 = std::min(y1, (int)s_framebufferHeight);
+
+		for (int y = y0; y < y1; y++)
+		{
+			// Sample at the pixel center like the rasterizer would
+			double localY = ((y + 0.5 - top) / scaleY - sprite.y) / sprite.height;
+			int v = (int)std::floor(sprite.v + localY * sprite.vHeight);
+			if (v < 0 || v >= (int)texture->height) continue;
+
+			for (int x = x0; x < x1; x++)
+			{
+				double localX = ((x + 0.5 - s_viewport.x) / scaleX - sprite.x) / sprite.width;
+				int u = (int)std::floor(sprite.u + localX * sprite.uWidth);
+				if (u < 0 || u >= (int)texture->width) continue;
+
+				size_t index = (size_t)v * texture->width + u;
+				if (texture->format == PixelFormat::RGBA32 &&
+					texture->pixels[index * 4 + 3] < 128)
+					continue;
+
+				Color texel = readTexel(*texture, index);
+				if (colorKeyEnabled && texel.r == colorKey.r &&
+					texel.g == colorKey.g && texel.b == colorKey.b)
+					continue;
+
+				s_framebuffer[(size_t)y * s_framebufferWidth + x] = {
+					(unsigned char)(texel.r * sprite.r / 255),
+					(unsigned char)(texel.g * sprite.g / 255),
+					(unsigned char)(texel.b * sprite.b / 255)};
+			}
+		}
+	}
+}
\ No newline at end of file
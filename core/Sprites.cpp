@@ -0,0 +1,231 @@
+#include "SzarkCore.h"
+
+#include <cstddef>
+#include <map>
+
+static bool s_spritesInitialized = false;
+
+static uint s_spriteProgram;
+static uint s_spriteVAO;
+static uint s_spriteInstanceVBO;
+static size_t s_spriteInstanceCapacity = 0;
+
+static int s_screenSizeLocation = -1;
+static int s_colorKeyLocation = -1;
+static int s_indexedLocation = -1;
+
+static Color s_colorKey = {255, 0, 255};
+static bool s_colorKeyEnabled = true;
+
+// Pending sprites bucketed by atlas, so each atlas is one draw call
+static std::map<uint, std::vector<SpriteInstance>> s_spriteBatches;
+
+static const float s_spriteCorners[] = {
+	0.0, 0.0,
+	1.0, 0.0,
+	1.0, 1.0,
+	0.0, 1.0};
+
+static const uint s_spriteIndices[] = {
+	0, 1, 2, 0, 2, 3};
+
+static const char *s_spriteVertexShader =
+	"#version 420\n"
+	"layout(location = 0) in vec2 corner;"
+	"layout(location = 2) in vec4 rect;"
+	"layout(location = 3) in vec4 source;"
+	"layout(location = 4) in vec4 tint;"
+	"layout(location = 5) in float depth;"
+	"uniform vec2 screenSize;"
+	"uniform sampler2D atlas;"
+	"out vec2 texCoord;"
+	"out vec3 color;"
+	"void main() {"
+	"	vec2 pos = (rect.xy + corner * rect.zw) / screenSize * 2.0 - 1.0;"
+	"	texCoord = (source.xy + corner * source.zw) / vec2(textureSize(atlas, 0));"
+	"	color = tint.rgb;"
+	"	gl_Position = vec4(pos.x, -pos.y, depth * 2.0 - 1.0, 1.0);"
+	"}";
+
+static const char *s_spriteFragmentShader =
+	"#version 420\n"
+	"out vec4 FragColor;"
+	"in vec2 texCoord;"
+	"in vec3 color;"
+	"uniform sampler2D atlas;"
+	"layout(binding = 1) uniform sampler2D palette;"
+	"uniform bool indexed;"
+	"uniform vec4 colorKey;"
+	"void main() {"
+	"	vec4 sampled = texture(atlas, texCoord);"
+	"	if (sampled.a < 0.5)"
+	"		discard;"
+	"	vec3 texel = sampled.rgb;"
+	"	if (indexed)"
+	"		texel = texelFetch(palette, ivec2(texel.r * 255.0 + 0.5, 0), 0).rgb;"
+	"	if (colorKey.a > 0.5 && all(lessThan(abs(texel - colorKey.rgb), vec3(0.002))))"
+	"		discard;"
+	"	FragColor = vec4(texel * color, 1.0);"
+	"}";
+
+/* Creates the sprite shader and the instanced quad */
+auto InitSpriteRenderer() -> bool
+{
+	if (IsHeadless())
+	{
+		s_spritesInitialized = true;
+		return true;
+	}
+
+	s_spriteProgram = CompileShader(s_spriteVertexShader,
+									s_spriteFragmentShader);
+	if (s_spriteProgram == 0)
+		return false;
+
+	s_screenSizeLocation = glGetUniformLocation(s_spriteProgram, "screenSize");
+	s_colorKeyLocation = glGetUniformLocation(s_spriteProgram, "colorKey");
+	s_indexedLocation = glGetUniformLocation(s_spriteProgram, "indexed");
+
+	glGenVertexArrays(1, &s_spriteVAO);
+	glBindVertexArray(s_spriteVAO);
+
+	uint cornerVBO = 0;
+	glGenBuffers(1, &cornerVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, cornerVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(s_spriteCorners),
+				 &s_spriteCorners, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, false, 8, 0);
+	glEnableVertexAttribArray(0);
+
+	uint ebo = 0;
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(s_spriteIndices),
+				 &s_spriteIndices, GL_STATIC_DRAW);
+
+	// Every other attribute advances once per sprite
+	glGenBuffers(1, &s_spriteInstanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, s_spriteInstanceVBO);
+
+	const int stride = sizeof(SpriteInstance);
+	glVertexAttribPointer(2, 4, GL_FLOAT, false, stride,
+						  (void *)offsetof(SpriteInstance, x));
+	glVertexAttribPointer(3, 4, GL_FLOAT, false, stride,
+						  (void *)offsetof(SpriteInstance, u));
+	glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, true, stride,
+						  (void *)offsetof(SpriteInstance, r));
+	glVertexAttribPointer(5, 1, GL_FLOAT, false, stride,
+						  (void *)offsetof(SpriteInstance, depth));
+
+	for (uint attribute = 2; attribute <= 5; attribute++)
+	{
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+
+	glBindVertexArray(0);
+	s_spritesInitialized = true;
+	return true;
+}
+
+/* Queues sprites from one atlas texture for the next RenderSprites */
+auto SubmitSprites(uint atlas, const SpriteInstance *sprites, uint count) -> void
+{
+	if (atlas == 0 || sprites == nullptr || count == 0)
+		return;
+
+	auto &batch = s_spriteBatches[atlas];
+	batch.insert(batch.end(), sprites, sprites + count);
+}
+
+/* Sets the atlas color that is treated as transparent */
+auto SetSpriteColorKey(Color key, bool enabled) -> void
+{
+	s_colorKey = key;
+	s_colorKeyEnabled = enabled;
+}
+
+/* Draws every queued sprite with one instanced draw per atlas, using
+   the depth buffer for ordering so batches never need to be split.
+   Sprite positions are in pixels of a screen of the given size. */
+auto RenderSprites(uint screenWidth, uint screenHeight) -> void
+{
+	if (!s_spritesInitialized)
+	{
+		Error("Renderer must be initialized to render sprites!");
+		return;
+	}
+
+	ProfileScope zone(CoreZone::Draw, true);
+
+	if (IsHeadless())
+	{
+		// Without a depth buffer sprites are painted back to front
+		std::vector<std::pair<uint, SpriteInstance>> sprites;
+		for (auto &[atlas, batch] : s_spriteBatches)
+			for (auto &sprite : batch)
+				sprites.push_back({atlas, sprite});
+
+		std::stable_sort(sprites.begin(), sprites.end(),
+						 [](auto &a, auto &b) { return a.second.depth > b.second.depth; });
+
+		for (auto &[atlas, sprite] : sprites)
+			SoftwareRenderSprites(atlas, &sprite, 1, screenWidth, screenHeight,
+								  s_colorKey, s_colorKeyEnabled);
+
+		s_spriteBatches.clear();
+		return;
+	}
+
+	size_t total = 0;
+	for (auto &[atlas, batch] : s_spriteBatches)
+		total += batch.size();
+
+	if (total == 0)
+		return;
+
+	// Orphan the instance buffer so the previous frame's draws aren't stalled
+	glBindBuffer(GL_ARRAY_BUFFER, s_spriteInstanceVBO);
+	s_spriteInstanceCapacity = std::max(s_spriteInstanceCapacity, total);
+	glBufferData(GL_ARRAY_BUFFER,
+				 s_spriteInstanceCapacity * sizeof(SpriteInstance),
+				 nullptr, GL_STREAM_DRAW);
+
+	size_t offset = 0;
+	for (auto &[atlas, batch] : s_spriteBatches)
+	{
+		if (batch.empty()) continue;
+		glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(SpriteInstance),
+						batch.size() * sizeof(SpriteInstance), batch.data());
+		offset += batch.size();
+	}
+
+	glUseProgram(s_spriteProgram);
+	glUniform2f(s_screenSizeLocation, (float)screenWidth, (float)screenHeight);
+	glUniform4f(s_colorKeyLocation, s_colorKey.r / 255.0f,
+				s_colorKey.g / 255.0f, s_colorKey.b / 255.0f,
+				s_colorKeyEnabled ? 1.0f : 0.0f);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glBindVertexArray(s_spriteVAO);
+
+	offset = 0;
+	for (auto &[atlas, batch] : s_spriteBatches)
+	{
+		if (batch.empty()) continue;
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		glUniform1i(s_indexedLocation, GetTextureFormat(atlas) == PixelFormat::Indexed8);
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_INT,
+											0, (int)batch.size(), (uint)offset);
+		offset += batch.size();
+	}
+
+	glBindVertexArray(0);
+	glDisable(GL_DEPTH_TEST);
+
+	// Keep the allocations around for the next frame
+	for (auto &[atlas, batch] : s_spriteBatches)
+		batch.clear();
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include "SzarkCore.h"
+
+#include <cstring>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+static const uint s_ringSize = 3;
+static const size_t s_pixelAlignment = 64;
+
+/* The width and height are the size in use, up to the storage size it
+   was created with */
+struct StreamingTexture
+{
+	uint texture, width, height, pixelSize;
+	unsigned char *pixels;
+	uint storageWidth, storageHeight;
+
+	// Ring of pixel unpack buffers, one is filled while the others upload
+	uint buffers[s_ringSize];
+	void *mapped[s_ringSize];
+	GLsync fences[s_ringSize];
+	uint next;
+};
+
+static std::unordered_map<uint, StreamingTexture> s_streamingTextures;
+
+/* Whether buffers can stay mapped while OpenGL reads from them */
+static bool supportsPersistentMapping()
+{
+	return GLAD_GL_VERSION_4_4 && glBufferStorage != nullptr;
+}
+
+/* Checks whether OpenGL is done reading from a ring slot without
+   waiting. Returns false when the slot may still be in use: while the
+   fence hasn't signaled, which keeps it for next time, or when the check
+   failed and the fence can't tell anything anymore, which drops it. */
+static bool waitForSlot(StreamingTexture &stream, uint slot)
+{
+	if (!stream.fences[slot]) return true;
+
+	// Three frames later this is almost always already signaled
+	GLenum status = glClientWaitSync(stream.fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (status == GL_TIMEOUT_EXPIRED) return false;
+
+	glDeleteSync(stream.fences[slot]);
+	stream.fences[slot] = nullptr;
+	return status != GL_WAIT_FAILED;
+}
+
+/* Creates a texture whose pixels are owned by the core in aligned memory
+   and streamed to the graphics card through a ring of unpack buffers */
+auto CreateStreamingTexture(uint width, uint height, PixelFormat format) -> uint
+{
+	if (width == 0 || height == 0)
+		return 0;
+
+	uint pixelSize = PixelSize(format);
+	size_t size = (size_t)width * height * pixelSize;
+	auto pixels = static_cast<unsigned char *>(::operator new(
+		size, std::align_val_t(s_pixelAlignment)));
+	std::fill(pixels, pixels + size, 0);
+
+	StreamingTexture stream = {0, width, height, pixelSize, pixels, width, height};
+	stream.texture = GenerateTextureID(pixels, width, height, format);
+
+	if (stream.texture == 0)
+	{
+		::operator delete(pixels, std::align_val_t(s_pixelAlignment));
+		return 0;
+	}
+
+	if (!IsHeadless())
+	{
+		bool persistent = supportsPersistentMapping();
+		glGenBuffers(s_ringSize, stream.buffers);
+
+		for (uint i = 0; i < s_ringSize; i++)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stream.buffers[i]);
+
+			if (persistent)
+			{
+				GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+								   GL_MAP_COHERENT_BIT;
+				glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+				stream.mapped[i] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+													0, size, flags);
+			}
+			else
+			{
+				glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr,
+							 GL_STREAM_DRAW);
+			}
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	s_streamingTextures[stream.texture] = stream;
+	return stream.texture;
+}
+
+/* Returns the core-owned pixels of a streaming texture */
+auto GetStreamingPixels(uint id) -> void *
+{
+	auto it = s_streamingTextures.find(id);
+	return it == s_streamingTextures.end() ? nullptr : it->second.pixels;
+}
+
+/* Scales the pixels of a streaming texture to a new size with nearest
+   neighbour sampling, in place when both sides grow or both shrink */
+static void resamplePixels(StreamingTexture &stream, uint width, uint height)
+{
+	uint oldWidth = stream.width, oldHeight = stream.height;
+	uint pixelSize = stream.pixelSize;
+	unsigned char *pixels = stream.pixels;
+
+	std::vector<unsigned char> copy;
+	const unsigned char *source = pixels;
+
+	bool shrinking = width <= oldWidth && height <= oldHeight;
+	bool growing = width >= oldWidth && height >= oldHeight;
+	if (!shrinking && !growing)
+	{
+		copy.assign(pixels, pixels + (size_t)oldWidth * oldHeight * pixelSize);
+		source = copy.data();
+	}
+
+	// Growing reads behind where it writes and shrinking ahead of it
+	auto copyPixel = [&](uint x, uint y) {
+		size_t sx = (uint64_t)x * oldWidth / width, sy = (uint64_t)y * oldHeight / height;
+		memmove(pixels + ((size_t)y * width + x) * pixelSize,
+				source + (sy * oldWidth + sx) * pixelSize, pixelSize);
+	};
+
+	if (growing)
+	{
+		for (uint y = height; y-- > 0;)
+			for (uint x = width; x-- > 0;)
+				copyPixel(x, y);
+	}
+	else
+	{
+		for (uint y = 0; y < height; y++)
+			for (uint x = 0; x < width; x++)
+				copyPixel(x, y);
+	}
+}
+
+/* Changes how many pixels of a streaming texture are used, without
+   reallocating anything, up to the size it was created with. The pixels
+   are scaled to the new size so the image stays in place until it is
+   drawn again. */
+auto ResizeStreamingTexture(uint id, uint width, uint height) -> bool
+{
+	auto it = s_streamingTextures.find(id);
+	if (it == s_streamingTextures.end()) return false;
+
+	auto &stream = it->second;
+	if (width == 0 || height == 0 || width > stream.storageWidth ||
+		height > stream.storageHeight)
+		return false;
+
+	if (width != stream.width || height != stream.height)
+		resamplePixels(stream, width, height);
+
+	stream.width = width;
+	stream.height = height;
+	SetTextureRegion(id, width, height);
+
+	if (IsHeadless())
+		SoftwareResizeTexture(id, width, height);
+	return true;
+}
+
+/* Copies the changed regions into the next buffer in the ring and starts
+   an asynchronous upload from it. The previous uploads can still be in
+   flight while the next frame is drawn into the pixels. */
+auto StreamTextureRegions(uint id, const Rect *regions, uint count) -> void
+{
+	auto it = s_streamingTextures.find(id);
+	if (it == s_streamingTextures.end() || regions == nullptr || count == 0)
+		return;
+
+	auto &stream = it->second;
+	ProfileScope zone(CoreZone::Upload, true);
+
+	if (IsHeadless())
+	{
+		SoftwareUpdateTextureRegions(id, stream.pixels, stream.width,
+									 stream.height, regions, count);
+		return;
+	}
+
+	uint slot = stream.next;
+	stream.next = (stream.next + 1) % s_ringSize;
+
+	// A slot still being read is left alone, the regions go straight
+	// from the pixels instead, which waits inside the driver if it must
+	if (!waitForSlot(stream, slot))
+	{
+		UploadTextureRegions(id, stream.pixels, stream.width, regions, count);
+		return;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stream.buffers[slot]);
+
+	size_t size = (size_t)stream.width * stream.height * stream.pixelSize;
+	auto dst = static_cast<unsigned char *>(stream.mapped[slot]);
+
+	// The fence already guarantees the slot is idle
+	if (!dst)
+		dst = static_cast<unsigned char *>(glMapBufferRange(
+			GL_PIXEL_UNPACK_BUFFER, 0, size,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+
+	if (!dst)
+	{
+		Error("Failed to map pixel unpack buffer!");
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return;
+	}
+
+	for (uint i = 0; i < count; i++)
+	{
+		int x0 = std::max(regions[i].x, 0);
+		int y0 = std::max(regions[i].y, 0);
+		int x1 = std::min(regions[i].x + regions[i].width, (int)stream.width);
+		int y1 = std::min(regions[i].y + regions[i].height, (int)stream.height);
+
+		size_t span = (size_t)(x1 - x0) * stream.pixelSize;
+		for (int y = y0; y < y1 && x0 < x1; y++)
+		{
+			size_t offset = ((size_t)y * stream.width + x0) * stream.pixelSize;
+			std::copy_n(stream.pixels + offset, span, dst + offset);
+		}
+	}
+
+	if (!stream.mapped[slot])
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	// With the buffer bound the regions upload without blocking
+	UploadTextureRegions(id, nullptr, stream.width, regions, count);
+
+	stream.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/* Frees the pixels, buffers and texture of a streaming texture */
+auto DestroyStreamingTexture(uint id) -> void
+{
+	auto it = s_streamingTextures.find(id);
+	if (it == s_streamingTextures.end())
+		return;
+
+	auto &stream = it->second;
+
+	if (!IsHeadless())
+	{
+		for (uint i = 0; i < s_ringSize; i++)
+		{
+			// Deleting buffers OpenGL still reads from is deferred anyway
+			if (!waitForSlot(stream, i))
+				glDeleteSync(stream.fences[i]);
+
+			if (stream.mapped[i])
+			{
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stream.buffers[i]);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(s_ringSize, stream.buffers);
+		glDeleteTextures(1, &stream.texture);
+	}
+
+	::operator delete(stream.pixels, std::align_val_t(s_pixelAlignment));
+	s_streamingTextures.erase(it);
+}
\ No newline at end of file
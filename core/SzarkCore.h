@@ -1,7 +1,16 @@
 #pragma once
 
+#ifdef _WIN32
 #define EXPORT __declspec(dllexport)
+#else
+#define EXPORT __attribute__((visibility("default")))
+#endif
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -18,6 +27,7 @@ enum class WindowEvent
 	Opened,
 	Closed,
 	Render,
+	Tick,
 };
 
 struct Point
@@ -36,42 +46,348 @@ struct Color
 {
 	unsigned char r, g, b;
 };
+struct Color32
+{
+	unsigned char r, g, b, a;
+};
+struct SpriteInstance
+{
+	float x, y, width, height;
+	float u, v, uWidth, vHeight;
+	unsigned char r, g, b, a;
+	float depth;
+};
+struct LoopStats
+{
+	double tickInterval, tickJitter;
+	double frameInterval, frameJitter;
+	uint64_t ticks, frames;
+};
+struct ProfileStats
+{
+	uint64_t count;
+	double min, average, p99, last;
+};
+struct JobStats
+{
+	uint64_t jobs, steals;
+	double busyTime;
+};
+struct ResolutionSample
+{
+	double renderTime, averageRenderTime;
+	float scale;
+};
+struct QueryChunk
+{
+	uint count;
+	const uint64_t *entities;
+};
+struct EntityPair
+{
+	uint64_t a, b;
+};
+struct BroadphaseRay
+{
+	float x, y, dx, dy, maxDistance;
+};
+struct BroadphaseHit
+{
+	uint64_t entity;
+	float distance, x, y, normalX, normalY;
+};
+struct TileHit
+{
+	float distance, u;
+	int cellX, cellY, side;
+	uint tile;
+};
+struct BroadphaseStats
+{
+	uint items, largeItems, cellEntries;
+	uint64_t candidatePairs, pairs;
+	double buildTime;
+};
+struct CaptureStats
+{
+	uint64_t frames, written, dropped, bytes;
+	uint queued, peakQueued, capacity;
+};
+struct MixerStats
+{
+	uint voices, activeVoices, peakVoices;
+	uint64_t steals, dropped, underruns, blocks;
+	double mixTime, averageMixTime;
+};
+struct MappedFile
+{
+	const unsigned char *data;
+	size_t size;
+	void *handle, *mapping;
+};
+struct WaveInfo
+{
+	int format;
+	uint frequency, blockAlign;
+	uint64_t offset, size;
+};
 struct AudioClip
 {
 	uint source, buffer;
 };
 
+enum class InputEventType : uint
+{
+	Key,
+	Mouse,
+	Scroll,
+	Cursor,
+};
+
+/* A window event stamped with GetInputTime. Keys and buttons use the
+   code, action and mods, the cursor and scroll use x and y. */
+struct InputEvent
+{
+	double time, x, y;
+	InputEventType type;
+	int code, action, mods;
+};
+struct InputStats
+{
+	uint64_t events, dropped;
+	double latency, worstLatency;
+};
+
+/* How the pixels of a texture are stored. Indexed pixels are looked up
+   in the palette when drawn, colors written to them use red as index. */
+enum class PixelFormat : uint
+{
+	RGB24,
+	RGBA32,
+	Indexed8,
+};
+
+/* Zones the core itself records while profiling */
+enum class CoreZone : uint
+{
+	Frame,
+	Poll,
+	Render,
+	Upload,
+	Draw,
+	Swap,
+	Capture,
+};
+
+/* How captured frames are written to disk */
+enum class CaptureFormat : uint
+{
+	Y4M,
+	PPM,
+	Delta,
+};
+
+/* Times the enclosing scope on the CPU, and on the GPU when asked */
+struct ProfileScope
+{
+	ProfileScope(CoreZone zone, bool gpu = false);
+	~ProfileScope();
+	bool active, gpu;
+};
+
 auto Error(const char *msg) -> void;
 auto InitDefaultShader() -> bool;
+auto InitSpriteRenderer() -> bool;
+auto IsHeadless() -> bool;
+auto StartSimulation(GLFWwindow *window,
+					 void (*callback)(GLFWwindow *, WindowEvent)) -> void;
+auto StopSimulation() -> void;
+auto BeginRenderFrame() -> void;
+auto StopShaderReload() -> void;
+auto BeginProfilerFrame() -> void;
+auto DispatchKeyEvent(int key, int action, int mods) -> void;
+auto DispatchCursorEvent(double x, double y) -> void;
+auto DispatchMouseEvent(int button, int action, int mods) -> void;
+auto DispatchScrollEvent(double dx, double dy) -> void;
+auto PresentInputFrame() -> void;
+auto UpdateRenderScale(double renderTime) -> void;
+auto CaptureFrame() -> void;
+auto FinishCapture() -> void;
+auto IsInputThreaded() -> bool;
+auto ResolveProgram(uint id) -> uint;
+auto ReflectProgram(uint program) -> void;
+auto ForgetProgram(uint program) -> void;
+auto FindUniform(uint program, const char *name) -> int;
+auto RebindParameterBlocks(uint id, uint program) -> void;
+auto RunJobs(uint count, const std::function<void(uint, uint)> &batch) -> void;
+auto MapFile(const char *path, MappedFile &file) -> bool;
+auto UnmapFile(MappedFile &file) -> void;
+auto PixelSize(PixelFormat format) -> uint;
+auto GetTextureFormat(uint id) -> PixelFormat;
+auto SetTextureRegion(uint id, uint width, uint height) -> void;
+auto GetPaletteColors() -> const Color *;
+auto SetDefaultShaderIndexed(bool indexed) -> void;
+auto UploadTextureRegions(uint id, const void *pixels, uint width,
+						  const Rect *regions, uint count) -> void;
+
+auto InitSoftwareFramebuffer(uint width, uint height) -> void;
+auto GetSoftwareFramebuffer(uint *width, uint *height) -> const Color *;
+auto SoftwareGenerateTexture(const void *pixels, uint width, uint height,
+							 PixelFormat format) -> uint;
+auto SoftwareUpdateTexture(uint id, const void *pixels, uint width, uint height) -> void;
+auto SoftwareResizeTexture(uint id, uint width, uint height) -> void;
+auto SoftwareUpdateTextureRegions(uint id, const void *pixels, uint width, uint height,
+								  const Rect *regions, uint count) -> void;
+auto SoftwareUseTexture(uint id) -> void;
+auto SoftwareSetViewport(int x, int y, int w, int h) -> void;
+auto SoftwareRenderQuad() -> void;
+auto SoftwareRenderSprites(uint atlas, const SpriteInstance *sprites,
+						   uint count, uint screenWidth, uint screenHeight,
+						   Color colorKey, bool colorKeyEnabled) -> void;
 
 extern "C"
 {
 	EXPORT auto SetErrorCallback(void (*c)(const char *m)) -> void;
 	EXPORT auto SetWindowEventCallback(void (*c)(GLFWwindow *w, WindowEvent e)) -> void;
 
-	EXPORT auto SetScrollCallback(void (*c)(double dx, double dy));
-	EXPORT auto SetMouseCallback(void (*c)(int button, int action));
-	EXPORT auto SetKeyCallback(void (*c)(int key, int action));
-	EXPORT auto SetCursorCallback(void (*c)(double x, double y));
+	EXPORT auto DrainInputEvents(InputEvent *events, uint capacity) -> uint;
+	EXPORT auto GetInputTime() -> double;
+	EXPORT auto GetInputStats() -> InputStats;
+	EXPORT auto SetInputThread(bool enabled) -> void;
 
 	EXPORT auto Show(GLFWwindow *window) -> void;
 	EXPORT auto Create(const char *, uint, uint, bool) -> GLFWwindow *;
 	EXPORT auto Close(GLFWwindow *window) -> void;
+	EXPORT auto ShowHeadless(uint width, uint height, uint frames,
+							 double fixedStep) -> void;
+
+	EXPORT auto SetTickRate(double ticksPerSecond) -> void;
+	EXPORT auto SetSnapshotSize(uint size) -> void;
+	EXPORT auto GetTickSnapshot() -> void *;
+	EXPORT auto GetRenderSnapshot(bool previous) -> const void *;
+	EXPORT auto GetInterpolation() -> double;
+	EXPORT auto GetLoopStats() -> LoopStats;
+
+	EXPORT auto SetResolutionScaling(double frameBudget, float minScale,
+									 float maxScale) -> void;
+	EXPORT auto GetRenderScale() -> float;
+	EXPORT auto GetResolutionHistory(ResolutionSample *samples, uint capacity) -> uint;
+
+	EXPORT auto SetProfilerEnabled(bool enabled) -> void;
+	EXPORT auto IsProfilerEnabled() -> bool;
+	EXPORT auto RegisterProfileZone(const char *name) -> uint;
+	EXPORT auto GetProfileZoneCount() -> uint;
+	EXPORT auto GetProfileZoneName(uint zone) -> const char *;
+	EXPORT auto BeginProfileZone(uint zone) -> void;
+	EXPORT auto EndProfileZone() -> void;
+	EXPORT auto GetProfileStats(uint zone, bool gpu) -> ProfileStats;
+	EXPORT auto SaveProfileTrace(const char *path) -> bool;
+
+	EXPORT auto InitializeJobSystem(uint workers) -> void;
+	EXPORT auto GetWorkerCount() -> uint;
+	EXPORT auto DispatchJobs(uint count,
+							 void (*job)(uint index, uint worker)) -> void;
+	EXPORT auto DispatchTiles(uint width, uint height, uint tileSize,
+							  void (*tile)(const Rect *tile, uint worker)) -> void;
+	EXPORT auto GetJobStats(JobStats *stats, uint count) -> double;
+	EXPORT auto ResetJobStats() -> void;
+
+	EXPORT auto RegisterComponent(uint size, uint alignment) -> int;
+	EXPORT auto CreateEntity() -> uint64_t;
+	EXPORT auto DestroyEntity(uint64_t entity) -> bool;
+	EXPORT auto IsEntityAlive(uint64_t entity) -> bool;
+	EXPORT auto GetEntityCount() -> uint;
+	EXPORT auto AddComponent(uint64_t entity, uint component,
+							 const void *data) -> bool;
+	EXPORT auto RemoveComponent(uint64_t entity, uint component) -> bool;
+	EXPORT auto HasComponent(uint64_t entity, uint component) -> bool;
+	EXPORT auto GetComponent(uint64_t entity, uint component) -> void *;
+	EXPORT auto QueryChunks(uint64_t all, uint64_t none, const uint *columns,
+							uint columnCount, QueryChunk *chunks,
+							void **columnPointers, uint capacity) -> uint;
+
+	EXPORT auto CreateBroadphase(float cellSize) -> uint;
+	EXPORT auto DestroyBroadphase(uint broadphase) -> void;
+	EXPORT auto ClearBroadphase(uint broadphase) -> void;
+	EXPORT auto InsertBroadphase(uint broadphase, const uint64_t *entities,
+								 const void *bounds, uint stride, uint count) -> void;
+	EXPORT auto BuildBroadphase(uint broadphase) -> void;
+	EXPORT auto FindBroadphasePairs(uint broadphase, EntityPair *pairs,
+									uint capacity) -> uint;
+	EXPORT auto QueryBroadphasePoint(uint broadphase, float x, float y,
+									 uint64_t *entities, uint capacity) -> uint;
+	EXPORT auto QueryBroadphaseRect(uint broadphase, float x, float y, float width,
+									float height, uint64_t *entities,
+									uint capacity) -> uint;
+	EXPORT auto RaycastBroadphase(uint broadphase, const BroadphaseRay *rays,
+								  uint count, BroadphaseHit *hits) -> uint;
+	EXPORT auto GetBroadphaseStats(uint broadphase) -> BroadphaseStats;
+
+	EXPORT auto CreateTileGrid(uint width, uint height) -> uint;
+	EXPORT auto DestroyTileGrid(uint grid) -> void;
+	EXPORT auto SetTiles(uint grid, int x, int y, uint width, uint height,
+						 const unsigned char *tiles) -> void;
+	EXPORT auto GetTile(uint grid, int x, int y) -> unsigned char;
+	EXPORT auto CastTileRays(uint grid, float x, float y, const float *directions,
+							 uint count, float maxDistance, TileHit *hits) -> uint;
+
+	EXPORT auto GenerateTextureID(const void *pixels, uint width, uint height,
+								  PixelFormat format) -> uint;
+	EXPORT auto UpdateTexture(uint, const void *, uint, uint) -> void;
+	EXPORT auto UpdateTextureRegions(uint id, const void *pixels, uint width,
+									 uint height, const Rect *regions,
+									 uint count) -> void;
+	EXPORT auto SetPalette(const Color *colors, uint first, uint count) -> void;
+	EXPORT auto SetTextureFilter(uint id, bool linear) -> void;
 
-	EXPORT auto GenerateTextureID(Color *, uint, uint) -> uint;
-	EXPORT auto UpdateTexture(uint, Color *, uint, uint) -> void;
+	EXPORT auto CreateStreamingTexture(uint width, uint height,
+									   PixelFormat format) -> uint;
+	EXPORT auto GetStreamingPixels(uint id) -> void *;
+	EXPORT auto ResizeStreamingTexture(uint id, uint width, uint height) -> bool;
+	EXPORT auto StreamTextureRegions(uint id, const Rect *regions,
+									 uint count) -> void;
+	EXPORT auto DestroyStreamingTexture(uint id) -> void;
 
 	EXPORT auto UseShader(uint) -> void;
 	EXPORT auto UseDefaultShader() -> void;
 	EXPORT auto UseTexture(uint) -> void;
 	EXPORT auto RenderQuad() -> void;
 
+	EXPORT auto CreateBitmapFont(const unsigned char *coverage, uint glyphWidth,
+								 uint glyphHeight, uint first, uint count) -> uint;
+	EXPORT auto DestroyFont(uint font) -> void;
+	EXPORT auto GetFontSize(uint font, uint *glyphWidth, uint *glyphHeight) -> bool;
+	EXPORT auto MeasureText(uint font, const char *text, int spacing) -> uint;
+	EXPORT auto CanvasDrawText(void *target, PixelFormat format, uint width,
+							   uint height, uint font, const char *text, int x,
+							   int y, Color color, int spacing, bool cache,
+							   float scale) -> uint;
+	EXPORT auto SubmitText(uint font, const char *text, float x, float y,
+						   float scale, Color color, int spacing,
+						   float depth) -> void;
+
+	EXPORT auto SubmitSprites(uint atlas, const SpriteInstance *sprites,
+							  uint count) -> void;
+	EXPORT auto SetSpriteColorKey(Color key, bool enabled) -> void;
+	EXPORT auto RenderSprites(uint screenWidth, uint screenHeight) -> void;
+
 	EXPORT auto GetDeltaTime() -> double;
+	EXPORT auto GetFrameCount() -> uint64_t;
 	EXPORT auto CompileShader(const char *, const char *) -> uint;
+	EXPORT auto SetShaderCacheDirectory(const char *path) -> void;
+	EXPORT auto WatchShader(uint id, const char *vertexPath,
+							const char *fragmentPath) -> bool;
 	EXPORT auto InitializeRenderer() -> void;
 
 	EXPORT auto GetPrimaryMonitorRect() -> Rect;
 	EXPORT auto SetViewport(int, int, int, int) -> void;
+	EXPORT auto ReadFramebuffer(Color *pixels, uint width, uint height) -> bool;
+	EXPORT auto SaveFramebuffer(const char *path) -> bool;
+	EXPORT auto StartCapture(const char *path, CaptureFormat format, uint frameRate,
+							 uint queueFrames) -> bool;
+	EXPORT auto StopCapture() -> void;
+	EXPORT auto IsCapturing() -> bool;
+	EXPORT auto GetCaptureStats() -> CaptureStats;
 
 	EXPORT auto InitializeAudioContext() -> void;
 	EXPORT auto PlayAudioClip(uint, int, bool) -> void;
@@ -80,6 +396,25 @@ extern "C"
 								uint length, uint freq) -> AudioClip;
 	EXPORT auto DestroyAudioClip(AudioClip clip) -> void;
 
+	EXPORT auto OpenAudioStream(const char *path) -> uint;
+	EXPORT auto PlayAudioStream(uint id, float volume, bool loop) -> void;
+	EXPORT auto StopAudioStream(uint id) -> void;
+	EXPORT auto IsAudioStreamPlaying(uint id) -> bool;
+	EXPORT auto GetAudioStreamLength(uint id) -> double;
+	EXPORT auto CloseAudioStream(uint id) -> void;
+	EXPORT auto ReadWaveInfo(const void *wave, uint64_t size, WaveInfo *info) -> bool;
+
+	EXPORT auto InitializeMixer(uint voices) -> void;
+	EXPORT auto CreateSound(int format, const char *buffer,
+							uint length, uint freq) -> uint;
+	EXPORT auto DestroySound(uint sound) -> void;
+	EXPORT auto StartVoice(uint sound, float volume, float pan,
+						  int priority) -> uint;
+	EXPORT auto SetVoiceGain(uint voice, float volume, float pan) -> void;
+	EXPORT auto StopVoice(uint voice) -> void;
+	EXPORT auto IsVoicePlaying(uint voice) -> bool;
+	EXPORT auto GetMixerStats() -> MixerStats;
+
 	EXPORT auto SetVSync(bool enabled) -> void;
 
 	EXPORT auto SendFloat(uint id, float value) -> void;
@@ -88,4 +423,43 @@ extern "C"
 	EXPORT auto SendVec4(uint id, float x, float y, float z, float w) -> void;
 
 	EXPORT auto GetUniformLocation(uint program, const char *name) -> int;
+
+	EXPORT auto CreateParameterBlock(uint program, const char *name) -> uint;
+	EXPORT auto GetParameterBlockSize(uint id) -> uint;
+	EXPORT auto UpdateParameterBlock(uint id, const void *data, uint size) -> uint;
+	EXPORT auto DestroyParameterBlock(uint id) -> void;
+
+	EXPORT auto ReadImageSize(const void *image, uint64_t size,
+							  uint *width, uint *height) -> bool;
+	EXPORT auto DecodeImage(const void *image, uint64_t size, Color *pixels,
+							uint width, uint height) -> bool;
+
+	EXPORT auto MapAssetFile(const char *path, uint64_t *size) -> const void *;
+	EXPORT auto UnmapAssetFile(const void *data) -> void;
+	EXPORT auto OpenArchive(const char *path) -> uint;
+	EXPORT auto FindArchiveEntry(uint archive, const char *name,
+								 uint64_t *size) -> const void *;
+	EXPORT auto GetArchiveEntryCount(uint archive) -> uint;
+	EXPORT auto GetArchiveEntryName(uint archive, uint index) -> const char *;
+	EXPORT auto CloseArchive(uint archive) -> void;
+	EXPORT auto WriteArchive(const char *path, const char *const *names,
+							 const char *const *files, uint count) -> bool;
+
+	EXPORT auto CanvasFillRect(void *target, PixelFormat format, uint width,
+							   uint height, int x, int y, int w, int h,
+							   Color color) -> void;
+	EXPORT auto CanvasFillCircle(void *target, PixelFormat format, uint width,
+								 uint height, int x, int y, int radius,
+								 Color color) -> void;
+	EXPORT auto CanvasFillTriangle(void *target, PixelFormat format, uint width,
+								   uint height, int x1, int y1, int x2, int y2,
+								   int x3, int y3, Color color) -> void;
+	EXPORT auto CanvasDrawLine(void *target, PixelFormat format, uint width,
+							   uint height, int x1, int y1, int x2, int y2,
+							   Color color, int thickness) -> void;
+	EXPORT auto CanvasDrawTexture(void *target, PixelFormat format, uint width,
+								  uint height, const void *source,
+								  PixelFormat sourceFormat, uint sourceWidth,
+								  uint sourceHeight, int x, int y,
+								  int w, int h) -> void;
 }
\ No newline at end of file
@@ -0,0 +1,469 @@
+#include "SzarkCore.h"
+
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SZARK_SSE2
+#endif
+
+// Rasterized strings kept for reuse, the least recently drawn go first
+static const size_t s_textCacheSize = 256;
+
+// Byte pattern of a color that repeats every pixel in every format
+static const uint s_patternSize = 48;
+
+/* The 5x5 font, one byte per glyph row with the pixels in the top
+   five bits. Rows of all 96 glyphs from ' ' follow each other. */
+static const unsigned char s_defaultFontData[] = {
+	0, 32, 80, 80, 32, 136, 24, 32, 32, 32, 0, 0, 0, 0, 0, 8, 112, 96, 112, 112, 48,
+	112, 112, 112, 112, 112, 0, 0, 16, 0, 64, 96, 112, 248, 240, 248, 240, 248, 248, 248, 136,
+	248, 248, 136, 128, 216, 248, 248, 248, 248, 248, 248, 248, 136, 136, 136, 136, 136, 248, 112, 128,
+	112, 32, 64, 248, 240, 248, 240, 248, 248, 248, 136, 248, 248, 136, 128, 216, 248, 248, 248, 248,
+	248, 248, 248, 136, 136, 136, 136, 136, 248, 64, 48, 32, 96, 0, 0, 0, 32, 80, 248, 112, 16, 96, 32, 64,
+	16, 80, 32, 48, 0, 0, 16, 80, 32, 16, 16, 80,
+	64, 64, 16, 80, 80, 32, 32, 32, 112, 32, 16, 152, 136, 136, 128, 136, 128, 128, 128, 136,
+	32, 32, 144, 128, 168, 136, 136, 136, 136, 136, 128, 32, 136, 136, 136, 80, 80, 16, 64, 64,
+	16, 80, 32, 136, 136, 128, 136, 128, 128, 128, 136, 32, 32, 144, 128, 168, 136, 136, 136, 136,
+	136, 128, 32, 136, 136, 136, 80, 80, 16, 32, 32, 32, 32, 96, 0, 0, 32, 0, 80, 64, 32, 168, 0, 64, 16,
+	32, 112, 32, 112, 0, 32, 80, 32, 32, 32, 112,
+	112, 112, 16, 112, 112, 0, 0, 64, 0, 16, 48, 168, 248, 248, 128, 136, 248, 248, 184, 248,
+	32, 32, 224, 128, 136, 136, 136, 248, 136, 248, 248, 32, 136, 136, 136, 32, 32, 32, 64, 32,
+	16, 136, 16, 248, 248, 128, 136, 248, 248, 184, 248, 32, 32, 224, 128, 136, 136, 136, 248, 136,
+	248, 248, 32, 136, 136, 136, 32, 32, 32, 16, 64, 32, 16, 80, 0, 0, 0, 0, 248, 112, 64, 144, 0, 64,
+	16, 80, 32, 64, 0, 0, 64, 80, 32, 64, 16, 16,
+	16, 80, 16, 80, 16, 32, 32, 32, 112, 32, 0, 152, 136, 136, 128, 136, 128, 128, 136, 136,
+	32, 32, 144, 128, 136, 136, 136, 128, 248, 160, 8, 32, 136, 80, 168, 80, 32, 64, 64, 16,
+	16, 0, 0, 136, 136, 128, 136, 128, 128, 136, 136, 32, 32, 144, 128, 136, 136, 136, 128, 248,
+	160, 8, 32, 136, 80, 168, 80, 32, 64, 0, 32, 32, 32, 0, 0, 0, 32, 0, 80, 32, 136, 104, 0, 32, 32, 0,
+	0, 0, 0, 32, 128, 112, 112, 112, 112, 16,
+	112, 112, 16, 112, 16, 0, 64, 16, 0, 64, 32, 64, 136, 240, 248, 240, 248, 128, 248, 136,
+	248, 224, 136, 248, 136, 136, 248, 128, 16, 144, 248, 32, 248, 32, 80, 136, 32, 248, 112, 8,
+	112, 0, 0, 136, 240, 248, 240, 248, 128, 248, 136, 248, 224, 136, 248, 136, 136, 248, 128, 16,
+	144, 248, 32, 248, 32, 80, 136, 32, 248, 0, 48, 32, 96, 0, 0};
+
+// The data has a column for DEL as well, which is never drawn
+static const uint s_defaultFontColumns = 96;
+static const uint s_defaultGlyphCount = 95;
+static const uint s_defaultGlyphSize = 5;
+
+/* A strip of glyphs side by side, each pixel 0 or 255 */
+struct Font
+{
+	uint glyphWidth, glyphHeight, first, count;
+	std::vector<unsigned char> coverage;
+	uint atlas;
+};
+
+/* A rasterized string with one mask byte for every byte of a pixel in
+   the target format, so blitting never has to expand the mask */
+struct TextMask
+{
+	uint width, height, pixelSize;
+	std::vector<unsigned char> bytes;
+};
+
+using CachedText = std::pair<std::shared_ptr<const TextMask>,
+							 std::list<std::string>::iterator>;
+
+static std::mutex s_fontMutex;
+static std::unordered_map<uint, std::shared_ptr<Font>> s_fonts;
+static uint s_nextFontID = 1;
+
+static std::mutex s_textCacheMutex;
+static std::unordered_map<std::string, CachedText> s_textCache;
+static std::list<std::string> s_textCacheOrder;
+
+/* Font 0, unpacked from the bit rows. Lower case letters share the
+   upper case glyphs. */
+static std::shared_ptr<Font> createDefaultFont()
+{
+	auto font = std::make_shared<Font>();
+	*font = {s_defaultGlyphSize, s_defaultGlyphSize, ' ', s_defaultGlyphCount, {}, 0};
+
+	uint stripWidth = s_defaultGlyphCount * s_defaultGlyphSize;
+	font->coverage.resize((size_t)stripWidth * s_defaultGlyphSize);
+
+	for (uint glyph = 0; glyph < s_defaultGlyphCount; glyph++)
+	{
+		uint source = glyph;
+		if (glyph + ' ' >= 'a' && glyph + ' ' <= 'z')
+			source -= 'a' - 'A';
+
+		for (uint y = 0; y < s_defaultGlyphSize; y++)
+		{
+			unsigned char row = s_defaultFontData[y * s_defaultFontColumns + source];
+			for (uint x = 0; x < s_defaultGlyphSize; x++)
+				font->coverage[(size_t)y * stripWidth + glyph * s_defaultGlyphSize + x] =
+					(row & (0x80 >> x)) ? 255 : 0;
+		}
+	}
+
+	return font;
+}
+
+static std::shared_ptr<Font> findFont(uint id)
+{
+	std::lock_guard<std::mutex> lock(s_fontMutex);
+
+	if (id == 0 && !s_fonts.count(0))
+		s_fonts[0] = createDefaultFont();
+
+	auto it = s_fonts.find(id);
+	return it != s_fonts.end() ? it->second : nullptr;
+}
+
+/* Distance from one glyph to the next, never backwards */
+static uint glyphAdvance(const Font &font, int spacing)
+{
+	return (uint)std::max((int)font.glyphWidth + spacing, 0);
+}
+
+/* Reads one character of UTF-8 text and moves past it. Bytes that
+   don't start a valid sequence are taken as characters of their own,
+   lead bytes no sequence can start with become U+FFFD. */
+static uint nextCharacter(const char *&text)
+{
+	auto bytes = reinterpret_cast<const unsigned char *>(text);
+	uint lead = bytes[0];
+	if (lead >= 0xF8)
+	{
+		text++;
+		return 0xFFFD;
+	}
+
+	uint length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+
+	uint character = length == 1 ? lead : lead & (0x3F >> (length - 1));
+	for (uint i = 1; i < length; i++)
+	{
+		if ((bytes[i] & 0xC0) != 0x80)
+		{
+			text++;
+			return lead;
+		}
+		character = (character << 6) | (bytes[i] & 0x3F);
+	}
+
+	text += length;
+	return character;
+}
+
+static size_t characterCount(const char *text)
+{
+	size_t count = 0;
+	while (*text)
+	{
+		nextCharacter(text);
+		count++;
+	}
+	return count;
+}
+
+static uint textWidth(const Font &font, size_t length, int spacing)
+{
+	if (length == 0) return 0;
+	return (uint)((length - 1) * glyphAdvance(font, spacing) + font.glyphWidth);
+}
+
+/* Lays out a string and copies the mask of every glyph into place.
+   Glyphs the font lacks are left empty but still advance. */
+static void rasterizeText(const Font &font, const char *text, int spacing,
+						  uint pixelSize, TextMask &mask)
+{
+	size_t length = characterCount(text);
+	mask.width = textWidth(font, length, spacing);
+	mask.height = font.glyphHeight;
+	mask.pixelSize = pixelSize;
+
+	size_t rowBytes = (size_t)mask.width * pixelSize;
+	mask.bytes.assign(rowBytes * mask.height, 0);
+
+	uint advance = glyphAdvance(font, spacing);
+	uint stripWidth = font.count * font.glyphWidth;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		uint character = nextCharacter(text);
+		uint glyph = character - font.first;
+		if (character < font.first || glyph >= font.count)
+			continue;
+
+		for (uint y = 0; y < font.glyphHeight; y++)
+		{
+			const unsigned char *src = font.coverage.data() +
+									   (size_t)y * stripWidth + glyph * font.glyphWidth;
+			unsigned char *dst = mask.bytes.data() + y * rowBytes + i * advance * pixelSize;
+
+			// Overlapping glyphs from negative spacing are merged
+			for (uint x = 0; x < font.glyphWidth; x++)
+				if (src[x])
+					memset(dst + x * pixelSize, 255, pixelSize);
+		}
+	}
+}
+
+/* Writes the pattern wherever the mask is set, 16 bytes at a time */
+static void blendSpan(unsigned char *dst, const unsigned char *mask,
+					  const unsigned char *pattern, size_t bytes)
+{
+	size_t i = 0;
+
+#ifdef SZARK_SSE2
+	for (; i + 16 <= bytes; i += 16)
+	{
+		__m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + i));
+		__m128i c = _mm_load_si128(reinterpret_cast<const __m128i *>(pattern + i % s_patternSize));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+						 _mm_or_si128(_mm_and_si128(m, c), _mm_andnot_si128(m, d)));
+	}
+#endif
+
+	for (; i < bytes; i++)
+		if (mask[i])
+			dst[i] = pattern[i % s_patternSize];
+}
+
+/* Size of a mask side once scaled onto the target */
+static uint scaledSize(uint size, float scale)
+{
+	return scale == 1 ? size : (uint)std::ceil(size * (double)scale);
+}
+
+/* Clips a mask scaled by the given factor against the target and
+   blends every row onto it. Scaled masks are sampled per pixel. */
+static void blitText(unsigned char *target, uint width, uint height,
+					 const TextMask &mask, int x, int y, float scale, Color color)
+{
+	// Indexed targets only take the first byte, red as the palette index
+	alignas(16) unsigned char pattern[s_patternSize];
+	unsigned char pixel[4] = {color.r, color.g, color.b, 255};
+	for (uint i = 0; i < s_patternSize; i++)
+		pattern[i] = pixel[i % mask.pixelSize];
+
+	uint maskWidth = scaledSize(mask.width, scale);
+	uint maskHeight = scaledSize(mask.height, scale);
+
+	int64_t x0 = std::max<int64_t>(x, 0);
+	int64_t y0 = std::max<int64_t>(y, 0);
+	int64_t x1 = std::min<int64_t>((int64_t)x + maskWidth, width);
+	int64_t y1 = std::min<int64_t>((int64_t)y + maskHeight, height);
+	if (x0 >= x1 || y0 >= y1) return;
+
+	size_t pixelSize = mask.pixelSize;
+	size_t rowBytes = (size_t)mask.width * pixelSize;
+	size_t spanBytes = (size_t)(x1 - x0) * pixelSize;
+
+	for (int64_t row = y0; row < y1; row++)
+	{
+		unsigned char *dst = target + ((size_t)row * width + x0) * pixelSize;
+
+		if (scale == 1)
+		{
+			const unsigned char *src = mask.bytes.data() + (size_t)(row - y) * rowBytes +
+									   (size_t)(x0 - x) * pixelSize;
+
+			// The pattern starts at the first byte of each clipped span
+			blendSpan(dst, src, pattern, spanBytes);
+			continue;
+		}
+
+		const unsigned char *src = mask.bytes.data() +
+								   (size_t)((row - y) * mask.height / maskHeight) * rowBytes;
+
+		for (int64_t column = x0; column < x1; column++, dst += pixelSize)
+		{
+			size_t sourceColumn = (size_t)((column - x) * mask.width / maskWidth);
+			if (src[sourceColumn * pixelSize])
+				memcpy(dst, pattern, pixelSize);
+		}
+	}
+}
+
+/* Returns the mask of a string from the cache, rasterizing it once */
+static std::shared_ptr<const TextMask> cachedText(const Font &font, uint fontID,
+												  const char *text, int spacing,
+												  uint pixelSize)
+{
+	std::string key = std::to_string(fontID) + ':' + std::to_string(spacing) + ':' +
+					  std::to_string(pixelSize) + ':' + text;
+
+	std::lock_guard<std::mutex> lock(s_textCacheMutex);
+
+	auto it = s_textCache.find(key);
+	if (it != s_textCache.end())
+	{
+		s_textCacheOrder.splice(s_textCacheOrder.begin(), s_textCacheOrder,
+								it->second.second);
+		return it->second.first;
+	}
+
+	auto mask = std::make_shared<TextMask>();
+	rasterizeText(font, text, spacing, pixelSize, *mask);
+
+	if (s_textCache.size() >= s_textCacheSize)
+	{
+		s_textCache.erase(s_textCacheOrder.back());
+		s_textCacheOrder.pop_back();
+	}
+
+	s_textCacheOrder.push_front(key);
+	s_textCache[key] = {mask, s_textCacheOrder.begin()};
+	return mask;
+}
+
+/* Creates a font from a strip of equally wide glyphs starting at the
+   first character, text is read as UTF-8. Pixels with coverage of 128 or more are drawn. */
+auto CreateBitmapFont(const unsigned char *coverage, uint glyphWidth,
+					  uint glyphHeight, uint first, uint count) -> uint
+{
+	if (!coverage || glyphWidth == 0 || glyphHeight == 0 || count == 0)
+	{
+		Error("Font needs at least one glyph!");
+		return 0;
+	}
+
+	auto font = std::make_shared<Font>();
+	*font = {glyphWidth, glyphHeight, first, count, {}, 0};
+
+	size_t size = (size_t)glyphWidth * count * glyphHeight;
+	font->coverage.resize(size);
+	for (size_t i = 0; i < size; i++)
+		font->coverage[i] = coverage[i] >= 128 ? 255 : 0;
+
+	std::lock_guard<std::mutex> lock(s_fontMutex);
+	uint id = s_nextFontID++;
+	s_fonts[id] = font;
+	return id;
+}
+
+/* Frees a font and its atlas, the default font stays */
+auto DestroyFont(uint font) -> void
+{
+	if (font == 0) return;
+
+	uint atlas;
+	{
+		std::lock_guard<std::mutex> lock(s_fontMutex);
+		auto it = s_fonts.find(font);
+		if (it == s_fonts.end()) return;
+
+		atlas = it->second->atlas;
+		s_fonts.erase(it);
+	}
+
+	if (atlas != 0 && !IsHeadless())
+		glDeleteTextures(1, &atlas);
+
+	// Cached strings of the font could be matched by a new one with its id
+	std::lock_guard<std::mutex> lock(s_textCacheMutex);
+	std::string prefix = std::to_string(font) + ':';
+	for (auto it = s_textCacheOrder.begin(); it != s_textCacheOrder.end();)
+	{
+		if (it->compare(0, prefix.size(), prefix) == 0)
+		{
+			s_textCache.erase(*it);
+			it = s_textCacheOrder.erase(it);
+		}
+		else
+			it++;
+	}
+}
+
+/* Returns the size of one glyph of a font */
+auto GetFontSize(uint font, uint *glyphWidth, uint *glyphHeight) -> bool
+{
+	auto found = findFont(font);
+	if (!found) return false;
+
+	if (glyphWidth) *glyphWidth = found->glyphWidth;
+	if (glyphHeight) *glyphHeight = found->glyphHeight;
+	return true;
+}
+
+/* Returns how many pixels wide a string is drawn */
+auto MeasureText(uint font, const char *text, int spacing) -> uint
+{
+	auto found = findFont(font);
+	if (!found || !text) return 0;
+	return textWidth(*found, characterCount(text), spacing);
+}
+
+/* Draws a string with its top left at (x, y), its glyphs scaled by the
+   given factor, and returns its width on the target. Cached strings are
+   rasterized once for strings that rarely change. */
+auto CanvasDrawText(void *target, PixelFormat format, uint width, uint height,
+					uint font, const char *text, int x, int y, Color color,
+					int spacing, bool cache, float scale) -> uint
+{
+	auto found = findFont(font);
+	if (!target || !text || !found || scale <= 0) return 0;
+
+	uint pixelSize = PixelSize(format);
+	auto pixels = static_cast<unsigned char *>(target);
+
+	if (cache)
+	{
+		auto mask = cachedText(*found, font, text, spacing, pixelSize);
+		blitText(pixels, width, height, *mask, x, y, scale, color);
+		return scaledSize(mask->width, scale);
+	}
+
+	// Tiles draw text in parallel, so each thread keeps its own mask
+	static thread_local TextMask mask;
+	rasterizeText(*found, text, spacing, pixelSize, mask);
+	blitText(pixels, width, height, mask, x, y, scale, color);
+	return scaledSize(mask.width, scale);
+}
+
+/* Queues a string as one sprite per glyph, drawn by the next
+   RenderSprites. The atlas of the font is created on first use. */
+auto SubmitText(uint font, const char *text, float x, float y, float scale,
+				Color color, int spacing, float depth) -> void
+{
+	auto found = findFont(font);
+	if (!found || !text || scale <= 0) return;
+
+	uint atlas;
+	{
+		// A font destroyed meanwhile would never free a new atlas
+		std::lock_guard<std::mutex> lock(s_fontMutex);
+		if (!s_fonts.count(font)) return;
+
+		if (found->atlas == 0)
+		{
+			uint stripWidth = found->count * found->glyphWidth;
+			std::vector<Color32> pixels(found->coverage.size());
+			for (size_t i = 0; i < pixels.size(); i++)
+				pixels[i] = {255, 255, 255, found->coverage[i]};
+
+			found->atlas = GenerateTextureID(pixels.data(), stripWidth,
+											 found->glyphHeight, PixelFormat::RGBA32);
+		}
+
+		atlas = found->atlas;
+	}
+
+	std::vector<SpriteInstance> sprites;
+	float advance = glyphAdvance(*found, spacing) * scale;
+
+	for (size_t i = 0; *text; i++)
+	{
+		uint character = nextCharacter(text);
+		uint glyph = character - found->first;
+		if (character < found->first || glyph >= found->count)
+			continue;
+
+		sprites.push_back({x + i * advance, y, found->glyphWidth * scale,
+						   found->glyphHeight * scale, (float)(glyph * found->glyphWidth),
+						   0, (float)found->glyphWidth, (float)found->glyphHeight,
+						   color.r, color.g, color.b, 255, depth});
+	}
+
+	SubmitSprites(atlas, sprites.data(), (uint)sprites.size());
+}
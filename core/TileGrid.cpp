@@ -0,0 +1,413 @@
+#include "SzarkCore.h"
+
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SZARK_SSE2
+#endif
+
+// Batches smaller than this are cast on the calling thread
+static const uint s_parallelRays = 256;
+
+// Rays per job, a multiple of the 4 cast side by side
+static const uint s_raysPerJob = 64;
+
+static const float s_infinity = std::numeric_limits<float>::infinity();
+
+/* A grid of one byte tiles, 0 is empty and anything else is solid */
+struct TileGrid
+{
+	uint width, height;
+	std::vector<unsigned char> tiles;
+	std::shared_mutex mutex;
+};
+
+/* Where a ray starts its walk through the grid. Side distances are
+   measured from the point where the ray entered the grid. */
+struct RayWalk
+{
+	float sideX, sideY, deltaX, deltaY, limit;
+	int cellX, cellY, stepX, stepY;
+};
+
+static std::mutex s_tileGridMutex;
+static std::unordered_map<uint, std::shared_ptr<TileGrid>> s_tileGrids;
+static uint s_nextTileGridID = 1;
+
+static std::shared_ptr<TileGrid> findTileGrid(uint id)
+{
+	std::lock_guard<std::mutex> lock(s_tileGridMutex);
+	auto it = s_tileGrids.find(id);
+	return it != s_tileGrids.end() ? it->second : nullptr;
+}
+
+static unsigned char tileAt(const TileGrid &grid, int x, int y)
+{
+	return grid.tiles[(size_t)y * grid.width + x];
+}
+
+/* Fills in where the ray hit the face of its cell. U runs along the
+   face and is flipped on opposite faces so textures aren't mirrored. */
+static void finishHit(TileHit &hit, float x, float y, float dx, float dy)
+{
+	float hitX = x + dx * hit.distance, hitY = y + dy * hit.distance;
+
+	if (hit.side == 0)
+	{
+		hit.u = hitY - std::floor(hitY);
+		if (dx > 0) hit.u = 1 - hit.u;
+	}
+	else if (hit.side == 1)
+	{
+		hit.u = hitX - std::floor(hitX);
+		if (dy < 0) hit.u = 1 - hit.u;
+	}
+
+	hit.u = std::clamp(hit.u, 0.0f, 1.0f);
+}
+
+/* Moves the ray to where it enters the grid and sets up its walk.
+   Returns false once the hit is already known, a miss or a hit on the
+   first cell, which is written to hit with the distance walked to it. */
+static bool startWalk(const TileGrid &grid, float x, float y, float dx, float dy,
+					  float maxDistance, RayWalk &walk, float &entry, TileHit &hit)
+{
+	hit = {0, 0, 0, 0, -1, 0};
+	entry = 0;
+
+	float width = (float)grid.width, height = (float)grid.height;
+	bool enteredX = false;
+
+	// Clipped to the grid so rays from far outside don't walk to it
+	if (x < 0 || y < 0 || x >= width || y >= height)
+	{
+		float enterX = -s_infinity, exitX = s_infinity;
+		float enterY = -s_infinity, exitY = s_infinity;
+
+		if (dx != 0)
+		{
+			float a = -x / dx, b = (width - x) / dx;
+			enterX = std::min(a, b), exitX = std::max(a, b);
+		}
+		else if (x < 0 || x >= width)
+			return false;
+
+		if (dy != 0)
+		{
+			float a = -y / dy, b = (height - y) / dy;
+			enterY = std::min(a, b), exitY = std::max(a, b);
+		}
+		else if (y < 0 || y >= height)
+			return false;
+
+		entry = std::max(enterX, enterY);
+		if (entry < 0 || entry > std::min(exitX, exitY) || entry > maxDistance)
+			return false;
+
+		enteredX = enterX > enterY;
+	}
+
+	float startX = x + dx * entry, startY = y + dy * entry;
+	walk.cellX = std::clamp((int)std::floor(startX), 0, (int)grid.width - 1);
+	walk.cellY = std::clamp((int)std::floor(startY), 0, (int)grid.height - 1);
+
+	if (unsigned char tile = tileAt(grid, walk.cellX, walk.cellY))
+	{
+		// Rays starting inside a tile hit it without a side
+		hit.distance = entry;
+		hit.cellX = walk.cellX, hit.cellY = walk.cellY;
+		hit.side = entry > 0 ? (enteredX ? 0 : 1) : -1;
+		hit.tile = tile;
+		return false;
+	}
+
+	walk.stepX = dx < 0 ? -1 : 1;
+	walk.stepY = dy < 0 ? -1 : 1;
+	walk.deltaX = dx != 0 ? std::abs(1 / dx) : s_infinity;
+	walk.deltaY = dy != 0 ? std::abs(1 / dy) : s_infinity;
+
+	walk.sideX = dx == 0 ? s_infinity :
+				 (dx < 0 ? startX - walk.cellX : walk.cellX + 1 - startX) * walk.deltaX;
+	walk.sideY = dy == 0 ? s_infinity :
+				 (dy < 0 ? startY - walk.cellY : walk.cellY + 1 - startY) * walk.deltaY;
+
+	walk.limit = maxDistance - entry;
+	return true;
+}
+
+/* Walks one ray cell by cell until it hits a tile, leaves the grid or
+   passes the limit. Returns the distance walked, or -1 on a miss. */
+static float walkRay(const TileGrid &grid, RayWalk &walk, int &side)
+{
+	while (true)
+	{
+		float distance;
+		if (walk.sideX < walk.sideY)
+		{
+			distance = walk.sideX;
+			walk.sideX += walk.deltaX;
+			walk.cellX += walk.stepX;
+			side = 0;
+		}
+		else
+		{
+			distance = walk.sideY;
+			walk.sideY += walk.deltaY;
+			walk.cellY += walk.stepY;
+			side = 1;
+		}
+
+		if (distance > walk.limit ||
+			(uint)walk.cellX >= grid.width || (uint)walk.cellY >= grid.height)
+			return -1;
+
+		if (tileAt(grid, walk.cellX, walk.cellY))
+			return distance;
+	}
+}
+
+#ifdef SZARK_SSE2
+/* Walks four rays side by side. Every lane steps once per iteration,
+   and the loop runs until the longest of them ends. Tiles are loaded
+   one lane at a time as SSE2 can't gather. */
+static void walkRays4(const TileGrid &grid, const RayWalk *walks, bool *active,
+					  float *distances, int *sides, int *cellsX, int *cellsY)
+{
+	alignas(16) float sideX[4], sideY[4], deltaX[4], deltaY[4], limit[4];
+	alignas(16) int cellX[4], cellY[4], stepX[4], stepY[4], live[4];
+
+	for (int i = 0; i < 4; i++)
+	{
+		sideX[i] = walks[i].sideX, sideY[i] = walks[i].sideY;
+		deltaX[i] = walks[i].deltaX, deltaY[i] = walks[i].deltaY;
+		limit[i] = walks[i].limit;
+		cellX[i] = walks[i].cellX, cellY[i] = walks[i].cellY;
+		stepX[i] = walks[i].stepX, stepY[i] = walks[i].stepY;
+		live[i] = active[i] ? -1 : 0;
+		distances[i] = -1;
+	}
+
+	__m128 vSideX = _mm_load_ps(sideX), vSideY = _mm_load_ps(sideY);
+	__m128 vDeltaX = _mm_load_ps(deltaX), vDeltaY = _mm_load_ps(deltaY);
+	__m128 vLimit = _mm_load_ps(limit);
+	__m128i vCellX = _mm_load_si128(reinterpret_cast<const __m128i *>(cellX));
+	__m128i vCellY = _mm_load_si128(reinterpret_cast<const __m128i *>(cellY));
+	__m128i vStepX = _mm_load_si128(reinterpret_cast<const __m128i *>(stepX));
+	__m128i vStepY = _mm_load_si128(reinterpret_cast<const __m128i *>(stepY));
+	__m128i vLive = _mm_load_si128(reinterpret_cast<const __m128i *>(live));
+
+	__m128i vWidth = _mm_set1_epi32((int)grid.width - 1);
+	__m128i vHeight = _mm_set1_epi32((int)grid.height - 1);
+	__m128i vZero = _mm_setzero_si128();
+
+	while (_mm_movemask_epi8(vLive))
+	{
+		// Lanes whose next x boundary is closer step along x
+		__m128 alongX = _mm_cmplt_ps(vSideX, vSideY);
+		__m128i alongXi = _mm_castps_si128(alongX);
+		__m128 distance = _mm_min_ps(vSideX, vSideY);
+
+		vSideX = _mm_add_ps(vSideX, _mm_and_ps(alongX, vDeltaX));
+		vSideY = _mm_add_ps(vSideY, _mm_andnot_ps(alongX, vDeltaY));
+		vCellX = _mm_add_epi32(vCellX, _mm_and_si128(alongXi, vStepX));
+		vCellY = _mm_add_epi32(vCellY, _mm_andnot_si128(alongXi, vStepY));
+
+		// Lanes past the limit or out of the grid miss
+		__m128i beyond = _mm_castps_si128(_mm_cmpgt_ps(distance, vLimit));
+		__m128i outside = _mm_or_si128(
+			_mm_or_si128(_mm_cmpgt_epi32(vCellX, vWidth), _mm_cmplt_epi32(vCellX, vZero)),
+			_mm_or_si128(_mm_cmpgt_epi32(vCellY, vHeight), _mm_cmplt_epi32(vCellY, vZero)));
+		vLive = _mm_andnot_si128(_mm_or_si128(beyond, outside), vLive);
+
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(vLive));
+		if (!mask) break;
+
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, distance);
+		_mm_store_si128(reinterpret_cast<__m128i *>(cellX), vCellX);
+		_mm_store_si128(reinterpret_cast<__m128i *>(cellY), vCellY);
+		int stepMask = _mm_movemask_ps(alongX);
+
+		for (int i = 0; i < 4; i++)
+		{
+			if (!(mask & (1 << i)) || !tileAt(grid, cellX[i], cellY[i]))
+				continue;
+
+			distances[i] = lanes[i];
+			sides[i] = (stepMask >> i) & 1 ? 0 : 1;
+			cellsX[i] = cellX[i], cellsY[i] = cellY[i];
+			live[i] = 0;
+		}
+
+		vLive = _mm_and_si128(vLive, _mm_load_si128(reinterpret_cast<const __m128i *>(live)));
+	}
+}
+#endif
+
+/* Casts a range of rays from one origin, four at a time when possible */
+static void castRays(const TileGrid &grid, float x, float y, const float *directions,
+					 uint begin, uint end, float maxDistance, TileHit *hits)
+{
+	for (uint first = begin; first < end; first += 4)
+	{
+		uint lanes = std::min(4u, end - first);
+		RayWalk walks[4] = {};
+		bool active[4] = {};
+		float entries[4] = {}, dirX[4] = {}, dirY[4] = {};
+
+		for (uint i = 0; i < lanes; i++)
+		{
+			float dx = directions[(first + i) * 2], dy = directions[(first + i) * 2 + 1];
+			float length = std::sqrt(dx * dx + dy * dy);
+			TileHit &hit = hits[first + i];
+
+			if (!(length > 0) || !std::isfinite(length))
+			{
+				hit = {0, 0, 0, 0, -1, 0};
+				continue;
+			}
+
+			dirX[i] = dx / length, dirY[i] = dy / length;
+			active[i] = startWalk(grid, x, y, dirX[i], dirY[i], maxDistance,
+								  walks[i], entries[i], hit);
+		}
+
+		float distances[4] = {-1, -1, -1, -1};
+		int sides[4] = {}, cellsX[4] = {}, cellsY[4] = {};
+
+		uint walking = (uint)std::count(active, active + 4, true);
+
+#ifdef SZARK_SSE2
+		// A lone ray isn't worth the lanes
+		if (walking > 1)
+		{
+			walkRays4(grid, walks, active, distances, sides, cellsX, cellsY);
+			walking = 0;
+		}
+#endif
+
+		for (uint i = 0; i < lanes && walking; i++)
+		{
+			if (!active[i]) continue;
+			distances[i] = walkRay(grid, walks[i], sides[i]);
+			cellsX[i] = walks[i].cellX, cellsY[i] = walks[i].cellY;
+		}
+
+		for (uint i = 0; i < lanes; i++)
+		{
+			TileHit &hit = hits[first + i];
+			if (!active[i] || distances[i] < 0) continue;
+
+			hit.distance = entries[i] + distances[i];
+			hit.cellX = cellsX[i], hit.cellY = cellsY[i];
+			hit.side = sides[i];
+			hit.tile = tileAt(grid, cellsX[i], cellsY[i]);
+		}
+
+		for (uint i = 0; i < lanes; i++)
+		{
+			TileHit &hit = hits[first + i];
+			if (hit.tile) finishHit(hit, x, y, dirX[i], dirY[i]);
+		}
+	}
+}
+
+/* Creates an empty grid of tiles, each one unit wide */
+auto CreateTileGrid(uint width, uint height) -> uint
+{
+	if (width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX)
+	{
+		Error("Tile grid size must be positive!");
+		return 0;
+	}
+
+	auto grid = std::make_shared<TileGrid>();
+	grid->width = width;
+	grid->height = height;
+	grid->tiles.assign((size_t)width * height, 0);
+
+	std::lock_guard<std::mutex> lock(s_tileGridMutex);
+	uint id = s_nextTileGridID++;
+	s_tileGrids[id] = grid;
+	return id;
+}
+
+auto DestroyTileGrid(uint grid) -> void
+{
+	std::lock_guard<std::mutex> lock(s_tileGridMutex);
+	s_tileGrids.erase(grid);
+}
+
+/* Copies a rectangle of rows of tiles into the grid, clipped to it */
+auto SetTiles(uint grid, int x, int y, uint width, uint height,
+			  const unsigned char *tiles) -> void
+{
+	auto found = findTileGrid(grid);
+	if (!found || !tiles) return;
+
+	std::unique_lock<std::shared_mutex> lock(found->mutex);
+
+	int64_t x0 = std::max<int64_t>(x, 0), y0 = std::max<int64_t>(y, 0);
+	int64_t x1 = std::min<int64_t>((int64_t)x + width, found->width);
+	int64_t y1 = std::min<int64_t>((int64_t)y + height, found->height);
+	if (x0 >= x1 || y0 >= y1) return;
+
+	for (int64_t row = y0; row < y1; row++)
+	{
+		const unsigned char *src = tiles + (row - y) * width + (x0 - x);
+		std::copy(src, src + (x1 - x0), &found->tiles[row * found->width + x0]);
+	}
+}
+
+/* Returns a tile, cells outside the grid are empty */
+auto GetTile(uint grid, int x, int y) -> unsigned char
+{
+	auto found = findTileGrid(grid);
+	if (!found) return 0;
+
+	std::shared_lock<std::shared_mutex> lock(found->mutex);
+	if ((uint)x >= found->width || (uint)y >= found->height) return 0;
+	return tileAt(*found, x, y);
+}
+
+/* Casts rays from one origin through the grid, spread over the job
+   system for large batches, and returns how many of them hit a tile.
+   Directions are pairs of floats and don't need to be normalized. */
+auto CastTileRays(uint grid, float x, float y, const float *directions,
+				  uint count, float maxDistance, TileHit *hits) -> uint
+{
+	auto found = findTileGrid(grid);
+	if (!found || !directions || !hits || count == 0) return 0;
+
+	if (!(maxDistance >= 0) || !std::isfinite(x) || !std::isfinite(y))
+	{
+		for (uint i = 0; i < count; i++)
+			hits[i] = {0, 0, 0, 0, -1, 0};
+		return 0;
+	}
+
+	std::shared_lock<std::shared_mutex> lock(found->mutex);
+	const TileGrid &tiles = *found;
+
+	if (count < s_parallelRays)
+		castRays(tiles, x, y, directions, 0, count, maxDistance, hits);
+	else
+	{
+		uint jobs = (count + s_raysPerJob - 1) / s_raysPerJob;
+		RunJobs(jobs, [&](uint job, uint) {
+			uint begin = job * s_raysPerJob;
+			castRays(tiles, x, y, directions, begin,
+					 std::min(count, begin + s_raysPerJob), maxDistance, hits);
+		});
+	}
+
+	uint hitCount = 0;
+	for (uint i = 0; i < count; i++)
+		if (hits[i].tile) hitCount++;
+	return hitCount;
+}
@@ -0,0 +1,259 @@
+#include "SzarkCore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+// std140 lays everything that matters out in 16 byte rows
+static const uint s_parameterRowSize = 16;
+
+struct UniformBlockInfo
+{
+	uint index, size;
+};
+
+/* Every active uniform and uniform block of a linked program */
+struct ProgramReflection
+{
+	std::unordered_map<std::string, int> uniforms;
+	std::unordered_map<std::string, UniformBlockInfo> blocks;
+};
+
+/* A uniform buffer bound to one block of a program, together with a
+   copy of what was last uploaded so only changed rows are sent */
+struct ParameterBlock
+{
+	uint program;
+	std::string name;
+	uint buffer, binding, size;
+	std::vector<unsigned char> uploaded;
+	bool initialized;
+};
+
+static std::unordered_map<uint, ProgramReflection> s_programReflections;
+static std::unordered_map<uint, ParameterBlock> s_parameterBlocks;
+static std::vector<bool> s_usedBindings;
+static uint s_nextParameterBlockID = 1;
+
+static const UniformBlockInfo *findBlock(uint program, const char *name)
+{
+	auto it = s_programReflections.find(program);
+	if (it == s_programReflections.end()) return nullptr;
+
+	auto block = it->second.blocks.find(name);
+	return block != it->second.blocks.end() ? &block->second : nullptr;
+}
+
+/* Creates or resizes the buffer of a block and binds it to the block */
+static void bindBlock(ParameterBlock &block, uint program, const UniformBlockInfo &info)
+{
+	if (block.size != info.size)
+	{
+		block.size = info.size;
+		block.uploaded.assign(info.size, 0);
+		block.initialized = false;
+
+		glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+		glBufferData(GL_UNIFORM_BUFFER, info.size, nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, block.binding, block.buffer);
+	}
+
+	glUniformBlockBinding(program, info.index, block.binding);
+}
+
+/* Reads the uniforms and uniform blocks of a newly linked program, so
+   looking them up never has to ask the driver */
+auto ReflectProgram(uint program) -> void
+{
+	auto &reflection = s_programReflections[program];
+	reflection = {};
+
+	int count = 0, maxLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> name(maxLength + 1);
+
+	for (int i = 0; i < count; i++)
+	{
+		int size = 0, length = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, i, (int)name.size(), &length, &size,
+						   &type, name.data());
+
+		// Uniforms inside blocks have no location
+		int location = glGetUniformLocation(program, name.data());
+		if (location < 0) continue;
+
+		std::string uniform(name.data(), length);
+		reflection.uniforms[uniform] = location;
+
+		// Arrays are found by their own name as well as their first element
+		if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+			reflection.uniforms[uniform.substr(0, uniform.size() - 3)] = location;
+	}
+
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+	name.resize(maxLength + 1);
+
+	for (int i = 0; i < count; i++)
+	{
+		int length = 0, size = 0;
+		glGetActiveUniformBlockName(program, i, (int)name.size(), &length, name.data());
+		glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+		reflection.blocks[std::string(name.data(), length)] = {(uint)i, (uint)size};
+	}
+}
+
+/* Drops the reflection of a deleted program */
+auto ForgetProgram(uint program) -> void
+{
+	s_programReflections.erase(program);
+}
+
+/* Returns the cached location of a uniform, or -1 if it isn't active */
+auto FindUniform(uint program, const char *name) -> int
+{
+	auto it = s_programReflections.find(program);
+	if (it == s_programReflections.end())
+		return glGetUniformLocation(program, name);
+
+	auto &uniforms = it->second.uniforms;
+	auto uniform = uniforms.find(name);
+	if (uniform != uniforms.end()) return uniform->second;
+
+	// Only the first element of an array is reflected, the others are
+	// asked for once and cached along with it
+	size_t length = strlen(name);
+	if (length == 0 || name[length - 1] != ']') return -1;
+
+	int location = glGetUniformLocation(program, name);
+	uniforms.emplace(name, location);
+	return location;
+}
+
+/* Binds the parameter blocks of a program to the program that replaced
+   it after a reload. Blocks that changed size start over empty. */
+auto RebindParameterBlocks(uint id, uint program) -> void
+{
+	for (auto &[blockID, block] : s_parameterBlocks)
+	{
+		if (block.program != id) continue;
+
+		if (auto info = findBlock(program, block.name.c_str()))
+			bindBlock(block, program, *info);
+	}
+}
+
+/* Creates a uniform buffer for a std140 uniform block of a program.
+   Returns 0 when the block doesn't exist. */
+auto CreateParameterBlock(uint program, const char *name) -> uint
+{
+	if (IsHeadless() || !name) return 0;
+
+	auto info = findBlock(program, name);
+	if (!info)
+	{
+		Error("Uniform block was not found in the shader!");
+		return 0;
+	}
+
+	int maxBindings = 0;
+	glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &maxBindings);
+
+	uint binding = 0;
+	while (binding < s_usedBindings.size() && s_usedBindings[binding])
+		binding++;
+
+	if ((int)binding >= maxBindings)
+	{
+		Error("Too many parameter blocks, no uniform buffer bindings left!");
+		return 0;
+	}
+
+	if (binding == s_usedBindings.size())
+		s_usedBindings.push_back(false);
+	s_usedBindings[binding] = true;
+
+	ParameterBlock block = {program, name, 0, binding, 0, {}, false};
+	glGenBuffers(1, &block.buffer);
+	bindBlock(block, program, *info);
+
+	// A reloaded program is in use in place of this one
+	uint current = ResolveProgram(program);
+	if (current != program)
+		if (auto reloaded = findBlock(current, name))
+			bindBlock(block, current, *reloaded);
+
+	uint id = s_nextParameterBlockID++;
+	s_parameterBlocks[id] = std::move(block);
+	return id;
+}
+
+/* Returns the size in bytes of a parameter block */
+auto GetParameterBlockSize(uint id) -> uint
+{
+	auto it = s_parameterBlocks.find(id);
+	return it != s_parameterBlocks.end() ? it->second.size : 0;
+}
+
+/* Writes a whole parameter block, but only uploads the 16 byte rows that
+   changed since the last update. Returns how many bytes were uploaded. */
+auto UpdateParameterBlock(uint id, const void *data, uint size) -> uint
+{
+	auto it = s_parameterBlocks.find(id);
+	if (it == s_parameterBlocks.end() || !data) return 0;
+
+	auto &block = it->second;
+	auto bytes = static_cast<const unsigned char *>(data);
+	size = std::min(size, block.size);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+
+	if (!block.initialized)
+	{
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, size, bytes);
+		memcpy(block.uploaded.data(), bytes, size);
+		block.initialized = true;
+		return size;
+	}
+
+	auto rowChanged = [&](uint offset) {
+		uint length = std::min(s_parameterRowSize, size - offset);
+		return memcmp(block.uploaded.data() + offset, bytes + offset, length) != 0;
+	};
+
+	uint uploaded = 0;
+	for (uint offset = 0; offset < size;)
+	{
+		if (!rowChanged(offset))
+		{
+			offset += s_parameterRowSize;
+			continue;
+		}
+
+		// Neighbouring changed rows go up in one call
+		uint end = offset + s_parameterRowSize;
+		while (end < size && rowChanged(end))
+			end += s_parameterRowSize;
+		end = std::min(end, size);
+
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, end - offset, bytes + offset);
+		memcpy(block.uploaded.data() + offset, bytes + offset, end - offset);
+		uploaded += end - offset;
+		offset = end;
+	}
+
+	return uploaded;
+}
+
+/* Frees a parameter block and its binding */
+auto DestroyParameterBlock(uint id) -> void
+{
+	auto it = s_parameterBlocks.find(id);
+	if (it == s_parameterBlocks.end()) return;
+
+	glDeleteBuffers(1, &it->second.buffer);
+	s_usedBindings[it->second.binding] = false;
+	s_parameterBlocks.erase(it);
+}
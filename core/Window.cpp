@@ -1,32 +1,37 @@
 #include "SzarkCore.h"
 
+#include <atomic>
+#include <thread>
+
 static double s_deltaTime = 0;
 static bool s_initialized = false;
+static bool s_headless = false;
+static std::atomic<bool> s_headlessRunning{false};
+static uint64_t s_frameCount = 0;
+
+static bool s_inputThread = false;
+static Rect s_monitorRect = { 0 };
 
 static void(*s_windowCallback)(GLFWwindow*, WindowEvent);
-static void(*s_keyCallback)(int key, int action);
-static void(*s_mouseCallback)(int button, int action);
-static void(*s_scrollCallback)(double dx, double dy);
-static void(*s_cursorCallback)(double x, double y);
 
 /* GLFW keyboard input callback */
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-	if (s_keyCallback) s_keyCallback(key, action);
+	DispatchKeyEvent(key, action, mods);
 }
 
 /* GLFW cursor position callback */
 static void cursorPosCallback(GLFWwindow* window, double xpos, double ypos) {
-	if (s_cursorCallback) s_cursorCallback(xpos, ypos);
+	DispatchCursorEvent(xpos, ypos);
 }
 
 /* GLFW mouse button input callback */
 static void mouseCallback(GLFWwindow* window, int button, int action, int mods) {
-	if (s_mouseCallback) s_mouseCallback(button, action);
+	DispatchMouseEvent(button, action, mods);
 }
 
 /* GLFW mouse scroll input callback */
 static void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
-	if (s_scrollCallback) s_scrollCallback(xoffset, yoffset);
+	DispatchScrollEvent(xoffset, yoffset);
 }
 
 /* Sets a callback for any window events */
@@ -34,25 +39,13 @@ auto SetWindowEventCallback(void(*callback)(GLFWwindow* w, WindowEvent e)) -> vo
 	if (callback) s_windowCallback = callback;
 }
 
-/* Sets a callback for mouse wheel scroll input */
-auto SetScrollCallback(void(*callback)(double dx, double dy)) {
-	if (callback) s_scrollCallback = callback;
-}
+/* Polls window events on the calling thread while frames are rendered
+   on a thread of their own, so input is stamped as it arrives instead
+   of once per frame. Must be set before Show. */
+auto SetInputThread(bool enabled) -> void { s_inputThread = enabled; }
 
-/* Sets a callback to listen for mouse button events */
-auto SetMouseCallback(void(*callback)(int button, int action)) {
-	if (callback) s_mouseCallback = callback;
-}
-
-/* Sets a callback to listen for key events */
-auto SetKeyCallback(void(*callback)(int key, int action)) {
-	if (callback) s_keyCallback = callback;
-}
-
-/* Sets the callback for the cursor */
-auto SetCursorCallback(void(*callback)(double x, double y)) {
-	if (callback) s_cursorCallback = callback;
-}
+/* Whether Show renders away from the thread polling the window */
+auto IsInputThreaded() -> bool { return s_inputThread; }
 
 /* Creates a GLFW window with a desired configuration */
 auto Create(
@@ -97,15 +90,8 @@ auto Create(
 	return window;
 }
 
-/* Shows a GLFW window on screen */
-auto Show(GLFWwindow* window) -> void {
-	if (!window) return;
-
-	glfwSetKeyCallback(window, keyCallback);
-	glfwSetCursorPosCallback(window, cursorPosCallback);
-	glfwSetMouseButtonCallback(window, mouseCallback);
-	glfwSetScrollCallback(window, scrollCallback);
-
+/* Loads OpenGL on the calling thread and runs frames until the window closes */
+static void renderLoop(GLFWwindow* window) {
 	glfwMakeContextCurrent(window);
 	glfwSwapInterval(1);
 
@@ -118,27 +104,144 @@ auto Show(GLFWwindow* window) -> void {
 	if (s_windowCallback)
 		s_windowCallback(window, WindowEvent::Opened);
 
+	// Ticks run on their own thread when a tick rate is set
+	StartSimulation(window, s_windowCallback);
+
 	// Keep window open until Close() is called
 	double lastTime = glfwGetTime();
 	while (!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
+		BeginProfilerFrame();
+		ProfileScope frameZone(CoreZone::Frame);
+
+		if (!s_inputThread) {
+			ProfileScope zone(CoreZone::Poll);
+			glfwPollEvents();
+		}
 
 		double currentTime = glfwGetTime();
 		s_deltaTime = (currentTime - lastTime);
 		lastTime = currentTime;
 
-		if (s_windowCallback)
+		BeginRenderFrame();
+		if (s_windowCallback) {
+			ProfileScope zone(CoreZone::Render);
+			double renderStart = glfwGetTime();
 			s_windowCallback(window, WindowEvent::Render);
+			UpdateRenderScale(glfwGetTime() - renderStart);
+		}
 
-		glfwSwapBuffers(window);
+		CaptureFrame();
+
+		{
+			ProfileScope zone(CoreZone::Swap);
+			glfwSwapBuffers(window);
+		}
+
+		PresentInputFrame();
+		s_frameCount++;
 	}
 
+	StopSimulation();
+	StopShaderReload();
+	FinishCapture();
 	if (s_windowCallback)
 		s_windowCallback(window, WindowEvent::Closed);
+
+	glfwMakeContextCurrent(nullptr);
 }
 
+/* Shows a GLFW window on screen */
+auto Show(GLFWwindow* window) -> void {
+	if (!window) return;
+
+	glfwSetKeyCallback(window, keyCallback);
+	glfwSetCursorPosCallback(window, cursorPosCallback);
+	glfwSetMouseButtonCallback(window, mouseCallback);
+	glfwSetScrollCallback(window, scrollCallback);
+
+	if (!s_inputThread) {
+		renderLoop(window);
+		return;
+	}
+
+	// Monitors can only be queried here, the renderer reads this copy
+	s_monitorRect = GetPrimaryMonitorRect();
+
+	// GLFW only delivers events to the thread that created the window
+	std::atomic<bool> rendering{true};
+	std::thread renderer([&] {
+		renderLoop(window);
+		rendering = false;
+		glfwPostEmptyEvent();
+	});
+
+	while (rendering)
+		glfwWaitEvents();
+
+	renderer.join();
+}
+
+/* Runs the window loop against a CPU framebuffer without GLFW or OpenGL.
+   A frame count of 0 runs until Close() is called. A fixed step above 0
+   is reported as the delta time and frames run as fast as possible. */
+auto ShowHeadless(uint width, uint height, uint frames, double fixedStep) -> void {
+	if (width == 0) width = 800;
+	if (height == 0) height = 600;
+
+	s_headless = true;
+	s_headlessRunning = true;
+	InitSoftwareFramebuffer(width, height);
+
+	if (s_windowCallback)
+		s_windowCallback(nullptr, WindowEvent::Opened);
+
+	StartSimulation(nullptr, s_windowCallback);
+
+	using clock = std::chrono::steady_clock;
+	auto lastTime = clock::now();
+
+	for (uint frame = 0; s_headlessRunning; frame++) {
+		if (frames != 0 && frame >= frames) break;
+
+		auto currentTime = clock::now();
+		double elapsed = std::chrono::duration<double>(currentTime - lastTime).count();
+		s_deltaTime = fixedStep > 0 ? fixedStep : elapsed;
+		lastTime = currentTime;
+
+		BeginProfilerFrame();
+		ProfileScope frameZone(CoreZone::Frame);
+
+		BeginRenderFrame();
+		if (s_windowCallback) {
+			ProfileScope zone(CoreZone::Render);
+			auto renderStart = clock::now();
+			s_windowCallback(nullptr, WindowEvent::Render);
+			UpdateRenderScale(std::chrono::duration<double>(clock::now() - renderStart).count());
+		}
+
+		CaptureFrame();
+		PresentInputFrame();
+		s_frameCount++;
+	}
+
+	StopSimulation();
+	FinishCapture();
+	if (s_windowCallback)
+		s_windowCallback(nullptr, WindowEvent::Closed);
+
+	s_headlessRunning = false;
+}
+
+/* Whether the window loop is running without GLFW or OpenGL */
+auto IsHeadless() -> bool { return s_headless; }
+
 /* Notifies a window to close */
 auto Close(GLFWwindow* window) -> void {
+	if (s_headless) {
+		s_headlessRunning = false;
+		return;
+	}
+
 	if (!window) return;
 	glfwSetWindowShouldClose(window, true);
 }
@@ -146,8 +249,12 @@ auto Close(GLFWwindow* window) -> void {
 /* Returns time taken between each frame */
 auto GetDeltaTime() -> double { return s_deltaTime; }
 
+/* Returns the amount of frames presented since the window was shown */
+auto GetFrameCount() -> uint64_t { return s_frameCount; }
+
 /* Changes glfw swap interval */
 auto SetVSync(bool enabled) -> void {
+	if (s_headless) return;
 	glfwSwapInterval(enabled ? 1 : 0);
 }
 
@@ -155,6 +262,18 @@ auto SetVSync(bool enabled) -> void {
 auto GetPrimaryMonitorRect() -> Rect
 {
 	Rect rect = { 0 };
+
+	// The framebuffer acts as the only monitor when headless
+	if (s_headless) {
+		uint width = 0, height = 0;
+		GetSoftwareFramebuffer(&width, &height);
+		return { 0, 0, (int)width, (int)height };
+	}
+
+	// Taken before rendering started, away from the window thread
+	if (s_inputThread && s_monitorRect.width > 0)
+		return s_monitorRect;
+
 	auto monitor = glfwGetPrimaryMonitor();
 
 	if (!monitor) {
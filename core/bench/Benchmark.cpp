@@ -0,0 +1,649 @@
+/* Benchmarks the hot paths of the core on an offscreen context, so it
+   runs on a plain Linux box without a GPU or a sound card: EGL with
+   Mesa's llvmpipe for OpenGL and OpenAL Soft's null output for audio.
+
+   Usage: benchmark [--warmup N] [--repetitions N] [--filter TEXT]
+					[--output FILE] [--baseline FILE] [--threshold RATIO]
+
+   Results are JSON with one benchmark per line. Given a baseline from
+   an earlier run, medians that got slower by more than the threshold
+   are reported and the exit code is 2. A baseline that can't be read
+   or holds no results exits with 1, like any error. */
+
+#include "../SzarkCore.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <map>
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+// Iterations are doubled until a repetition takes at least this long
+static const double s_minRepetitionTime = 0.01;
+
+/* Runs a number of iterations and returns the seconds they took */
+using BenchmarkBody = std::function<double(uint iterations)>;
+
+struct BenchmarkResult
+{
+	std::string id;
+	uint64_t iterations;
+	double mean, median, stddev, min, max;
+	double bytesPerIteration;
+};
+
+static uint s_warmup = 3;
+static uint s_repetitions = 10;
+static std::string s_filter;
+static uint s_errorCount = 0;
+static std::vector<BenchmarkResult> s_results;
+
+static double seconds(BenchmarkClock::time_point start)
+{
+	return std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+}
+
+/* Times a body that only needs to be called in a loop. GPU work is
+   finished before the clock stops so it is part of the time. */
+static BenchmarkBody loop(std::function<void()> body, bool gpu = false)
+{
+	return [body, gpu](uint iterations) {
+		auto start = BenchmarkClock::now();
+		for (uint i = 0; i < iterations; i++)
+			body();
+		if (gpu) glFinish();
+		return seconds(start);
+	};
+}
+
+/* Calibrates the iteration count, warms up and then repeats a body,
+   keeping the time per iteration of each repetition */
+static void benchmark(const std::string &id, BenchmarkBody body,
+					  double bytesPerIteration = 0)
+{
+	if (!s_filter.empty() && id.find(s_filter) == std::string::npos)
+		return;
+
+	// The first call pays for lazy driver work like shader variants
+	body(1);
+
+	uint iterations = 1;
+	while (body(iterations) < s_minRepetitionTime && iterations < (1u << 30))
+		iterations *= 2;
+
+	for (uint i = 0; i < s_warmup; i++)
+		body(iterations);
+
+	std::vector<double> samples(s_repetitions);
+	for (auto &sample : samples)
+		sample = body(iterations) / iterations;
+
+	BenchmarkResult result = {id, iterations, 0, 0, 0, 0, 0, bytesPerIteration};
+
+	for (double sample : samples)
+		result.mean += sample;
+	result.mean /= samples.size();
+
+	for (double sample : samples)
+		result.stddev += (sample - result.mean) * (sample - result.mean);
+	result.stddev = std::sqrt(result.stddev / samples.size());
+
+	std::sort(samples.begin(), samples.end());
+	result.min = samples.front();
+	result.max = samples.back();
+	result.median = samples.size() % 2 ? samples[samples.size() / 2]
+									   : (samples[samples.size() / 2 - 1] +
+										  samples[samples.size() / 2]) / 2;
+
+	fprintf(stderr, "%-32s %12.1f ns  ±%5.1f%%\n", id.c_str(),
+			result.median * 1e9, result.stddev / result.mean * 100);
+	s_results.push_back(result);
+}
+
+/* Writes the results, one benchmark per line so runs diff well */
+static void writeResults(FILE *file)
+{
+	time_t now = time(nullptr);
+	char date[32];
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	fprintf(file, "{\n\"version\": 1,\n\"date\": \"%s\",\n", date);
+	fprintf(file, "\"renderer\": \"%s\",\n", glGetString(GL_RENDERER));
+	fprintf(file, "\"warmup\": %u,\n\"repetitions\": %u,\n", s_warmup, s_repetitions);
+	fprintf(file, "\"benchmarks\": [\n");
+
+	for (size_t i = 0; i < s_results.size(); i++)
+	{
+		auto &r = s_results[i];
+		fprintf(file, "{\"id\": \"%s\", \"iterations\": %llu, \"median_ns\": %.3f, "
+					  "\"mean_ns\": %.3f, \"stddev_ns\": %.3f, \"min_ns\": %.3f, "
+					  "\"max_ns\": %.3f, \"cv\": %.4f",
+				r.id.c_str(), (unsigned long long)r.iterations, r.median * 1e9,
+				r.mean * 1e9, r.stddev * 1e9, r.min * 1e9, r.max * 1e9,
+				r.mean > 0 ? r.stddev / r.mean : 0);
+
+		if (r.bytesPerIteration > 0)
+			fprintf(file, ", \"throughput_mbps\": %.2f",
+					r.bytesPerIteration / r.median / (1024 * 1024));
+
+		fprintf(file, "}%s\n", i + 1 < s_results.size() ? "," : "");
+	}
+
+	fprintf(file, "]\n}\n");
+}
+
+/* Reads the medians of an earlier run by id, false when the file is
+   missing or has none */
+static bool readBaseline(const char *path, std::map<std::string, double> &medians)
+{
+	FILE *file = fopen(path, "r");
+	if (!file) return false;
+
+	char line[1024];
+	while (fgets(line, sizeof(line), file))
+	{
+		auto id = strstr(line, "\"id\": \"");
+		auto median = strstr(line, "\"median_ns\": ");
+		if (!id || !median) continue;
+
+		id += 7;
+		auto end = strchr(id, '"');
+		if (end) medians[std::string(id, end)] = atof(median + 13);
+	}
+
+	fclose(file);
+	return !medians.empty();
+}
+
+/* Reports every benchmark that got slower than the baseline allows */
+static uint compareBaseline(const std::map<std::string, double> &baseline,
+							double threshold)
+{
+	uint regressions = 0;
+
+	for (auto &result : s_results)
+	{
+		auto it = baseline.find(result.id);
+		if (it == baseline.end() || it->second <= 0) continue;
+
+		double ratio = result.median * 1e9 / it->second;
+		if (ratio > 1 + threshold)
+		{
+			fprintf(stderr, "REGRESSION %-32s %.2fx slower\n", result.id.c_str(), ratio);
+			regressions++;
+		}
+	}
+
+	return regressions;
+}
+
+/* Creates a context without any surface and loads OpenGL through it */
+static bool createOffscreenContext()
+{
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+		eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (!getPlatformDisplay) return false;
+
+	auto display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+									  EGL_DEFAULT_DISPLAY, nullptr);
+	if (!eglInitialize(display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_API))
+		return false;
+
+	EGLConfig config;
+	EGLint count = 0;
+	EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+								EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &count) || count == 0)
+		return false;
+
+	// The core shaders need GLSL 4.20
+	EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 4,
+								  EGL_CONTEXT_MINOR_VERSION, 5, EGL_NONE};
+	auto context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT ||
+		!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		return false;
+
+	return gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+}
+
+/* A framebuffer to draw into, there is no window */
+static void bindRenderTarget(uint width, uint height)
+{
+	uint texture = 0, framebuffer = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+				 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+						   GL_TEXTURE_2D, texture, 0);
+	glViewport(0, 0, width, height);
+}
+
+static void benchmarkTextures()
+{
+	for (auto format : {PixelFormat::RGB24, PixelFormat::RGBA32, PixelFormat::Indexed8})
+	{
+		static const char *formatNames[] = {"", "/RGBA32", "/Indexed8"};
+
+		for (uint size : {64u, 256u, 512u, 1024u})
+		{
+			std::vector<unsigned char> pixels((size_t)size * size * PixelSize(format));
+			for (size_t i = 0; i < pixels.size(); i++)
+				pixels[i] = (unsigned char)(i ^ (i >> 11));
+
+			uint id = GenerateTextureID(pixels.data(), size, size, format);
+			auto name = "UpdateTexture/" + std::to_string(size) + "x" +
+						std::to_string(size) + formatNames[(uint)format];
+
+			benchmark(name, loop([&] {
+				pixels[0]++;
+				UpdateTexture(id, pixels.data(), size, size);
+			}, true), (double)pixels.size());
+
+			glDeleteTextures(1, &id);
+		}
+	}
+}
+
+static void benchmarkDrawing()
+{
+	std::vector<Color> pixels(256 * 256, Color{40, 80, 120});
+	uint id = GenerateTextureID(pixels.data(), 256, 256, PixelFormat::RGB24);
+
+	for (uint size : {256u, 1024u})
+	{
+		bindRenderTarget(size, size);
+		UseDefaultShader();
+		UseTexture(id);
+
+		benchmark("RenderQuad/" + std::to_string(size) + "x" + std::to_string(size),
+				  loop(RenderQuad, true));
+	}
+
+	glDeleteTextures(1, &id);
+}
+
+static void benchmarkShaders()
+{
+	static const char *vertexSrc =
+		"#version 420\n"
+		"layout(location = 0) in vec2 pos;"
+		"layout(location = 1) in vec2 tex;"
+		"out vec2 texCoord;"
+		"void main() { texCoord = tex; gl_Position = vec4(pos, 0, 1); }";
+
+	static const char *fragmentSrc =
+		"#version 420\n"
+		"out vec4 FragColor;"
+		"in vec2 texCoord;"
+		"uniform sampler2D tex;"
+		"uniform float time;"
+		"void main() {"
+		"	vec3 color = texture(tex, texCoord).rgb;"
+		"	for (int i = 0; i < 8; i++) color = sin(color * 3.1 + time);"
+		"	FragColor = vec4(color, 1);"
+		"}";
+
+	auto compile = [](const std::string &fragment) {
+		uint program = CompileShader(vertexSrc, fragment.c_str());
+		ForgetProgram(program);
+		glDeleteProgram(program);
+	};
+
+	// Every element of an array is found, not only the first
+	static const char *arraySrc =
+		"#version 420\n"
+		"out vec4 FragColor;"
+		"uniform vec3 colors[3];"
+		"void main() { FragColor = vec4(colors[0] + colors[1] + colors[2], 1); }";
+
+	uint arrays = CompileShader(vertexSrc, arraySrc);
+	int first = FindUniform(arrays, "colors[0]");
+	int second = FindUniform(arrays, "colors[1]");
+	if (first < 0 || second < 0 || second == first ||
+		second != glGetUniformLocation(arrays, "colors[1]") ||
+		FindUniform(arrays, "colors") != first || FindUniform(arrays, "colors[3]") != -1)
+		Error("Uniform array elements were not found!");
+
+	ForgetProgram(arrays);
+	glDeleteProgram(arrays);
+
+	// Every source is different so no driver or program cache can help
+	uint64_t counter = 0;
+	benchmark("CompileShader/source", loop([&] {
+		compile(fragmentSrc + std::string("// ") + std::to_string(counter++));
+	}));
+
+	char directory[] = "/tmp/szark-shadercache-XXXXXX";
+	if (!mkdtemp(directory)) return;
+
+	SetShaderCacheDirectory(directory);
+	compile(fragmentSrc);
+	benchmark("CompileShader/cached", loop([&] { compile(fragmentSrc); }));
+	SetShaderCacheDirectory(nullptr);
+	std::filesystem::remove_all(directory);
+}
+
+/* Builds a 16 bit mono WAV file, with the data chunk first if asked */
+static std::vector<unsigned char> makeWave(const std::vector<int16_t> &samples,
+										   uint frequency, bool dataFirst)
+{
+	auto put = [](std::vector<unsigned char> &out, uint value, uint size) {
+		for (uint i = 0; i < size; i++) out.push_back((unsigned char)(value >> (i * 8)));
+	};
+
+	std::vector<unsigned char> format = {'f', 'm', 't', ' '}, data = {'d', 'a', 't', 'a'};
+	put(format, 16, 4), put(format, 1, 2), put(format, 1, 2), put(format, frequency, 4);
+	put(format, frequency * 2, 4), put(format, 2, 2), put(format, 16, 2);
+
+	put(data, (uint)(samples.size() * 2), 4);
+	auto bytes = reinterpret_cast<const unsigned char *>(samples.data());
+	data.insert(data.end(), bytes, bytes + samples.size() * 2);
+
+	std::vector<unsigned char> wave = {'R', 'I', 'F', 'F'};
+	put(wave, (uint)(4 + format.size() + data.size()), 4);
+	wave.insert(wave.end(), {'W', 'A', 'V', 'E'});
+
+	auto &first = dataFirst ? data : format, &second = dataFirst ? format : data;
+	wave.insert(wave.end(), first.begin(), first.end());
+	wave.insert(wave.end(), second.begin(), second.end());
+	return wave;
+}
+
+/* Chunks may come in any order, files with the samples first stream too */
+static void checkWaveChunkOrder()
+{
+	const uint frequency = 44100;
+	std::vector<int16_t> samples(frequency / 2, 1000);
+	auto wave = makeWave(samples, frequency, true);
+	auto usual = makeWave(samples, frequency, false);
+	WaveInfo info = {}, expected = {};
+
+	if (!ReadWaveInfo(wave.data(), wave.size(), &info) ||
+		!ReadWaveInfo(usual.data(), usual.size(), &expected) ||
+		info.format != expected.format || info.size != expected.size ||
+		info.frequency != frequency || memcmp(wave.data() + info.offset,
+											  samples.data(), info.size) != 0)
+		Error("WAV files with the data chunk first were not read!");
+
+	char path[] = "/tmp/szark-wave-XXXXXX";
+	int fd = mkstemp(path);
+	FILE *file = fd >= 0 ? fdopen(fd, "wb") : nullptr;
+	if (file)
+	{
+		fwrite(wave.data(), 1, wave.size(), file);
+		fclose(file);
+
+		uint stream = OpenAudioStream(path);
+		if (!stream || std::abs(GetAudioStreamLength(stream) - 0.5) > 1e-6)
+			Error("WAV streams with the data chunk first did not open!");
+
+		CloseAudioStream(stream);
+		remove(path);
+	}
+}
+
+/* Formats that would divide by zero or split frames are rejected */
+static void checkWaveFormat()
+{
+	std::vector<int16_t> samples(100, 1000);
+	auto silent = makeWave(samples, 0, false);
+	auto misaligned = makeWave(samples, 44100, false);
+	misaligned[32] = 3; // blockAlign of the fmt chunk
+	WaveInfo info = {};
+
+	if (ReadWaveInfo(silent.data(), silent.size(), &info))
+		Error("WAV files with a frequency of 0 were read!");
+	if (ReadWaveInfo(misaligned.data(), misaligned.size(), &info))
+		Error("WAV files with a mismatched block size were read!");
+}
+
+static void benchmarkAudio()
+{
+	const uint frequency = 44100;
+	checkWaveChunkOrder();
+	checkWaveFormat();
+
+	for (double length : {0.1, 1.0, 10.0})
+	{
+		std::vector<int16_t> samples((size_t)(frequency * length));
+		for (size_t i = 0; i < samples.size(); i++)
+			samples[i] = (int16_t)(std::sin(i * 0.05) * 16000);
+
+		uint bytes = (uint)(samples.size() * sizeof(int16_t));
+		char name[64];
+		snprintf(name, sizeof(name), "CreateAudioClip/%gs", length);
+
+		// Only creating is timed, the clips are destroyed afterwards
+		benchmark(name, [&](uint iterations) {
+			std::vector<AudioClip> clips(iterations);
+			auto start = BenchmarkClock::now();
+
+			for (auto &clip : clips)
+				clip = CreateAudioClip(AL_FORMAT_MONO16,
+									   (const char *)samples.data(), bytes, frequency);
+
+			double elapsed = seconds(start);
+			for (auto &clip : clips)
+				DestroyAudioClip(clip);
+			return elapsed;
+		}, bytes);
+	}
+}
+
+static void benchmarkInput()
+{
+	// Drained in batches like a frame would, so the ring never fills up
+	static InputEvent events[256];
+	uint pending = 0;
+	auto drain = [&] {
+		if (++pending < 256) return;
+		DrainInputEvents(events, 256);
+		pending = 0;
+	};
+
+	int key = 0;
+	benchmark("DispatchKeyEvent", loop([&] { DispatchKeyEvent(key++ & 255, 1, 0); drain(); }));
+	DrainInputEvents(events, 256);
+	pending = 0;
+
+	double x = 0;
+	benchmark("DispatchCursorEvent", loop([&] { DispatchCursorEvent(x++, 0); drain(); }));
+	DrainInputEvents(events, 256);
+}
+
+static void benchmarkText()
+{
+	std::vector<Color> canvas(320 * 240);
+	const char *line = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789";
+
+	for (bool cache : {false, true})
+	{
+		uint y = 0;
+		benchmark(cache ? "CanvasDrawText/cached" : "CanvasDrawText", loop([&] {
+			CanvasDrawText(canvas.data(), PixelFormat::RGB24, 320, 240, 0, line,
+						   0, (int)(y++ % 235), Color{255, 255, 255}, 1, cache, 1);
+		}));
+	}
+}
+
+static void benchmarkBroadphase()
+{
+	for (uint count : {1000u, 10000u})
+	{
+		// Boxes of 4 to 24 units over an area growing with the count, so
+		// the density and the pairs per box stay the same
+		std::vector<float> boxes(count * 4);
+		std::vector<uint64_t> entities(count);
+		uint seed = 1;
+		auto next = [&](float range) {
+			seed = seed * 1664525u + 1013904223u;
+			return (seed >> 8) * (range / 16777216.0f);
+		};
+
+		float extent = std::sqrt((float)count) * 28;
+		for (uint i = 0; i < count; i++)
+		{
+			boxes[i * 4] = next(extent), boxes[i * 4 + 1] = next(extent);
+			boxes[i * 4 + 2] = 4 + next(20), boxes[i * 4 + 3] = 4 + next(20);
+			entities[i] = i + 1;
+		}
+
+		uint id = CreateBroadphase(32);
+		auto suffix = "/" + std::to_string(count);
+
+		benchmark("BuildBroadphase" + suffix, loop([&] {
+			ClearBroadphase(id);
+			InsertBroadphase(id, entities.data(), boxes.data(), sizeof(float) * 4, count);
+			BuildBroadphase(id);
+		}));
+
+		benchmark("FindBroadphasePairs" + suffix, loop([&] {
+			BuildBroadphase(id);
+			FindBroadphasePairs(id, nullptr, 0);
+		}));
+
+		DestroyBroadphase(id);
+	}
+}
+
+static void benchmarkTileGrid()
+{
+	// A walled 64x64 map with scattered pillars, cast from the middle
+	const uint size = 64;
+	std::vector<unsigned char> tiles(size * size);
+	for (uint y = 0; y < size; y++)
+		for (uint x = 0; x < size; x++)
+			tiles[y * size + x] = x == 0 || y == 0 || x == size - 1 || y == size - 1 ||
+								  (x % 7 == 3 && y % 5 == 2);
+
+	uint id = CreateTileGrid(size, size);
+	SetTiles(id, 0, 0, size, size, tiles.data());
+
+	for (uint columns : {320u, 1280u})
+	{
+		// One ray per screen column over a 70 degree field of view
+		std::vector<float> directions(columns * 2);
+		for (uint i = 0; i < columns; i++)
+		{
+			float angle = ((float)i / columns - 0.5f) * 1.2217f + 0.3f;
+			directions[i * 2] = std::cos(angle), directions[i * 2 + 1] = std::sin(angle);
+		}
+
+		std::vector<TileHit> hits(columns);
+		benchmark("CastTileRays/" + std::to_string(columns), loop([&] {
+			CastTileRays(id, 32.5f, 31.5f, directions.data(), columns, 100, hits.data());
+		}));
+	}
+
+	DestroyTileGrid(id);
+}
+
+static void benchmarkCapture()
+{
+	const uint width = 1280, height = 720;
+	bindRenderTarget(width, height);
+	glClearColor(0.2f, 0.4f, 0.6f, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	char directory[] = "/tmp/szark-capture-XXXXXX";
+	if (!mkdtemp(directory)) return;
+	std::string path = directory + std::string("/capture");
+
+	// Reading back and writing every frame on the render thread
+	FILE *file = fopen((path + ".rgb").c_str(), "wb");
+	std::vector<Color> pixels((size_t)width * height);
+	benchmark("CaptureFrame/sync", loop([&] {
+		ReadFramebuffer(pixels.data(), width, height);
+		fwrite(pixels.data(), sizeof(Color), pixels.size(), file);
+	}));
+	fclose(file);
+
+	// Frames the writer can't keep up with are dropped, not waited for
+	StartCapture((path + ".y4m").c_str(), CaptureFormat::Y4M, 60, 8);
+	benchmark("CaptureFrame/async", loop(CaptureFrame));
+	FinishCapture();
+
+	std::filesystem::remove_all(directory);
+}
+
+int main(int argc, char **argv)
+{
+	const char *output = nullptr, *baseline = nullptr;
+	double threshold = 0.1;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string option = argv[i];
+		if (option == "--warmup") s_warmup = (uint)atoi(argv[i + 1]);
+		else if (option == "--repetitions") s_repetitions = std::max(1, atoi(argv[i + 1]));
+		else if (option == "--filter") s_filter = argv[i + 1];
+		else if (option == "--output") output = argv[i + 1];
+		else if (option == "--baseline") baseline = argv[i + 1];
+		else if (option == "--threshold") threshold = atof(argv[i + 1]);
+	}
+
+	// Never open a real audio device, even when there is one
+	setenv("ALSOFT_DRIVERS", "null", 0);
+
+	SetErrorCallback([](const char *message) {
+		fprintf(stderr, "error: %s\n", message);
+		s_errorCount++;
+	});
+
+	if (!createOffscreenContext())
+	{
+		fprintf(stderr, "Failed to create an offscreen OpenGL context!\n");
+		return 1;
+	}
+
+	fprintf(stderr, "Renderer: %s\n", glGetString(GL_RENDERER));
+
+	InitializeRenderer();
+	InitializeAudioContext();
+
+	benchmarkTextures();
+	benchmarkDrawing();
+	benchmarkShaders();
+	benchmarkAudio();
+	benchmarkInput();
+	benchmarkText();
+	benchmarkBroadphase();
+	benchmarkTileGrid();
+	benchmarkCapture();
+
+	FILE *file = output ? fopen(output, "w") : stdout;
+	if (!file)
+	{
+		fprintf(stderr, "Failed to open %s!\n", output);
+		return 1;
+	}
+
+	writeResults(file);
+	if (file != stdout) fclose(file);
+
+	if (baseline)
+	{
+		std::map<std::string, double> medians;
+		if (!readBaseline(baseline, medians))
+		{
+			fprintf(stderr, "Failed to read the baseline %s!\n", baseline);
+			return 1;
+		}
+
+		if (compareBaseline(medians, threshold) > 0)
+			return 2;
+	}
+
+	return s_errorCount > 0 ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Runtime.InteropServices;
+
+using Szark.Audio;
+using Szark.Graphics;
+
+namespace Szark
+{
+    /// <summary>
+    /// A packed file of named assets, memory mapped once and read in place.
+    /// Open it at startup and load textures and audio from it by name
+    /// without reading or copying any file.
+    /// </summary>
+    public sealed class Archive : IDisposable
+    {
+        /// <summary>
+        /// How many assets the archive holds
+        /// </summary>
+        public int Count => (int)Core.GetArchiveEntryCount(id);
+
+        /// <summary>
+        /// The name of every asset in the archive
+        /// </summary>
+        public IEnumerable<string> Names
+        {
+            get
+            {
+                for (uint i = 0; i < Core.GetArchiveEntryCount(id); i++)
+                    yield return Marshal.PtrToStringAnsi(
+                        Core.GetArchiveEntryName(id, i))!;
+            }
+        }
+
+        private uint id;
+
+        private Archive(uint id) => this.id = id;
+
+        /// <summary>
+        /// Maps an archive made with Pack.
+        /// Returns null if the file isn't a valid archive.
+        /// </summary>
+        public static Archive? Open(string filePath)
+        {
+            uint id = Core.OpenArchive(filePath);
+            return id == 0 ? null : new Archive(id);
+        }
+
+        /// <summary>
+        /// Packs every file under a directory into an archive. Assets are
+        /// named by their path relative to the directory, using '/'.
+        /// </summary>
+        public static bool Pack(string archivePath, string directory)
+        {
+            var files = Directory.GetFiles(directory, "*", SearchOption.AllDirectories);
+            return Pack(archivePath, files.ToDictionary(
+                file => Path.GetRelativePath(directory, file).Replace('\\', '/')));
+        }
+
+        /// <summary>
+        /// Packs files into an archive under the given asset names
+        /// </summary>
+        /// <param name="files">Asset names and the files to pack under them</param>
+        public static bool Pack(string archivePath, IReadOnlyDictionary<string, string> files) =>
+            Core.WriteArchive(archivePath, files.Keys.ToArray(),
+                files.Values.ToArray(), (uint)files.Count);
+
+        /// <summary>
+        /// Whether the archive holds an asset of that name
+        /// </summary>
+        public unsafe bool Contains(string name) =>
+            Core.FindArchiveEntry(id, name, out _) != null;
+
+        /// <summary>
+        /// The bytes of an asset, read straight from the mapping. Empty if
+        /// there is no such asset, and invalid once the archive is disposed.
+        /// Throws for assets of 2 GB or more, which don't fit in a span.
+        /// </summary>
+        public unsafe ReadOnlySpan<byte> GetData(string name)
+        {
+            var data = Core.FindArchiveEntry(id, name, out ulong size);
+            if (data != null && size > int.MaxValue)
+                throw new InvalidOperationException($"{name} is too large for a span!");
+
+            return data == null ? default : new ReadOnlySpan<byte>(data, (int)size);
+        }
+
+        /// <summary>
+        /// Decodes a BMP, TGA or PNG asset into a texture. A magenta
+        /// texture stands in when the asset can't be read.
+        /// </summary>
+        public unsafe Texture ReadTexture(string name) =>
+            new Texture(Find(name, out ulong size), size, name);
+
+        /// <summary>
+        /// Reads a PCM WAV asset into a clip
+        /// </summary>
+        public unsafe AudioClip? ReadAudioClip(string name)
+        {
+            var wave = Find(name, out ulong size);
+            return wave == null ? null : Audio.Audio.ReadFile(wave, size, name);
+        }
+
+        /// <summary>
+        /// Reads a PCM WAV asset into a sound for the mixer
+        /// </summary>
+        public unsafe Sound? ReadSound(string name)
+        {
+            var wave = Find(name, out ulong size);
+            return wave == null ? null : Audio.Audio.ReadSound(wave, size, name);
+        }
+
+        /// <summary>
+        /// Unmaps the archive. Assets already loaded from it stay valid.
+        /// </summary>
+        public void Dispose()
+        {
+            if (id == 0) return;
+            Core.CloseArchive(id);
+            id = 0;
+        }
+
+        private unsafe byte* Find(string name, out ulong size)
+        {
+            var data = (byte*)Core.FindArchiveEntry(id, name, out size);
+            if (data == null)
+                Game.Get<Game>()?.Error($"Archive has no asset named {name}!");
+            return data;
+        }
+    }
+}
@@ -0,0 +1,33 @@
+using System.Runtime.InteropServices;
+
+namespace Szark
+{
+    /// <summary>
+    /// How recorded frames are written to disk. Y4M is a raw YUV 4:4:4
+    /// video most players and encoders read, PPM is an image per frame
+    /// for comparing against golden images, and Delta only stores the
+    /// pixels that changed since the previous frame.
+    /// </summary>
+    public enum CaptureFormat : uint
+    {
+        Y4M,
+        PPM,
+        Delta
+    }
+
+    /// <summary>
+    /// Frames offered to the recording, written to disk and dropped
+    /// because the readbacks or the writer fell behind, plus the bytes
+    /// written and how many frames wait in the writer queue
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct CaptureStats
+    {
+        public ulong Frames, Written, Dropped, Bytes;
+        public uint Queued, PeakQueued, Capacity;
+
+        public override string ToString() =>
+            $"Written: {Written}/{Frames}, Dropped: {Dropped}, " +
+            $"Queue: {Queued}/{Capacity} (peak {PeakQueued})";
+    }
+}
@@ -4,6 +4,7 @@ using System;
 using Szark.Audio;
 using Szark.Graphics;
 using Szark.Input;
+using Szark.Physics;
 
 namespace Szark
 {
@@ -22,6 +23,7 @@ namespace Szark
         Opened,
         Closed,
         Render,
+        Tick,
     }
 
     [StructLayout(LayoutKind.Sequential)]
@@ -30,23 +32,20 @@ namespace Szark
     [StructLayout(LayoutKind.Sequential)]
     internal struct Rect { public int x, y, width, height; }
 
-    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    internal delegate void KeyCallback(Key key, Action action);
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct QueryChunk { public uint count; public IntPtr entities; }
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     internal delegate void ErrorCallback([MarshalAs(UnmanagedType.LPStr)] string msg);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    internal delegate void MouseCallback(int button, Action action);
-
-    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    internal delegate void ScrollCallback(double dx, double dy);
+    internal delegate void WindowEventCallback(IntPtr window, WindowEvent ev);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    internal delegate void CursorCallback(double x, double y);
+    internal delegate void JobCallback(uint index, uint worker);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    internal delegate void WindowEventCallback(IntPtr window, WindowEvent ev);
+    internal delegate void TileCallback(ref Rect tile, uint worker);
 
     internal class Core
     {
@@ -59,16 +58,18 @@ namespace Szark
         internal static extern void SetWindowEventCallback(WindowEventCallback callback);
 
         [DllImport(CorePath)]
-        internal static extern void SetKeyCallback(KeyCallback callback);
+        internal static extern uint DrainInputEvents(ref InputEvent events,
+            uint capacity);
 
         [DllImport(CorePath)]
-        internal static extern void SetMouseCallback(MouseCallback callback);
+        internal static extern double GetInputTime();
 
         [DllImport(CorePath)]
-        internal static extern void SetScrollCallback(ScrollCallback callback);
+        internal static extern InputStats GetInputStats();
 
         [DllImport(CorePath)]
-        internal static extern void SetCursorCallback(CursorCallback callback);
+        internal static extern void SetInputThread(
+            [MarshalAs(UnmanagedType.I1)] bool enabled);
 
         [DllImport(CorePath, CharSet = CharSet.Ansi)]
         internal static extern IntPtr Create(string title, uint width,
@@ -80,26 +81,69 @@ namespace Szark
         [DllImport(CorePath)]
         internal static extern void Close(IntPtr window);
 
+        [DllImport(CorePath)]
+        internal static extern void ShowHeadless(uint width, uint height,
+            uint frames, double fixedStep);
+
         [DllImport(CorePath)]
         internal static extern Point GetCursor();
 
         [DllImport(CorePath)]
         internal static extern uint GenerateTextureID(
-            [MarshalAs(UnmanagedType.LPArray)] Color[] pixels,
-            uint width, uint height
+            ref byte pixels, uint width, uint height, PixelFormat format
         );
 
         [DllImport(CorePath)]
-        internal static extern uint UpdateTexture(
-            uint textureID,
-            [MarshalAs(UnmanagedType.LPArray)] Color[] pixels,
-            uint width, uint height
+        internal static extern void UpdateTexture(
+            uint textureID, ref byte pixels, uint width, uint height
+        );
+
+        [DllImport(CorePath)]
+        internal static extern void UpdateTextureRegions(
+            uint textureID, ref byte pixels,
+            uint width, uint height,
+            [MarshalAs(UnmanagedType.LPArray)] Rect[] regions, uint count
         );
 
+        [DllImport(CorePath)]
+        internal static extern void SetPalette(ref Color colors,
+            uint first, uint count);
+
+        [DllImport(CorePath)]
+        internal static extern void SetTextureFilter(uint id,
+            [MarshalAs(UnmanagedType.I1)] bool linear);
+
+        [DllImport(CorePath)]
+        internal static extern uint CreateStreamingTexture(uint width,
+            uint height, PixelFormat format);
+
+        [DllImport(CorePath)]
+        internal static extern IntPtr GetStreamingPixels(uint id);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool ResizeStreamingTexture(uint id,
+            uint width, uint height);
+
+        [DllImport(CorePath)]
+        internal static extern void StreamTextureRegions(uint id,
+            [MarshalAs(UnmanagedType.LPArray)] Rect[] regions, uint count);
+
+        [DllImport(CorePath)]
+        internal static extern void DestroyStreamingTexture(uint id);
+
         [DllImport(CorePath, CharSet = CharSet.Ansi)]
         internal static extern Shader CompileShader(string vertexSrc,
             string fragmentSrc);
 
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        internal static extern void SetShaderCacheDirectory(string? path);
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool WatchShader(uint id, string vertexPath,
+            string fragmentPath);
+
         [DllImport(CorePath)]
         internal static extern void InitializeRenderer();
 
@@ -115,15 +159,257 @@ namespace Szark
         [DllImport(CorePath)]
         internal static extern void RenderQuad();
 
+        [DllImport(CorePath)]
+        internal static extern uint CreateBitmapFont(
+            [MarshalAs(UnmanagedType.LPArray)] byte[] coverage,
+            uint glyphWidth, uint glyphHeight, uint first, uint count);
+
+        [DllImport(CorePath)]
+        internal static extern void DestroyFont(uint font);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool GetFontSize(uint font,
+            out uint glyphWidth, out uint glyphHeight);
+
+        [DllImport(CorePath)]
+        internal static extern uint MeasureText(uint font,
+            [MarshalAs(UnmanagedType.LPUTF8Str)] string text, int spacing);
+
+        [DllImport(CorePath)]
+        internal static extern uint CanvasDrawText(
+            ref byte target, PixelFormat format, uint width, uint height,
+            uint font, [MarshalAs(UnmanagedType.LPUTF8Str)] string text, int x, int y,
+            Color color, int spacing, [MarshalAs(UnmanagedType.I1)] bool cache,
+            float scale
+        );
+
+        [DllImport(CorePath)]
+        internal static extern void SubmitText(uint font,
+            [MarshalAs(UnmanagedType.LPUTF8Str)] string text,
+            float x, float y, float scale, Color color, int spacing,
+            float depth);
+
+        [DllImport(CorePath)]
+        internal static extern void SubmitSprites(uint atlas, ref Sprite sprites,
+            uint count);
+
+        [DllImport(CorePath)]
+        internal static extern void SetSpriteColorKey(Color key,
+            [MarshalAs(UnmanagedType.I1)] bool enabled);
+
+        [DllImport(CorePath)]
+        internal static extern void RenderSprites(uint screenWidth,
+            uint screenHeight);
+
         [DllImport(CorePath)]
         internal static extern double GetDeltaTime();
 
+        [DllImport(CorePath)]
+        internal static extern ulong GetFrameCount();
+
+        [DllImport(CorePath)]
+        internal static extern void SetTickRate(double ticksPerSecond);
+
+        [DllImport(CorePath)]
+        internal static extern void SetSnapshotSize(uint size);
+
+        [DllImport(CorePath)]
+        internal static extern IntPtr GetTickSnapshot();
+
+        [DllImport(CorePath)]
+        internal static extern IntPtr GetRenderSnapshot(
+            [MarshalAs(UnmanagedType.I1)] bool previous);
+
+        [DllImport(CorePath)]
+        internal static extern double GetInterpolation();
+
+        [DllImport(CorePath)]
+        internal static extern LoopStats GetLoopStats();
+
+        [DllImport(CorePath)]
+        internal static extern void SetResolutionScaling(double frameBudget,
+            float minScale, float maxScale);
+
+        [DllImport(CorePath)]
+        internal static extern float GetRenderScale();
+
+        [DllImport(CorePath)]
+        internal static extern uint GetResolutionHistory(
+            ref ResolutionSample samples, uint capacity);
+
+        [DllImport(CorePath)]
+        internal static extern void SetProfilerEnabled(
+            [MarshalAs(UnmanagedType.I1)] bool enabled);
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        internal static extern uint RegisterProfileZone(string name);
+
+        [DllImport(CorePath)]
+        internal static extern uint GetProfileZoneCount();
+
+        [DllImport(CorePath)]
+        internal static extern IntPtr GetProfileZoneName(uint zone);
+
+        [DllImport(CorePath)]
+        internal static extern void BeginProfileZone(uint zone);
+
+        [DllImport(CorePath)]
+        internal static extern void EndProfileZone();
+
+        [DllImport(CorePath)]
+        internal static extern ProfileStats GetProfileStats(uint zone,
+            [MarshalAs(UnmanagedType.I1)] bool gpu);
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool SaveProfileTrace(string path);
+
+        [DllImport(CorePath)]
+        internal static extern int RegisterComponent(uint size, uint alignment);
+
+        [DllImport(CorePath)]
+        internal static extern ulong CreateEntity();
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool DestroyEntity(ulong entity);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool IsEntityAlive(ulong entity);
+
+        [DllImport(CorePath)]
+        internal static extern uint GetEntityCount();
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern unsafe bool AddComponent(ulong entity,
+            uint component, void* data);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool RemoveComponent(ulong entity, uint component);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool HasComponent(ulong entity, uint component);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe void* GetComponent(ulong entity,
+            uint component);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe uint QueryChunks(ulong all, ulong none,
+            uint* columns, uint columnCount, QueryChunk* chunks,
+            IntPtr* columnPointers, uint capacity);
+
+        [DllImport(CorePath)]
+        internal static extern uint CreateBroadphase(float cellSize);
+
+        [DllImport(CorePath)]
+        internal static extern void DestroyBroadphase(uint broadphase);
+
+        [DllImport(CorePath)]
+        internal static extern void ClearBroadphase(uint broadphase);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe void InsertBroadphase(uint broadphase,
+            ulong* entities, void* bounds, uint stride, uint count);
+
+        [DllImport(CorePath)]
+        internal static extern void BuildBroadphase(uint broadphase);
+
+        [DllImport(CorePath)]
+        internal static extern uint FindBroadphasePairs(uint broadphase,
+            ref EntityPair pairs, uint capacity);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe uint QueryBroadphasePoint(uint broadphase,
+            float x, float y, ulong* entities, uint capacity);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe uint QueryBroadphaseRect(uint broadphase,
+            float x, float y, float width, float height, ulong* entities,
+            uint capacity);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe uint RaycastBroadphase(uint broadphase,
+            Ray* rays, uint count, RaycastHit* hits);
+
+        [DllImport(CorePath)]
+        internal static extern BroadphaseStats GetBroadphaseStats(uint broadphase);
+
+        [DllImport(CorePath)]
+        internal static extern uint CreateTileGrid(uint width, uint height);
+
+        [DllImport(CorePath)]
+        internal static extern void DestroyTileGrid(uint grid);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe void SetTiles(uint grid, int x, int y,
+            uint width, uint height, byte* tiles);
+
+        [DllImport(CorePath)]
+        internal static extern byte GetTile(uint grid, int x, int y);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe uint CastTileRays(uint grid, float x,
+            float y, float* directions, uint count, float maxDistance,
+            TileHit* hits);
+
+        [DllImport(CorePath)]
+        internal static extern void InitializeJobSystem(uint workers);
+
+        [DllImport(CorePath)]
+        internal static extern uint GetWorkerCount();
+
+        [DllImport(CorePath)]
+        internal static extern void DispatchJobs(uint count, JobCallback job);
+
+        [DllImport(CorePath)]
+        internal static extern void DispatchTiles(uint width, uint height,
+            uint tileSize, TileCallback tile);
+
+        [DllImport(CorePath)]
+        internal static extern double GetJobStats(
+            [MarshalAs(UnmanagedType.LPArray), Out] JobStats[]? stats, uint count);
+
+        [DllImport(CorePath)]
+        internal static extern void ResetJobStats();
+
         [DllImport(CorePath)]
         internal static extern Rect GetPrimaryMonitorRect();
 
         [DllImport(CorePath)]
         internal static extern void SetViewport(int x, int y, int w, int h);
 
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool ReadFramebuffer(
+            [MarshalAs(UnmanagedType.LPArray)] Color[] pixels,
+            uint width, uint height
+        );
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool SaveFramebuffer(string path);
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool StartCapture(string path,
+            CaptureFormat format, uint frameRate, uint queueFrames);
+
+        [DllImport(CorePath)]
+        internal static extern void StopCapture();
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool IsCapturing();
+
+        [DllImport(CorePath)]
+        internal static extern CaptureStats GetCaptureStats();
+
         [DllImport(CorePath)]
         internal static extern void InitializeAudioContext();
 
@@ -134,13 +420,65 @@ namespace Szark
         internal static extern void StopAudioClip(uint id);
 
         [DllImport(CorePath)]
-        internal static extern AudioClip CreateAudioClip(int format,
-            [MarshalAs(UnmanagedType.LPArray)] byte[] buffer, uint length, uint freq
-        );
+        internal static extern unsafe AudioClip CreateAudioClip(int format,
+            byte* buffer, uint length, uint freq);
 
         [DllImport(CorePath)]
         internal static extern void DestroyAudioClip(AudioClip clip);
 
+        [DllImport(CorePath)]
+        internal static extern void InitializeMixer(uint voices);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe uint CreateSound(int format,
+            byte* buffer, uint length, uint freq);
+
+        [DllImport(CorePath)]
+        internal static extern void DestroySound(uint sound);
+
+        [DllImport(CorePath)]
+        internal static extern uint StartVoice(uint sound, float volume,
+            float pan, int priority);
+
+        [DllImport(CorePath)]
+        internal static extern void SetVoiceGain(uint voice, float volume,
+            float pan);
+
+        [DllImport(CorePath)]
+        internal static extern void StopVoice(uint voice);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool IsVoicePlaying(uint voice);
+
+        [DllImport(CorePath)]
+        internal static extern MixerStats GetMixerStats();
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        internal static extern uint OpenAudioStream(string path);
+
+        [DllImport(CorePath)]
+        internal static extern void PlayAudioStream(uint id, float volume,
+            [MarshalAs(UnmanagedType.I1)] bool loop);
+
+        [DllImport(CorePath)]
+        internal static extern void StopAudioStream(uint id);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool IsAudioStreamPlaying(uint id);
+
+        [DllImport(CorePath)]
+        internal static extern double GetAudioStreamLength(uint id);
+
+        [DllImport(CorePath)]
+        internal static extern void CloseAudioStream(uint id);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern unsafe bool ReadWaveInfo(void* wave, ulong size,
+            out WaveInfo info);
+
         [DllImport(CorePath)]
         internal static extern void SetVSync(bool enabled);
 
@@ -159,5 +497,89 @@ namespace Szark
 
         [DllImport(CorePath, CharSet = CharSet.Ansi)]
         internal static extern int GetUniformLocation(uint program, string name);
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        internal static extern uint CreateParameterBlock(uint program, string name);
+
+        [DllImport(CorePath)]
+        internal static extern uint GetParameterBlockSize(uint id);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe uint UpdateParameterBlock(uint id,
+            void* data, uint size);
+
+        [DllImport(CorePath)]
+        internal static extern void DestroyParameterBlock(uint id);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern unsafe bool ReadImageSize(void* image, ulong size,
+            out uint width, out uint height);
+
+        [DllImport(CorePath)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern unsafe bool DecodeImage(void* image, ulong size,
+            ref Color pixels, uint width, uint height);
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        internal static extern unsafe void* MapAssetFile(string path, out ulong size);
+
+        [DllImport(CorePath)]
+        internal static extern unsafe void UnmapAssetFile(void* data);
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        internal static extern uint OpenArchive(string path);
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        internal static extern unsafe void* FindArchiveEntry(uint archive,
+            string name, out ulong size);
+
+        [DllImport(CorePath)]
+        internal static extern uint GetArchiveEntryCount(uint archive);
+
+        [DllImport(CorePath)]
+        internal static extern IntPtr GetArchiveEntryName(uint archive, uint index);
+
+        [DllImport(CorePath)]
+        internal static extern void CloseArchive(uint archive);
+
+        [DllImport(CorePath, CharSet = CharSet.Ansi)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        internal static extern bool WriteArchive(string path, string[] names,
+            string[] files, uint count);
+
+        [DllImport(CorePath)]
+        internal static extern void CanvasFillRect(
+            ref byte target, PixelFormat format,
+            uint width, uint height, int x, int y, int w, int h, Color color
+        );
+
+        [DllImport(CorePath)]
+        internal static extern void CanvasFillCircle(
+            ref byte target, PixelFormat format,
+            uint width, uint height, int x, int y, int radius, Color color
+        );
+
+        [DllImport(CorePath)]
+        internal static extern void CanvasFillTriangle(
+            ref byte target, PixelFormat format,
+            uint width, uint height, int x1, int y1, int x2, int y2,
+            int x3, int y3, Color color
+        );
+
+        [DllImport(CorePath)]
+        internal static extern void CanvasDrawLine(
+            ref byte target, PixelFormat format,
+            uint width, uint height, int x1, int y1, int x2, int y2,
+            Color color, int thickness
+        );
+
+        [DllImport(CorePath)]
+        internal static extern void CanvasDrawTexture(
+            ref byte target, PixelFormat format,
+            uint width, uint height,
+            ref byte source, PixelFormat sourceFormat,
+            uint sourceWidth, uint sourceHeight, int x, int y, int w, int h
+        );
     }
 }
@@ -1,6 +1,9 @@
 ﻿using System;
+using System.IO;
 using System.Runtime.CompilerServices;
+using System.Runtime.ExceptionServices;
 using System.Reflection;
+using System.Threading;
 
 using Szark.ECS;
 using Szark.Graphics;
@@ -48,6 +51,48 @@ namespace Szark
         /// </summary>
         public int ScreenHeight { get; private set; }
 
+        /// <summary>
+        /// Seconds a frame may take to render before the canvas
+        /// resolution is lowered to fit, 0 always renders at full size.
+        /// Must be set before the Game runs.
+        /// </summary>
+        public double FrameBudget { get; set; }
+
+        /// <summary>
+        /// The lowest scale of the screen size the canvas is lowered to.
+        /// Must be set before the Game runs.
+        /// </summary>
+        public float MinRenderScale { get; set; } = 0.5f;
+
+        /// <summary>
+        /// The highest scale of the screen size the canvas is raised to.
+        /// Must be set before the Game runs.
+        /// </summary>
+        public float MaxRenderScale { get; set; } = 1;
+
+        /// <summary>
+        /// Filters a lowered canvas when it is stretched over the screen
+        /// instead of showing its pixels as blocks. Software rendering
+        /// always shows blocks. Must be set before the Game runs.
+        /// </summary>
+        public bool SmoothScaling { get; set; }
+
+        /// <summary>
+        /// The scale of the screen size the canvas is drawn at this frame
+        /// </summary>
+        public float RenderScale { get; private set; } = 1;
+
+        /// <summary>
+        /// The pixel width the canvas is drawn at this frame. The canvas
+        /// itself is always ScreenWidth wide and maps onto it.
+        /// </summary>
+        public int RenderWidth { get; private set; }
+
+        /// <summary>
+        /// The pixel height the canvas is drawn at this frame
+        /// </summary>
+        public int RenderHeight { get; private set; }
+
         /// <summary>
         /// The size of each pixel on screen
         /// </summary>
@@ -63,6 +108,86 @@ namespace Szark
         /// </summary>
         public bool IsFullscreen { get; private set; }
 
+        /// <summary>
+        /// Whether the Game is running without a window or OpenGL
+        /// </summary>
+        public bool IsHeadless { get; private set; }
+
+        /// <summary>
+        /// The amount of frames presented since the Game started
+        /// </summary>
+        public ulong FrameCount => Core.GetFrameCount();
+
+        /// <summary>
+        /// Simulation ticks per second. Above 0 OnTick runs at this fixed
+        /// rate on its own thread, independent of rendering and vsync.
+        /// Must be set before the Game runs.
+        /// </summary>
+        public double TickRate { get; set; }
+
+        /// <summary>
+        /// How far the current frame is between the previous and the
+        /// newest tick snapshot, from 0 to 1
+        /// </summary>
+        public float Interpolation => (float)Core.GetInterpolation();
+
+        /// <summary>
+        /// Tick and frame timing including their jitter
+        /// </summary>
+        public LoopStats LoopStats => Core.GetLoopStats();
+
+        /// <summary>
+        /// Renders the screen in parallel tiles through OnRenderTile
+        /// before OnRender is called
+        /// </summary>
+        public bool TiledRendering { get; set; }
+
+        /// <summary>
+        /// The width and height of each tile in pixels
+        /// </summary>
+        public int TileSize { get; set; } = 64;
+
+        /// <summary>
+        /// The pixel format of the screen texture the canvas draws to.
+        /// Indexed8 screens are colored through the Palette.
+        /// Must be set before the Game runs.
+        /// </summary>
+        public PixelFormat FramebufferFormat { get; set; }
+
+        /// <summary>
+        /// Polls input on the main thread while frames render on their
+        /// own thread, so input is sampled as it arrives rather than
+        /// once per frame. Shaders can't be watched with it on.
+        /// Must be set before the Game runs.
+        /// </summary>
+        public bool InputThread { get; set; }
+
+        /// <summary>
+        /// Every input event drained for this frame, oldest first
+        /// </summary>
+        public ReadOnlySpan<InputEvent> InputEvents =>
+            new ReadOnlySpan<InputEvent>(inputEvents, 0, inputEventCount);
+
+        /// <summary>
+        /// The current time on the clock input events are stamped with
+        /// </summary>
+        public double InputTime => Core.GetInputTime();
+
+        /// <summary>
+        /// Input event counts and input-to-present latency
+        /// </summary>
+        public InputStats InputStats => Core.GetInputStats();
+
+        /// <summary>
+        /// Where compiled shader programs are cached between runs so they
+        /// don't have to be compiled again, null disables the cache. It is
+        /// kept per user since the install directory may be read-only.
+        /// Must be set before the Game runs.
+        /// </summary>
+        public string? ShaderCacheDirectory { get; set; } = Path.Combine(
+            Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData),
+            "Szark", "shadercache");
+
         /// <summary>
         /// Sets whether window vsync is enabled
         /// </summary>
@@ -75,6 +200,11 @@ namespace Szark
             }
         }
 
+        /// <summary>
+        /// Sprites drawn on top of the canvas each frame
+        /// </summary>
+        public SpriteBatch Sprites { get; private set; }
+
         public Mouse Mouse { get; private set; }
         public Keyboard Keyboard { get; private set; }
         public Cursor Cursor { get; private set; }
@@ -92,14 +222,22 @@ namespace Szark
         private uint? customShader;
 
         private bool vsyncEnabled = true;
+        private int snapshotSize;
 
         // Window callbacks
-        private readonly MouseCallback mouseCallback;
         private readonly WindowEventCallback windowEventCallback;
-        private readonly ScrollCallback scrollCallback;
-        private readonly CursorCallback cursorCallback;
         private readonly ErrorCallback errorCallback;
-        private readonly KeyCallback keyCallback;
+        private readonly TileCallback tileCallback;
+
+        // Events drained this frame, the array grows when it fills up
+        private InputEvent[] inputEvents = new InputEvent[64];
+        private int inputEventCount;
+
+        private float tileDeltaTime;
+
+        // Exceptions can't unwind through the core's workers, the first
+        // one thrown by a tile is rethrown once every tile is done
+        private Exception? tileException;
 
         public Game(string title, uint width, uint height, uint pixelSize, bool fullscreen)
         {
@@ -110,6 +248,7 @@ namespace Szark
             Cursor = new Cursor();
             Keyboard = new Keyboard();
             Mouse = new Mouse();
+            Sprites = new SpriteBatch();
 
             Title = title;
             WindowWidth = width;
@@ -118,15 +257,14 @@ namespace Szark
 
             ScreenWidth = (int)width / (int)pixelSize;
             ScreenHeight = (int)height / (int)pixelSize;
+            RenderWidth = ScreenWidth;
+            RenderHeight = ScreenHeight;
             IsFullscreen = fullscreen;
 
             // Callbacks are required to be members
-            mouseCallback = new MouseCallback(Mouse.OnMouseEvent);
-            scrollCallback = new ScrollCallback(Mouse.OnScrollEvent);
             windowEventCallback = new WindowEventCallback(OnWindowEvent);
-            cursorCallback = new CursorCallback(Cursor.OnCursorEvent);
-            keyCallback = new KeyCallback(Keyboard.OnKeyboardEvent);
             errorCallback = new ErrorCallback(Error);
+            tileCallback = new TileCallback(RenderTile);
 
             EntityManager = new EntityManager(Assembly.GetCallingAssembly());
 
@@ -141,14 +279,126 @@ namespace Szark
             window = Core.Create(Title, WindowWidth,
                 WindowHeight, IsFullscreen);
             if (window.ToInt64() == 0) return;
+
+            Core.SetShaderCacheDirectory(CreateShaderCache());
+            Core.SetTickRate(TickRate);
+            Core.SetResolutionScaling(FrameBudget, MinRenderScale, MaxRenderScale);
+            Core.SetInputThread(InputThread);
             Core.Show(window);
         }
 
+        /// <summary>
+        /// Runs the Game against a CPU framebuffer without a window.
+        /// Custom shaders are ignored and the quad is scaled in software.
+        /// </summary>
+        /// <param name="frames">Frames to run, 0 runs until Stop()</param>
+        /// <param name="fixedStep">Fixed delta time, 0 uses real time</param>
+        public void RunHeadless(uint frames = 0, float fixedStep = 0)
+        {
+            IsHeadless = true;
+            Core.SetTickRate(TickRate);
+            Core.SetResolutionScaling(FrameBudget, MinRenderScale, MaxRenderScale);
+            Core.ShowHeadless(WindowWidth, WindowHeight, frames, fixedStep);
+        }
+
         /// <summary>
         /// Stops the Game and closes the window
         /// </summary>
         public void Stop() => Core.Close(window);
 
+        /// <summary>
+        /// Reads back the last presented frame, top row first
+        /// </summary>
+        public Color[] ReadFrame()
+        {
+            var pixels = new Color[WindowWidth * WindowHeight];
+            Core.ReadFramebuffer(pixels, WindowWidth, WindowHeight);
+            return pixels;
+        }
+
+        /// <summary>
+        /// Saves the last presented frame as a PPM image
+        /// </summary>
+        public bool SaveFrame(string path) =>
+            Core.SaveFramebuffer(path);
+
+        /// <summary>
+        /// Starts recording every presented frame, sprites included, to
+        /// disk on a writer thread. Y4M and Delta write a single file at
+        /// the path, PPM writes a file per frame named with the path
+        /// followed by the frame number. Frames are dropped rather than
+        /// slowing the Game down once queueFrames wait for the writer,
+        /// Y4M repeats the frame before a drop to keep its frame rate.
+        /// Safe from any thread, recording begins with the next frame.
+        /// </summary>
+        public bool StartCapture(string path, CaptureFormat format,
+            uint frameRate = 60, uint queueFrames = 8) =>
+            Core.StartCapture(path, format, frameRate, queueFrames);
+
+        /// <summary>
+        /// Writes the frames still waiting and closes the recording before
+        /// the next frame. Safe from any thread, it also stops by itself
+        /// when the Game closes.
+        /// </summary>
+        public void StopCapture() => Core.StopCapture();
+
+        /// <summary>
+        /// Whether presented frames are being recorded, or will be from
+        /// the next frame on
+        /// </summary>
+        public bool IsCapturing => Core.IsCapturing();
+
+        /// <summary>
+        /// Frames recorded, written and dropped, and the writer queue
+        /// </summary>
+        public CaptureStats CaptureStats => Core.GetCaptureStats();
+
+        /// <summary>
+        /// Render time and scale of the latest frames, oldest first
+        /// </summary>
+        public ResolutionSample[] GetResolutionHistory()
+        {
+            var samples = new ResolutionSample[240];
+            uint count = Core.GetResolutionHistory(ref samples[0], (uint)samples.Length);
+            Array.Resize(ref samples, (int)count);
+            return samples;
+        }
+
+        /// <summary>
+        /// Sets the type of state handed from OnTick to OnRender.
+        /// Call it in OnCreated, before the first tick.
+        /// </summary>
+        protected void UseSnapshot<T>() where T : unmanaged
+        {
+            snapshotSize = Unsafe.SizeOf<T>();
+            Core.SetSnapshotSize((uint)snapshotSize);
+        }
+
+        /// <summary>
+        /// Publishes the state of this tick, only valid inside OnTick
+        /// </summary>
+        protected unsafe void WriteSnapshot<T>(in T state) where T : unmanaged
+        {
+            var snapshot = Core.GetTickSnapshot();
+            if (snapshot == IntPtr.Zero || sizeof(T) > snapshotSize)
+                throw new InvalidOperationException("Snapshot type was not set with UseSnapshot!");
+
+            *(T*)snapshot = state;
+        }
+
+        /// <summary>
+        /// Reads the newest or the previous tick state. Both stay the same
+        /// for a whole frame, blend them with Interpolation.
+        /// </summary>
+        protected unsafe T ReadSnapshot<T>(bool previous = false) where T : unmanaged
+        {
+            var snapshot = Core.GetRenderSnapshot(previous);
+            if (snapshot == IntPtr.Zero || sizeof(T) > snapshotSize)
+                throw new InvalidOperationException("Snapshot type was not set with UseSnapshot!");
+
+            return *(T*)snapshot;
+        }
+
         /// <summary>
         /// Compiles and uses a custom shader for the Canvas.
         /// Any shader errors are sent to the error callback.
@@ -162,6 +412,25 @@ namespace Szark
             return shader;
         }
 
+        /// <summary>
+        /// Compiles and uses a custom shader for the Canvas from files.
+        /// Any shader errors are sent to the error callback.
+        /// </summary>
+        /// <param name="vertexPath">The Vertex Shader file</param>
+        /// <param name="fragPath">The Fragment Shader file</param>
+        /// <param name="hotReload">Recompiles the shader when a file changes</param>
+        public Shader LoadCustomShader(string vertexPath, string fragPath,
+            bool hotReload = false)
+        {
+            var shader = SetCustomShader(File.ReadAllText(vertexPath),
+                File.ReadAllText(fragPath));
+
+            if (hotReload && shader.ID != 0)
+                shader.Watch(vertexPath, fragPath);
+
+            return shader;
+        }
+
         /// <summary>
         /// Called when the Game window has been created
         /// </summary>
@@ -174,6 +443,22 @@ namespace Szark
         /// <param name="deltaTime">Delta time</param>
         protected virtual void OnRender(Canvas canvas, float deltaTime) { }
 
+        /// <summary>
+        /// Called for every tile of the screen when TiledRendering is
+        /// enabled. Tiles run in parallel, only draw inside the tile.
+        /// </summary>
+        /// <param name="canvas">Canvas for drawing</param>
+        /// <param name="tile">The region of the screen to draw</param>
+        /// <param name="deltaTime">Delta time</param>
+        protected virtual void OnRenderTile(Canvas canvas, Tile tile, float deltaTime) { }
+
+        /// <summary>
+        /// Called at a fixed rate on the simulation thread when
+        /// TickRate is set. Share state with OnRender through snapshots.
+        /// </summary>
+        /// <param name="deltaTime">The fixed tick length</param>
+        protected virtual void OnTick(float deltaTime) { }
+
         /// <summary>
         /// Called when the window is closed
         /// </summary>
@@ -188,18 +473,25 @@ namespace Szark
             {
                 case WindowEvent.Opened:
                     Core.InitializeRenderer();
-                    Core.InitializeAudioContext();
+                    // Opens the audio context too, headless runs stay silent
+                    Core.InitializeMixer(0);
                     InitDrawTarget();
                     OnCreated();
                     break;
 
                 case WindowEvent.Closed:
                     OnDestroy();
+                    drawTarget?.Dispose();
                     break;
 
                 case WindowEvent.Render:
                     Render();
                     break;
+
+                case WindowEvent.Tick:
+                    using (Profiler.Zone("OnTick"))
+                        OnTick((float)(1.0 / TickRate));
+                    break;
             }
         }
 
@@ -211,10 +503,31 @@ namespace Szark
             Core.SetViewport(x, y, w, h);
 
             float deltaTime = (float)Core.GetDeltaTime();
+            PollInput();
+            ApplyRenderScale(false);
 
             if (canvas != null)
             {
-                OnRender(canvas, deltaTime);
+                // Returns once every tile is done
+                if (TiledRendering)
+                {
+                    using (Profiler.Zone("OnRenderTile"))
+                    {
+                        tileDeltaTime = deltaTime;
+                        tileException = null;
+                        Core.DispatchTiles((uint)ScreenWidth, (uint)ScreenHeight,
+                            (uint)TileSize, tileCallback);
+
+                        if (tileException != null)
+                            ExceptionDispatchInfo.Capture(tileException).Throw();
+                    }
+
+                    drawTarget?.MarkDirty();
+                }
+
+                using (Profiler.Zone("OnRender"))
+                    OnRender(canvas, deltaTime);
+
                 EntityManager.ExecuteSystems(canvas, deltaTime);
             }
 
@@ -227,16 +540,35 @@ namespace Szark
 
             Core.UseTexture(drawTargetID);
             Core.RenderQuad();
+            Sprites.Flush(ScreenWidth, ScreenHeight);
 
             Keyboard.Update();
             Mouse.Update();
         }
 
+        void RenderTile(ref Rect tile, uint worker)
+        {
+            if (canvas == null || tileException != null) return;
+
+            try
+            {
+                OnRenderTile(canvas, new Tile(tile.x, tile.y, tile.width,
+                    tile.height, (int)worker), tileDeltaTime);
+            }
+            catch (Exception e)
+            {
+                Interlocked.CompareExchange(ref tileException, e, null);
+            }
+        }
+
         void InitDrawTarget()
         {
-            drawTarget = new Texture((uint)ScreenWidth, (uint)ScreenHeight);
+            // Allocated at the largest scale so resizing never reallocates
+            drawTarget = Texture.CreateStreaming(ScaleScreen(ScreenWidth, MaxRenderScale),
+                ScaleScreen(ScreenHeight, MaxRenderScale), FramebufferFormat);
             drawTargetID = drawTarget.GenerateID();
             canvas = drawTarget.GetCanvas();
+            ApplyRenderScale(true);
 
             var monitor = Core.GetPrimaryMonitorRect();
 
@@ -250,15 +582,91 @@ namespace Szark
             }
         }
 
+        // Resizes the canvas to the scale the core picked for this frame
+        void ApplyRenderScale(bool force)
+        {
+            float scale = Core.GetRenderScale();
+            if (drawTarget == null || (!force && scale == RenderScale)) return;
+
+            uint width = ScaleScreen(ScreenWidth, scale);
+            uint height = ScaleScreen(ScreenHeight, scale);
+            if (!drawTarget.Resize(width, height)) return;
+
+            RenderScale = scale;
+            RenderWidth = (int)width;
+            RenderHeight = (int)height;
+            canvas?.SetScale(scale, ScreenWidth, ScreenHeight);
+
+            // The old frame was scaled along, so renderers that build on
+            // the previous frame carry on without a black flash
+            Core.SetTextureFilter(drawTargetID, SmoothScaling && scale != 1);
+        }
+
+        // The cache is only an optimization, so shaders are compiled
+        // every run when its directory can't be created
+        string? CreateShaderCache()
+        {
+            if (ShaderCacheDirectory == null) return null;
+
+            try
+            {
+                Directory.CreateDirectory(ShaderCacheDirectory);
+                return ShaderCacheDirectory;
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                Error($"Failed to create the shader cache {ShaderCacheDirectory}!");
+                return null;
+            }
+        }
+
+        static uint ScaleScreen(int size, float scale) =>
+            (uint)System.Math.Max(1, (int)System.Math.Round(size * scale));
+
         void SetupCallbacks()
         {
             Core.SetErrorCallback(errorCallback);
             Core.SetWindowEventCallback(windowEventCallback);
+        }
+
+        // Drains every event since the last frame in bulk and
+        // applies them to the devices in the order they arrived
+        void PollInput()
+        {
+            inputEventCount = 0;
+
+            while (true)
+            {
+                if (inputEventCount == inputEvents.Length)
+                    Array.Resize(ref inputEvents, inputEvents.Length * 2);
 
-            Core.SetScrollCallback(scrollCallback);
-            Core.SetKeyCallback(keyCallback);
-            Core.SetCursorCallback(cursorCallback);
-            Core.SetMouseCallback(mouseCallback);
+                int capacity = inputEvents.Length - inputEventCount;
+                int count = (int)Core.DrainInputEvents(
+                    ref inputEvents[inputEventCount], (uint)capacity);
+
+                inputEventCount += count;
+                if (count < capacity) break;
+            }
+
+            for (int i = 0; i < inputEventCount; i++)
+            {
+                ref var ev = ref inputEvents[i];
+                switch (ev.Type)
+                {
+                    case InputEventType.Key:
+                        Keyboard.OnKeyboardEvent(ev.Key, ev.action);
+                        break;
+                    case InputEventType.Mouse:
+                        Mouse.OnMouseEvent(ev.Button, ev.action);
+                        break;
+                    case InputEventType.Scroll:
+                        Mouse.OnScrollEvent(ev.X, ev.Y);
+                        break;
+                    case InputEventType.Cursor:
+                        Cursor.OnCursorEvent(ev.X, ev.Y);
+                        break;
+                }
+            }
         }
     }
 }
@@ -0,0 +1,104 @@
+using System;
+using System.Runtime.ExceptionServices;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace Szark
+{
+    /// <summary>
+    /// Work done by one job system worker since the last reset
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct JobStats
+    {
+        public ulong Jobs, Steals;
+        public double BusyTime;
+    }
+
+    /// <summary>
+    /// Runs work in parallel on the core's work-stealing job system.
+    /// Each worker owns a queue and steals from the others when idle.
+    /// </summary>
+    public static class Jobs
+    {
+        /// <summary>
+        /// How many workers run jobs, including the calling thread
+        /// </summary>
+        public static int WorkerCount => (int)Core.GetWorkerCount();
+
+        /// <summary>
+        /// Time spent inside dispatches since the last reset in seconds
+        /// </summary>
+        public static double DispatchTime => Core.GetJobStats(null, 0);
+
+        private static Action<int, int>? current;
+        private static Exception? failure;
+        private static int dispatching;
+        private static readonly JobCallback callback = RunCurrent;
+
+        [ThreadStatic]
+        private static int workerIndex;
+
+        /// <summary>
+        /// Starts the workers, 0 uses one per hardware thread.
+        /// Dispatching starts them with the default count otherwise.
+        /// </summary>
+        public static void Initialize(int workers = 0) =>
+            Core.InitializeJobSystem((uint)workers);
+
+        /// <summary>
+        /// Runs a job for every index below count in parallel and
+        /// returns once all of them are done
+        /// </summary>
+        /// <param name="job">Called with the index and the worker</param>
+        public static void Dispatch(int count, Action<int, int> job)
+        {
+            if (count <= 0) return;
+
+            // Dispatches from inside a job run inline, the workers are busy
+            if (Interlocked.CompareExchange(ref dispatching, 1, 0) != 0)
+            {
+                for (int i = 0; i < count; i++)
+                    job(i, workerIndex);
+                return;
+            }
+
+            current = job;
+            failure = null;
+
+            try { Core.DispatchJobs((uint)count, callback); }
+            finally
+            {
+                current = null;
+                Volatile.Write(ref dispatching, 0);
+            }
+
+            // Exceptions can't cross the core, rethrow the first one here
+            if (failure != null)
+                ExceptionDispatchInfo.Throw(failure);
+        }
+
+        /// <summary>
+        /// Returns the stats of every worker
+        /// </summary>
+        public static JobStats[] GetStats()
+        {
+            var stats = new JobStats[WorkerCount];
+            Core.GetJobStats(stats, (uint)stats.Length);
+            return stats;
+        }
+
+        /// <summary>
+        /// Clears the stats of every worker
+        /// </summary>
+        public static void ResetStats() => Core.ResetJobStats();
+
+        private static void RunCurrent(uint index, uint worker)
+        {
+            workerIndex = (int)worker;
+
+            try { current?.Invoke((int)index, (int)worker); }
+            catch (Exception e) { Interlocked.CompareExchange(ref failure, e, null); }
+        }
+    }
+}
@@ -0,0 +1,20 @@
+using System.Runtime.InteropServices;
+
+namespace Szark
+{
+    /// <summary>
+    /// Timing of the simulation ticks and rendered frames.
+    /// Intervals and jitter are in seconds over the last 240 samples.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct LoopStats
+    {
+        public double TickInterval, TickJitter;
+        public double FrameInterval, FrameJitter;
+        public ulong Ticks, Frames;
+
+        public override string ToString() =>
+            $"Tick: {TickInterval * 1000:F2}ms ±{TickJitter * 1000:F2}ms, " +
+            $"Frame: {FrameInterval * 1000:F2}ms ±{FrameJitter * 1000:F2}ms";
+    }
+}
@@ -0,0 +1,114 @@
+using System;
+using System.Collections.Concurrent;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace Szark
+{
+    /// <summary>
+    /// Timing of one profiler zone in seconds over its last 240 samples
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct ProfileStats
+    {
+        public ulong Count;
+        public double Min, Average, P99, Last;
+
+        public override string ToString() =>
+            $"min {Min * 1000:F3}ms, avg {Average * 1000:F3}ms, " +
+            $"p99 {P99 * 1000:F3}ms";
+    }
+
+    /// <summary>
+    /// An open profiler zone, closed when disposed
+    /// </summary>
+    public readonly struct ProfileZone : IDisposable
+    {
+        private readonly bool open;
+        internal ProfileZone(bool open) => this.open = open;
+
+        public void Dispose()
+        {
+            if (open) Core.EndProfileZone();
+        }
+    }
+
+    /// <summary>
+    /// Records how long parts of each frame take, on the CPU for every
+    /// zone and on the GPU for the core's uploads and draws. The core
+    /// records Frame, Poll, Render, Upload, Draw, Swap and Capture
+    /// by itself.
+    /// </summary>
+    public static class Profiler
+    {
+        private static readonly ConcurrentDictionary<string, uint> zones =
+            new ConcurrentDictionary<string, uint>();
+
+        private static bool enabled;
+
+        /// <summary>
+        /// Whether zones are recorded, off by default. Zones cost
+        /// almost nothing while the profiler is off.
+        /// </summary>
+        public static bool Enabled
+        {
+            get => enabled; set
+            {
+                Core.SetProfilerEnabled(value);
+                enabled = value;
+            }
+        }
+
+        /// <summary>
+        /// Opens a zone on the calling thread until the result is
+        /// disposed, use it with a using statement
+        /// </summary>
+        public static ProfileZone Zone(string name)
+        {
+            if (!enabled) return default;
+
+            Core.BeginProfileZone(GetZoneID(name));
+            return new ProfileZone(true);
+        }
+
+        /// <summary>
+        /// The rolling statistics of a zone
+        /// </summary>
+        /// <param name="gpu">GPU time instead of CPU time</param>
+        public static ProfileStats GetStats(string name, bool gpu = false) =>
+            Core.GetProfileStats(GetZoneID(name), gpu);
+
+        /// <summary>
+        /// Saves the recent samples as a Chrome trace, which can be
+        /// opened in chrome://tracing or Perfetto
+        /// </summary>
+        public static bool SaveTrace(string path) =>
+            Core.SaveProfileTrace(path);
+
+        /// <summary>
+        /// The statistics of every zone that has samples
+        /// </summary>
+        public static string Report()
+        {
+            var builder = new StringBuilder();
+            uint count = Core.GetProfileZoneCount();
+
+            for (uint zone = 0; zone < count; zone++)
+            {
+                var name = Marshal.PtrToStringAnsi(Core.GetProfileZoneName(zone));
+                var cpu = Core.GetProfileStats(zone, false);
+                var gpu = Core.GetProfileStats(zone, true);
+
+                if (cpu.Count > 0)
+                    builder.AppendLine($"{name}: {cpu}");
+                if (gpu.Count > 0)
+                    builder.AppendLine($"{name} (GPU): {gpu}");
+            }
+
+            return builder.ToString();
+        }
+
+        private static uint GetZoneID(string name) =>
+            zones.GetOrAdd(name, Core.RegisterProfileZone);
+    }
+}
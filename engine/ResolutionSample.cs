@@ -0,0 +1,20 @@
+using System.Runtime.InteropServices;
+
+namespace Szark
+{
+    /// <summary>
+    /// One frame of dynamic resolution: the seconds the game took to
+    /// render it, the smoothed render time the scale is picked from,
+    /// and the render scale the frame was drawn at
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct ResolutionSample
+    {
+        public double RenderTime, AverageRenderTime;
+        public float Scale;
+
+        public override string ToString() =>
+            $"Render: {RenderTime * 1000:F2}ms ({AverageRenderTime * 1000:F2}ms), " +
+            $"Scale: {Scale:F3}";
+    }
+}
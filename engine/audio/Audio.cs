@@ -1,9 +1,19 @@
-using System.IO;
 using System.Runtime.InteropServices;
 using System;
 
 namespace Szark.Audio
 {
+    /// <summary>
+    /// Where the samples of a WAV file are and how to play them
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct WaveInfo
+    {
+        public int Format;
+        public uint Frequency, BlockAlign;
+        public ulong Offset, Size;
+    }
+
     [StructLayout(LayoutKind.Sequential)]
     public struct AudioClip : IDisposable
     {
@@ -29,62 +39,71 @@ namespace Szark.Audio
     /// </summary>
     public static class Audio
     {
-        public static AudioClip? ReadFile(string filePath)
+        /// <summary>
+        /// Stats of the voice pool and the software mixer
+        /// </summary>
+        public static MixerStats MixerStats => Core.GetMixerStats();
+
+        /// <summary>
+        /// Reads a PCM WAV file into a clip
+        /// </summary>
+        public static unsafe AudioClip? ReadFile(string filePath)
+        {
+            var wave = MapWave(filePath, out ulong size);
+            if (wave == null) return null;
+
+            var clip = ReadFile(wave, size, filePath);
+            Core.UnmapAssetFile(wave);
+            return clip;
+        }
+
+        /// <summary>
+        /// Reads a WAV file into a sound that can play on many voices at
+        /// once through the mixer. Suits short, frequent sound effects.
+        /// </summary>
+        public static unsafe Sound? ReadSound(string filePath)
+        {
+            var wave = MapWave(filePath, out ulong size);
+            if (wave == null) return null;
+
+            var sound = ReadSound(wave, size, filePath);
+            Core.UnmapAssetFile(wave);
+            return sound;
+        }
+
+        internal static unsafe AudioClip? ReadFile(byte* wave, ulong size, string name)
+        {
+            if (!ReadWave(wave, size, name, out var info)) return null;
+            return Core.CreateAudioClip(info.Format, wave + info.Offset,
+                (uint)info.Size, info.Frequency);
+        }
+
+        internal static unsafe Sound? ReadSound(byte* wave, ulong size, string name)
         {
-            try
-            {
-                using var stream = File.Open(filePath, FileMode.Open);
-                using var reader = new BinaryReader(stream);
-
-                string signature = new string(reader.ReadChars(4));
-                if (signature != "RIFF")
-                    throw new NotSupportedException("Invalid signature");
-
-                int riff_chunck_size = reader.ReadInt32();
-                string format = new string(reader.ReadChars(4));
-                if (format != "WAVE")
-                    throw new NotSupportedException("Invalid format");
-
-                string format_signature = new string(reader.ReadChars(4));
-                if (format_signature != "fmt ")
-                    throw new NotSupportedException("Incorrect format signature");
-
-                int format_chunk_size = reader.ReadInt32();
-                int audio_format = reader.ReadInt16();
-                var channels = reader.ReadInt16();
-                var sampleRate = reader.ReadInt32();
-                int byte_rate = reader.ReadInt32();
-                int block_align = reader.ReadInt16();
-                var bitsPerSample = reader.ReadInt16();
-
-                string data_signature = new string(reader.ReadChars(4));
-                if (data_signature != "data")
-                    throw new NotSupportedException("Incorrect data");
-                int data_chunk_size = reader.ReadInt32();
-
-                var audioData = reader.ReadBytes((int)reader.BaseStream.Length);
-
-                int soundFormat = channels switch
-                {
-                    1 => bitsPerSample == 8 ? 0x1100 : 0x1101,
-                    2 => bitsPerSample == 8 ? 0x1102 : 0x1103,
-                    _ => throw new NotSupportedException(),
-                };
-
-                return Core.CreateAudioClip(soundFormat, audioData,
-                    (uint)audioData.Length, (uint)sampleRate);
-            }
-            catch (FileNotFoundException)
-            {
-                Game.Get<Game>().Error($"WAV file {filePath} could not be found!");
-            }
-            catch (Exception e)
-            {
-                Game.Get<Game>().Error($"{filePath} is an invalid WAV file!" +
-                    $"\n{e}");
-            }
-
-            return null;
+            if (!ReadWave(wave, size, name, out var info)) return null;
+
+            uint id = Core.CreateSound(info.Format, wave + info.Offset,
+                (uint)info.Size, info.Frequency);
+            return id == 0 ? null : new Sound(id);
+        }
+
+        private static unsafe byte* MapWave(string filePath, out ulong size)
+        {
+            var wave = (byte*)Core.MapAssetFile(filePath, out size);
+            if (wave == null)
+                Game.Get<Game>()?.Error($"WAV file {filePath} could not be found!");
+            return wave;
+        }
+
+        // The samples are found by the core, which walks every chunk
+        // instead of expecting "data" right after "fmt "
+        private static unsafe bool ReadWave(byte* wave, ulong size, string name,
+            out WaveInfo info)
+        {
+            if (Core.ReadWaveInfo(wave, size, out info)) return true;
+
+            Game.Get<Game>()?.Error($"{name} is an invalid WAV file!");
+            return false;
         }
     }
 }
\ No newline at end of file
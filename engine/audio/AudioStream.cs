@@ -0,0 +1,54 @@
+using System;
+
+namespace Szark.Audio
+{
+    /// <summary>
+    /// Audio streamed from a memory mapped WAV file in small chunks.
+    /// Opening is near-instant and memory use stays the same however
+    /// long the file is, which suits music and ambience.
+    /// </summary>
+    public sealed class AudioStream : IDisposable
+    {
+        /// <summary>
+        /// Whether the stream still has audio left to play
+        /// </summary>
+        public bool IsPlaying => Core.IsAudioStreamPlaying(id);
+
+        /// <summary>
+        /// The length of the stream in seconds
+        /// </summary>
+        public double Length => Core.GetAudioStreamLength(id);
+
+        private uint id;
+
+        private AudioStream(uint id) => this.id = id;
+
+        /// <summary>
+        /// Opens a PCM WAV file for streaming.
+        /// Returns null if the file can't be streamed.
+        /// </summary>
+        public static AudioStream? Open(string filePath)
+        {
+            uint id = Core.OpenAudioStream(filePath);
+            return id == 0 ? null : new AudioStream(id);
+        }
+
+        /// <summary>
+        /// Plays the stream from the start
+        /// </summary>
+        public void Play(float volume = 1, bool loop = false) =>
+            Core.PlayAudioStream(id, volume, loop);
+
+        /// <summary>
+        /// Stops the stream from playing
+        /// </summary>
+        public void Stop() => Core.StopAudioStream(id);
+
+        public void Dispose()
+        {
+            if (id == 0) return;
+            Core.CloseAudioStream(id);
+            id = 0;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+using System;
+using System.Runtime.InteropServices;
+
+namespace Szark.Audio
+{
+    /// <summary>
+    /// Counters of the voice pool and the software mixer.
+    /// Mix times are in seconds per block of 512 frames.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct MixerStats
+    {
+        public uint Voices, ActiveVoices, PeakVoices;
+        public ulong Steals, Dropped, Underruns, Blocks;
+        public double MixTime, AverageMixTime;
+    }
+
+    /// <summary>
+    /// A handle to one playing instance of a sound. It goes stale once
+    /// the sound finishes or its voice is stolen, and is ignored after.
+    /// </summary>
+    public readonly struct Voice
+    {
+        internal readonly uint handle;
+
+        internal Voice(uint handle) => this.handle = handle;
+
+        /// <summary>
+        /// Whether this voice is still playing
+        /// </summary>
+        public bool IsPlaying => Core.IsVoicePlaying(handle);
+
+        /// <summary>
+        /// Changes the volume and pan (-1 left to 1 right)
+        /// </summary>
+        public void SetGain(float volume, float pan = 0) =>
+            Core.SetVoiceGain(handle, volume, pan);
+
+        /// <summary>
+        /// Stops this voice
+        /// </summary>
+        public void Stop() => Core.StopVoice(handle);
+    }
+
+    /// <summary>
+    /// Samples that play on the shared voice pool. Playing a sound again
+    /// adds another voice instead of restarting the previous one.
+    /// </summary>
+    public sealed class Sound : IDisposable
+    {
+        private uint id;
+
+        internal Sound(uint id) => this.id = id;
+
+        /// <summary>
+        /// Plays the sound on a free voice. When every voice is busy it
+        /// replaces a voice of the same or lower priority.
+        /// </summary>
+        /// <param name="pan">-1 is left, 1 is right</param>
+        /// <param name="priority">Higher priority voices are stolen last</param>
+        public Voice Play(float volume = 1, float pan = 0, int priority = 0) =>
+            new Voice(Core.StartVoice(id, volume, pan, priority));
+
+        public void Dispose()
+        {
+            if (id == 0) return;
+            Core.DestroySound(id);
+            id = 0;
+        }
+    }
+}
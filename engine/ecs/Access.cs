@@ -0,0 +1,27 @@
+using System;
+
+namespace Szark.ECS
+{
+    /// <summary>
+    /// Declares component types or resources (like Canvas) a system
+    /// only reads. Systems that don't conflict run at the same time,
+    /// a system without any declarations runs on its own.
+    /// </summary>
+    [AttributeUsage(AttributeTargets.Class, AllowMultiple = true)]
+    public sealed class ReadsAttribute : Attribute
+    {
+        public Type[] Types { get; }
+        public ReadsAttribute(params Type[] types) => Types = types;
+    }
+
+    /// <summary>
+    /// Declares component types or resources (like Canvas) a system
+    /// changes. No other system touching them runs at the same time.
+    /// </summary>
+    [AttributeUsage(AttributeTargets.Class, AllowMultiple = true)]
+    public sealed class WritesAttribute : Attribute
+    {
+        public Type[] Types { get; }
+        public WritesAttribute(params Type[] types) => Types = types;
+    }
+}
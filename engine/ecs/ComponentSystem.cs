@@ -14,25 +14,30 @@ namespace Szark.ECS
         protected T Game => Szark.Game.Get<T>();
         protected EntityManager EntityManager => Game.EntityManager;
 
+        /// <summary>
+        /// Structural changes applied after this system's wave
+        /// </summary>
+        protected EntityCommands Commands => EntityManager.Commands;
+
         /// <summary>
         /// Returns a component on an entity
         /// </summary>
         protected C? GetComponent<C>(Entity entity)
-            where C : struct, IComponent =>
+            where C : unmanaged, IComponent =>
             EntityManager.GetComponent<C>(entity);
 
         /// <summary>
         /// Adds a component to an entity
         /// </summary>
         protected void AddComponent<C>(Entity entity, C comp)
-            where C : struct, IComponent =>
+            where C : unmanaged, IComponent =>
             EntityManager.AddComponent<C>(entity, comp);
 
         /// <summary>
         /// Removes a component from an entity
         /// </summary>
         protected void RemoveComponent<C>(Entity entity)
-            where C : struct, IComponent =>
+            where C : unmanaged, IComponent =>
             EntityManager.RemoveComponent<C>(entity);
 
         public abstract void Execute(Canvas canvas, float deltaTime);
@@ -0,0 +1,32 @@
+using System;
+using System.Runtime.CompilerServices;
+
+namespace Szark.ECS
+{
+    /// <summary>
+    /// The core id of a component type, registered on first use.
+    /// Tags are registered with no size so they take no space.
+    /// </summary>
+    internal static class ComponentType<T> where T : unmanaged, IComponent
+    {
+        public static readonly uint ID = Register();
+        public static readonly ulong Mask = 1ul << (int)ID;
+        public static readonly bool IsTag = typeof(ITag).IsAssignableFrom(typeof(T));
+
+        private static uint Register()
+        {
+            int size = typeof(ITag).IsAssignableFrom(typeof(T)) ?
+                0 : Unsafe.SizeOf<T>();
+
+            // Largest power of two that divides the size, up to 16
+            int alignment = size == 0 ? 1 : System.Math.Min(size & -size, 16);
+
+            int id = Core.RegisterComponent((uint)size, (uint)alignment);
+            if (id < 0)
+                throw new InvalidOperationException(
+                    $"Component {typeof(T).Name} could not be registered!");
+
+            return (uint)id;
+        }
+    }
+}
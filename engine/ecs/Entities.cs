@@ -1,8 +1,14 @@
 ﻿using System;
-using System.Collections.Generic;
+using System.Buffers;
 
 namespace Szark.ECS
 {
+    /// <summary>
+    /// Finds every chunk of entities with the requested components.
+    /// Entities must not be created, destroyed, or have components added
+    /// or removed while a query runs, that moves them between chunks.
+    /// Tags have no data, match them with WithTag rather than ForEach.
+    /// </summary>
     public class QueryBuilder
     {
         // Delegates for ForEach Methods
@@ -10,128 +16,218 @@ namespace Szark.ECS
         public delegate void CompAction<T, J, K>(ref T t, ref J j, ref K k);
         public delegate void CompAction<T, J>(ref T t, ref J j);
 
-        internal List<Type> Requirements;
-        internal QueryBuilder() { Requirements = new List<Type>(); }
+        // Delegates for ForEachChunk Methods
+        public delegate void ChunkAction<T>(ReadOnlySpan<Entity> entities,
+            Span<T> t);
+        public delegate void ChunkAction<T, J>(ReadOnlySpan<Entity> entities,
+            Span<T> t, Span<J> j);
+        public delegate void ChunkAction<T, J, K>(ReadOnlySpan<Entity> entities,
+            Span<T> t, Span<J> j, Span<K> k);
 
-        public QueryBuilder WithTag<T>() where T : struct, ITag
+        private ulong all, none;
+
+        internal QueryBuilder() { }
+
+        /// <summary>
+        /// Only matches entities with the tag
+        /// </summary>
+        public QueryBuilder WithTag<T>() where T : unmanaged, ITag
         {
-            Requirements.Add(typeof(T));
+            all |= ComponentType<T>.Mask;
             return this;
         }
 
-        private BytePool? GetPool<T>() where T : struct, IComponent =>
-            GetPool(typeof(T));
-
-        private BytePool? GetPool(Type type)
+        /// <summary>
+        /// Only matches entities with the component
+        /// </summary>
+        public QueryBuilder With<T>() where T : unmanaged, IComponent
         {
-            var components = Game.Get<Game>().EntityManager.components;
-            components.TryGetValue(type, out BytePool? pool);
-            return pool;
+            all |= ComponentType<T>.Mask;
+            return this;
         }
 
-        private bool DoesMeetRequirementsAt(int index)
+        /// <summary>
+        /// Skips entities with the component or tag
+        /// </summary>
+        public QueryBuilder Without<T>() where T : unmanaged, IComponent
         {
-            foreach (var req in Requirements)
-            {
-                if (!(GetPool(req) is BytePool pool && pool.IsValidAt(index)))
-                    return false;
-            }
-
-            return true;
+            none |= ComponentType<T>.Mask;
+            return this;
         }
 
         /// <summary>
         /// Loops through entities with the matching component
         /// </summary>
         public void ForEach<T>(CompAction<T> action)
-            where T : struct, IComponent
+            where T : unmanaged, IComponent =>
+            ForEachChunk((ReadOnlySpan<Entity> entities, Span<T> t) =>
+            {
+                for (int i = 0; i < t.Length; i++)
+                    action(ref t[i]);
+            });
+
+        /// <summary>
+        /// Loops through entities with matching two components
+        /// </summary>
+        public void ForEach<T, J>(CompAction<T, J> action)
+            where T : unmanaged, IComponent where J : unmanaged, IComponent =>
+            ForEachChunk((ReadOnlySpan<Entity> entities, Span<T> t, Span<J> j) =>
+            {
+                for (int i = 0; i < t.Length; i++)
+                    action(ref t[i], ref j[i]);
+            });
+
+        /// <summary>
+        /// Loops through entities with matching three components
+        /// </summary>
+        public void ForEach<T, J, K>(CompAction<T, J, K> action)
+            where T : unmanaged, IComponent
+            where J : unmanaged, IComponent
+            where K : unmanaged, IComponent =>
+            ForEachChunk((ReadOnlySpan<Entity> entities, Span<T> t, Span<J> j,
+                Span<K> k) =>
+            {
+                for (int i = 0; i < t.Length; i++)
+                    action(ref t[i], ref j[i], ref k[i]);
+            });
+
+        /// <summary>
+        /// Calls the action once per chunk with its entities and the
+        /// component column, which are contiguous core memory
+        /// </summary>
+        public unsafe void ForEachChunk<T>(ChunkAction<T> action)
+            where T : unmanaged, IComponent
         {
-            var manager = Game.Get<Game>().EntityManager;
-            var components = manager.components;
+            CheckColumn<T>();
+            uint* columns = stackalloc uint[] { ComponentType<T>.ID };
+            all |= ComponentType<T>.Mask;
 
-            if (GetPool<T>() is BytePool pool)
+            int count = Collect(columns, 1, out var chunks, out var pointers);
+            for (int c = 0; c < count; c++)
             {
-                for (int i = 0; i < manager.entities.Count; i++)
-                {
-                    if (DoesMeetRequirementsAt(i) && pool.IsValidAt(i))
-                    {
-                        var spanT = pool.AsSpan<T>();
-                        action(ref spanT[i]);
-                    }
-                }
+                int length = (int)chunks[c].count;
+                action(Entities(chunks[c]),
+                    new Span<T>((void*)pointers[c], length));
             }
 
-            Requirements.Clear();
+            Release(chunks, pointers);
         }
 
         /// <summary>
-        /// Loops through entities with matching two components
+        /// Calls the action once per chunk with its entities and the
+        /// two component columns, which are contiguous core memory
         /// </summary>
-        public void ForEach<T, J>(CompAction<T, J> action)
-            where T : struct, IComponent where J : struct, IComponent
+        public unsafe void ForEachChunk<T, J>(ChunkAction<T, J> action)
+            where T : unmanaged, IComponent where J : unmanaged, IComponent
         {
-            var manager = Game.Get<Game>().EntityManager;
-            var components = manager.components;
+            CheckColumn<T>();
+            CheckColumn<J>();
+            uint* columns = stackalloc uint[] {
+                ComponentType<T>.ID, ComponentType<J>.ID };
+            all |= ComponentType<T>.Mask | ComponentType<J>.Mask;
+
+            int count = Collect(columns, 2, out var chunks, out var pointers);
+            for (int c = 0; c < count; c++)
+            {
+                int length = (int)chunks[c].count;
+                action(Entities(chunks[c]),
+                    new Span<T>((void*)pointers[c * 2], length),
+                    new Span<J>((void*)pointers[c * 2 + 1], length));
+            }
+
+            Release(chunks, pointers);
+        }
 
-            if (GetPool<T>() is BytePool poolT)
+        /// <summary>
+        /// Calls the action once per chunk with its entities and the
+        /// three component columns, which are contiguous core memory
+        /// </summary>
+        public unsafe void ForEachChunk<T, J, K>(ChunkAction<T, J, K> action)
+            where T : unmanaged, IComponent
+            where J : unmanaged, IComponent
+            where K : unmanaged, IComponent
+        {
+            CheckColumn<T>();
+            CheckColumn<J>();
+            CheckColumn<K>();
+            uint* columns = stackalloc uint[] {
+                ComponentType<T>.ID, ComponentType<J>.ID, ComponentType<K>.ID };
+            all |= ComponentType<T>.Mask | ComponentType<J>.Mask |
+                ComponentType<K>.Mask;
+
+            int count = Collect(columns, 3, out var chunks, out var pointers);
+            for (int c = 0; c < count; c++)
             {
-                if (GetPool<J>() is BytePool poolJ)
-                {
-                    for (int i = 0; i < manager.entities.Count; i++)
-                    {
-                        if (DoesMeetRequirementsAt(i) && poolT.IsValidAt(i) && poolJ.IsValidAt(i))
-                        {
-                            var spanT = poolT.AsSpan<T>();
-                            var spanJ = poolJ.AsSpan<J>();
-                            action(ref spanT[i], ref spanJ[i]);
-                        }
-                    }
-                }
+                int length = (int)chunks[c].count;
+                action(Entities(chunks[c]),
+                    new Span<T>((void*)pointers[c * 3], length),
+                    new Span<J>((void*)pointers[c * 3 + 1], length),
+                    new Span<K>((void*)pointers[c * 3 + 2], length));
             }
 
-            Requirements.Clear();
+            Release(chunks, pointers);
         }
 
         /// <summary>
-        /// Loops through entities with matching three components
+        /// Tags have no data and so no column, they can only filter
         /// </summary>
-        public void ForEach<T, J, K>(CompAction<T, J, K> action)
-            where T : struct, IComponent
-            where J : struct, IComponent
-            where K : struct, IComponent
+        private void CheckColumn<T>() where T : unmanaged, IComponent
         {
-            var manager = Game.Get<Game>().EntityManager;
-            var components = manager.components;
+            if (!ComponentType<T>.IsTag) return;
 
-            if (GetPool<T>() is BytePool poolT)
+            all = none = 0;
+            throw new ArgumentException(
+                $"{typeof(T).Name} is a tag, match it with WithTag instead!");
+        }
+
+        private static unsafe ReadOnlySpan<Entity> Entities(QueryChunk chunk) =>
+            new ReadOnlySpan<Entity>((void*)chunk.entities, (int)chunk.count);
+
+        /// <summary>
+        /// Gathers the matching chunks and resets the builder, so queries
+        /// can be nested inside the actions of another query
+        /// </summary>
+        private unsafe int Collect(uint* columns, int columnCount,
+            out QueryChunk[] chunks, out IntPtr[] pointers)
+        {
+            var (all, none) = (this.all, this.none);
+            this.all = this.none = 0;
+
+            int capacity = 16;
+
+            while (true)
             {
-                if (GetPool<J>() is BytePool poolJ)
+                chunks = ArrayPool<QueryChunk>.Shared.Rent(capacity);
+                pointers = ArrayPool<IntPtr>.Shared.Rent(capacity * columnCount);
+
+                uint found;
+                fixed (QueryChunk* chunksPtr = chunks)
+                fixed (IntPtr* pointersPtr = pointers)
                 {
-                    if (GetPool<K>() is BytePool poolK)
-                    {
-                        for (int i = 0; i < manager.entities.Count; i++)
-                        {
-                            if (DoesMeetRequirementsAt(i) && poolT.IsValidAt(i) &&
-                                poolJ.IsValidAt(i) && poolK.IsValidAt(i))
-                            {
-                                var spanT = poolT.AsSpan<T>();
-                                var spanJ = poolJ.AsSpan<J>();
-                                var spanK = poolK.AsSpan<K>();
-
-                                action(ref spanT[i], ref spanJ[i], ref spanK[i]);
-                            }
-                        }
-                    }
+                    found = Core.QueryChunks(all, none, columns, (uint)columnCount,
+                        chunksPtr, pointersPtr, (uint)capacity);
                 }
+
+                if (found <= capacity) return (int)found;
+
+                Release(chunks, pointers);
+                capacity = (int)found;
             }
+        }
 
-            Requirements.Clear();
+        private static void Release(QueryChunk[] chunks, IntPtr[] pointers)
+        {
+            ArrayPool<QueryChunk>.Shared.Return(chunks);
+            ArrayPool<IntPtr>.Shared.Return(pointers);
         }
     }
 
     public static class Entities
     {
-        private static QueryBuilder builder = new QueryBuilder();
-        public static QueryBuilder Query() => builder;
+        // Systems query from many threads at once
+        [ThreadStatic]
+        private static QueryBuilder? builder;
+
+        public static QueryBuilder Query() => builder ??= new QueryBuilder();
     }
 }
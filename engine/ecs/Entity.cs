@@ -3,29 +3,43 @@
 namespace Szark.ECS
 {
     /// <summary>
-    /// The building piece / object of ECS
+    /// The building piece / object of ECS.
+    /// A handle that stops matching once the entity is destroyed.
     /// </summary>
-    public struct Entity : IComparable<Entity>
+    public readonly struct Entity : IComparable<Entity>, IEquatable<Entity>
     {
         // Represents an Non-Existent Entity
-        public static readonly Entity None = new Entity(-1);
+        public static readonly Entity None = new Entity(0);
 
-        public readonly int ID;
-        public Entity(int id) => ID = id;
+        internal readonly ulong Handle;
+        internal Entity(ulong handle) => Handle = handle;
+
+        /// <summary>
+        /// Index of the entity, reused after it's destroyed
+        /// </summary>
+        public int ID => (int)(uint)Handle;
+
+        /// <summary>
+        /// How many times the ID has been reused
+        /// </summary>
+        public uint Generation => (uint)(Handle >> 32);
 
         public int CompareTo(Entity other) =>
-            ID - other.ID;
+            Handle.CompareTo(other.Handle);
+
+        public bool Equals(Entity other) =>
+            Handle == other.Handle;
 
         public override bool Equals(object? obj) =>
-            obj is Entity entity && base.Equals(entity);
+            obj is Entity entity && Equals(entity);
 
         public override int GetHashCode() =>
-            HashCode.Combine(ID);
+            Handle.GetHashCode();
 
         public static bool operator ==(Entity left, Entity right) =>
-            left.ID == right.ID;
+            left.Handle == right.Handle;
 
         public static bool operator !=(Entity left, Entity right) =>
-            left.ID != right.ID;
+            left.Handle != right.Handle;
     }
 }
@@ -0,0 +1,56 @@
+using System;
+using System.Collections.Generic;
+
+namespace Szark.ECS
+{
+    /// <summary>
+    /// Records structural changes made while systems run in parallel.
+    /// They are applied in system order at the next sync point.
+    /// </summary>
+    public sealed class EntityCommands
+    {
+        private readonly List<Action<EntityManager>> commands =
+            new List<Action<EntityManager>>();
+
+        /// <summary>
+        /// Creates an entity, setup is called with it once it exists
+        /// </summary>
+        public void CreateEntity(Action<EntityManager, Entity>? setup = null) =>
+            commands.Add(manager =>
+            {
+                var entity = manager.CreateEntity();
+                setup?.Invoke(manager, entity);
+            });
+
+        /// <summary>
+        /// Destroys an entity and all of its components
+        /// </summary>
+        public void DestroyEntity(Entity entity) =>
+            commands.Add(manager => manager.DestroyEntity(entity));
+
+        /// <summary>
+        /// Adds or replaces a component of an entity
+        /// </summary>
+        public void AddComponent<T>(Entity entity, T component)
+            where T : unmanaged, IComponent =>
+            commands.Add(manager =>
+            {
+                if (manager.Exists(entity))
+                    manager.AddComponent(entity, component);
+            });
+
+        /// <summary>
+        /// Removes a component from an entity
+        /// </summary>
+        public void RemoveComponent<T>(Entity entity)
+            where T : unmanaged, IComponent =>
+            commands.Add(manager => manager.RemoveComponent<T>(entity));
+
+        internal void Playback(EntityManager manager)
+        {
+            foreach (var command in commands)
+                command(manager);
+            commands.Clear();
+        }
+    }
+}
@@ -1,27 +1,51 @@
 ﻿using System.Collections.Generic;
-using System.Runtime.InteropServices;
 using System.Reflection;
 using System;
 using Szark.Graphics;
 
 namespace Szark.ECS
 {
+    /// <summary>
+    /// Creates entities and their components. Components are stored in
+    /// the core, in 16KB chunks of entities with the same components.
+    /// </summary>
     public class EntityManager
     {
         /// <summary>
         /// Returns the amount of entities
         /// </summary>
-        public int Count => entities.Count;
+        public int Count => (int)Core.GetEntityCount();
+
+        /// <summary>
+        /// Structural changes to apply at the next sync point. Inside a
+        /// system these are applied right after the system's wave.
+        /// </summary>
+        public EntityCommands Commands =>
+            SystemScheduler.CurrentCommands ?? pendingCommands;
+
+        /// <summary>
+        /// The waves and system timings of the last ExecuteSystems
+        /// </summary>
+        public ScheduleReport? LastSchedule { get; private set; }
+
+        /// <summary>
+        /// Writes the schedule report to the console every frame
+        /// </summary>
+        public bool LogSchedule { get; set; }
+
+        /// <summary>
+        /// Called with the schedule report after every ExecuteSystems
+        /// </summary>
+        public event Action<ScheduleReport>? ScheduleExecuted;
 
         internal List<ISystem> systems;
-        internal Dictionary<Type, BytePool> components;
-        internal List<Entity> entities;
+
+        private SystemScheduler? scheduler;
+        private readonly EntityCommands pendingCommands = new EntityCommands();
 
         internal EntityManager(Assembly assembly)
         {
-            entities = new List<Entity>();
             systems = new List<ISystem>();
-            components = new Dictionary<Type, BytePool>();
 
             // Find all types in the current assembly
             var types = assembly?.GetTypes();
@@ -40,94 +64,110 @@ namespace Szark.ECS
         }
 
         /// <summary>
-        /// Executes all systems with the execution type
+        /// Executes all systems, running systems whose declared reads
+        /// and writes don't conflict at the same time
         /// </summary>
-        public void ExecuteSystems(Canvas canvas, float deltaTime) =>
-            systems.ForEach(s => s.Execute(canvas, deltaTime));
+        public void ExecuteSystems(Canvas canvas, float deltaTime)
+        {
+            scheduler ??= new SystemScheduler(systems);
+            pendingCommands.Playback(this);
+
+            LastSchedule = scheduler.Execute(this, canvas, deltaTime);
+            ScheduleExecuted?.Invoke(LastSchedule);
+
+            if (LogSchedule)
+                Console.Write(LastSchedule);
+        }
 
         /// <summary>
-        /// Creates an entity or fills in already existing spaces.
-        /// Also does the same for each component given.
+        /// Creates an entity without any components.
+        /// IDs of destroyed entities are reused.
         /// </summary>
         public Entity CreateEntity()
         {
-            // Check for empty space
-            for (int i = 0; i < entities.Count; i++)
-            {
-                if (entities[i] == Entity.None)
-                {
-                    entities[i] = new Entity(i);
-                    return entities[i];
-                }
-            }
-
-            var result = new Entity(entities.Count);
-            entities.Add(result);
-
-            // Add onto each component pool
-            foreach (var pair in components)
-                pair.Value.Push();
-
-            return result;
+            ThrowIfParallel();
+            return new Entity(Core.CreateEntity());
         }
 
         /// <summary>
-        /// Adds a component to an entity
+        /// Whether the entity exists and hasn't been destroyed
+        /// </summary>
+        public bool Exists(Entity entity) =>
+            Core.IsEntityAlive(entity.Handle);
+
+        /// <summary>
+        /// Adds a component to an entity, replacing it if it
+        /// already has one of the same type
         /// </summary>
-        public void AddComponent<T>(Entity entity, T component)
-            where T : struct, IComponent
+        public unsafe void AddComponent<T>(Entity entity, T component)
+            where T : unmanaged, IComponent
         {
-            if (!components.ContainsKey(typeof(T)))
-                components.Add(typeof(T), new BytePool(Marshal.SizeOf<T>()));
-            components[typeof(T)].Assign(component, entity.ID);
+            ThrowIfParallel();
+            if (!Core.AddComponent(entity.Handle, ComponentType<T>.ID,
+                ComponentType<T>.IsTag ? null : &component))
+                throw new ArgumentException("Entity does not exist!");
         }
 
         /// <summary>
         /// Adds a tag to the entity.
         /// This is like add component but more restricted to ITag's
         /// </summary>
-        public void AddTag<T>(Entity entity, T tag) where T : struct, ITag =>
+        public void AddTag<T>(Entity entity, T tag) where T : unmanaged, ITag =>
             AddComponent(entity, tag);
 
+        /// <summary>
+        /// Whether an entity has a component
+        /// </summary>
+        public bool HasComponent<T>(Entity entity) where T : unmanaged, IComponent =>
+            Core.HasComponent(entity.Handle, ComponentType<T>.ID);
+
         /// <summary>
         /// Returns a component from an entity
         /// </summary>
-        public T? GetComponent<T>(Entity entity) where T : struct, IComponent
+        public unsafe T? GetComponent<T>(Entity entity) where T : unmanaged, IComponent
         {
-            if (components.ContainsKey(typeof(T)))
-            {
-                var poolResult = components[typeof(T)].Get<T>(entity.ID);
-                if (poolResult.IsValid) return poolResult.Value;
-            }
-
+            var component = Core.GetComponent(entity.Handle, ComponentType<T>.ID);
+            if (component != null) return *(T*)component;
             return null;
         }
 
+        /// <summary>
+        /// Overwrites a component the entity already has
+        /// </summary>
+        public unsafe bool SetComponent<T>(Entity entity, in T value)
+            where T : unmanaged, IComponent
+        {
+            var component = Core.GetComponent(entity.Handle, ComponentType<T>.ID);
+            if (component == null) return false;
+
+            *(T*)component = value;
+            return true;
+        }
+
         /// <summary>
         /// Removes a component to an entity
         /// </summary>
         public void RemoveComponent<T>(Entity entity)
-            where T : struct, IComponent
+            where T : unmanaged, IComponent
         {
-            if (components.ContainsKey(typeof(T)))
-                components[typeof(T)].Invalidate(entity.ID);
+            ThrowIfParallel();
+            Core.RemoveComponent(entity.Handle, ComponentType<T>.ID);
         }
 
         /// <summary>
-        /// Removes an entity from the entities list.
-        /// And clears associated components to null.
+        /// Removes an entity and all of its components
         /// </summary>
         public void DestroyEntity(Entity entity)
         {
-            for (int i = 0; i < entities.Count; i++)
-            {
-                if (entities[i].CompareTo(entity) == 0)
-                {
-                    entities[i] = Entity.None;
-                    foreach (var pair in components)
-                        pair.Value.Invalidate(i);
-                }
-            }
+            ThrowIfParallel();
+            Core.DestroyEntity(entity.Handle);
+        }
+
+        private void ThrowIfParallel()
+        {
+            if (scheduler?.InParallelWave == true)
+                throw new InvalidOperationException(
+                    "Use EntityManager.Commands for structural changes in parallel systems!");
         }
     }
 }
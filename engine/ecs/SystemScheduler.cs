@@ -0,0 +1,208 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Reflection;
+using System.Text;
+using Szark.Graphics;
+
+namespace Szark.ECS
+{
+    /// <summary>
+    /// How long one system took in the last frame
+    /// </summary>
+    public readonly struct SystemTiming
+    {
+        public readonly string Name;
+        public readonly int Wave;
+        public readonly double Milliseconds;
+
+        public SystemTiming(string name, int wave, double milliseconds) =>
+            (Name, Wave, Milliseconds) = (name, wave, milliseconds);
+    }
+
+    /// <summary>
+    /// The schedule of the last frame. Systems in the same wave ran in
+    /// parallel, the critical path is the slowest system of each wave.
+    /// </summary>
+    public sealed class ScheduleReport
+    {
+        public IReadOnlyList<SystemTiming> Systems { get; }
+        public double TotalMilliseconds { get; }
+
+        /// <summary>
+        /// The sum of the slowest system in every wave
+        /// </summary>
+        public double CriticalPathMilliseconds =>
+            Systems.GroupBy(s => s.Wave).Sum(w => w.Max(s => s.Milliseconds));
+
+        internal ScheduleReport(SystemTiming[] systems, double total) =>
+            (Systems, TotalMilliseconds) = (systems, total);
+
+        public override string ToString()
+        {
+            var builder = new StringBuilder();
+            builder.AppendLine($"Systems: {TotalMilliseconds:F3}ms, " +
+                $"critical path {CriticalPathMilliseconds:F3}ms");
+
+            foreach (var wave in Systems.GroupBy(s => s.Wave))
+            {
+                var slowest = wave.Max(s => s.Milliseconds);
+                builder.Append($"  Wave {wave.Key}:");
+
+                foreach (var system in wave)
+                {
+                    var mark = system.Milliseconds == slowest ? "*" : "";
+                    builder.Append($" {system.Name} {system.Milliseconds:F3}ms{mark}");
+                }
+
+                builder.AppendLine();
+            }
+
+            return builder.ToString();
+        }
+    }
+
+    /// <summary>
+    /// Groups systems into waves from their declared reads and writes.
+    /// A system goes in the wave after the last earlier system it
+    /// conflicts with, so conflicting systems keep their order.
+    /// </summary>
+    internal sealed class SystemScheduler
+    {
+        private class Node
+        {
+            public ISystem System = null!;
+            public string Name = "";
+            public HashSet<Type> Reads = new HashSet<Type>();
+            public HashSet<Type> Writes = new HashSet<Type>();
+            public bool Exclusive;
+            public EntityCommands Commands = new EntityCommands();
+        }
+
+        private readonly List<Node[]> waves = new List<Node[]>();
+        private readonly SystemTiming[] timings;
+        private readonly double[] elapsed;
+        private readonly Dictionary<ISystem, int> indices =
+            new Dictionary<ISystem, int>();
+
+        [ThreadStatic]
+        private static EntityCommands? currentCommands;
+
+        /// <summary>
+        /// The command buffer of the system running on this thread
+        /// </summary>
+        internal static EntityCommands? CurrentCommands => currentCommands;
+
+        internal SystemScheduler(List<ISystem> systems)
+        {
+            var nodes = systems.Select(CreateNode).ToArray();
+            var waveOf = new int[nodes.Length];
+
+            for (int j = 0; j < nodes.Length; j++)
+            {
+                indices[nodes[j].System] = j;
+
+                for (int i = 0; i < j; i++)
+                    if (Conflicts(nodes[i], nodes[j]))
+                        waveOf[j] = System.Math.Max(waveOf[j], waveOf[i] + 1);
+            }
+
+            int count = nodes.Length == 0 ? 0 : waveOf.Max() + 1;
+            for (int w = 0; w < count; w++)
+                waves.Add(nodes.Where((_, i) => waveOf[i] == w).ToArray());
+
+            timings = new SystemTiming[nodes.Length];
+            elapsed = new double[nodes.Length];
+        }
+
+        /// <summary>
+        /// Whether more than one system is running right now
+        /// </summary>
+        internal bool InParallelWave { get; private set; }
+
+        /// <summary>
+        /// Runs every wave, applying structural changes between them
+        /// </summary>
+        internal ScheduleReport Execute(EntityManager manager, Canvas canvas,
+            float deltaTime)
+        {
+            long start = Stopwatch.GetTimestamp();
+
+            for (int w = 0; w < waves.Count; w++)
+            {
+                var wave = waves[w];
+
+                if (wave.Length == 1)
+                {
+                    Run(wave[0], canvas, deltaTime);
+                }
+                else
+                {
+                    InParallelWave = true;
+                    try
+                    {
+                        Jobs.Dispatch(wave.Length, (i, worker) =>
+                            Run(wave[i], canvas, deltaTime));
+                    }
+                    finally { InParallelWave = false; }
+                }
+
+                // Sync point
+                foreach (var node in wave)
+                    node.Commands.Playback(manager);
+            }
+
+            int n = 0;
+            for (int w = 0; w < waves.Count; w++)
+                foreach (var node in waves[w])
+                    timings[n++] = new SystemTiming(node.Name, w,
+                        elapsed[indices[node.System]]);
+
+            return new ScheduleReport((SystemTiming[])timings.Clone(),
+                Milliseconds(start, Stopwatch.GetTimestamp()));
+        }
+
+        private void Run(Node node, Canvas canvas, float deltaTime)
+        {
+            long start = Stopwatch.GetTimestamp();
+            currentCommands = node.Commands;
+
+            try
+            {
+                using (Profiler.Zone(node.Name))
+                    node.System.Execute(canvas, deltaTime);
+            }
+            finally
+            {
+                currentCommands = null;
+                elapsed[indices[node.System]] =
+                    Milliseconds(start, Stopwatch.GetTimestamp());
+            }
+        }
+
+        private static double Milliseconds(long start, long end) =>
+            (end - start) * 1000.0 / Stopwatch.Frequency;
+
+        private static Node CreateNode(ISystem system)
+        {
+            var type = system.GetType();
+            var node = new Node() { System = system, Name = type.Name };
+
+            foreach (var reads in type.GetCustomAttributes<ReadsAttribute>())
+                node.Reads.UnionWith(reads.Types);
+            foreach (var writes in type.GetCustomAttributes<WritesAttribute>())
+                node.Writes.UnionWith(writes.Types);
+
+            // Undeclared systems could touch anything
+            node.Exclusive = node.Reads.Count == 0 && node.Writes.Count == 0;
+            return node;
+        }
+
+        private static bool Conflicts(Node a, Node b) =>
+            a.Exclusive || b.Exclusive ||
+            a.Writes.Overlaps(b.Writes) ||
+            a.Writes.Overlaps(b.Reads) ||
+            b.Writes.Overlaps(a.Reads);
+    }
+}
\ No newline at end of file
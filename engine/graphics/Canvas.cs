@@ -6,18 +6,51 @@ namespace Szark.Graphics
 {
     /// <summary>
     /// Provides simple drawing function for Textures.
+    /// When the Game lowers the render scale the canvas keeps
+    /// its coordinates and maps them onto the smaller target.
     /// </summary>
     public class Canvas
     {
         public Texture Target { get; internal set; }
         public Canvas(Texture target) => Target = target;
 
+        /// <summary>
+        /// Target pixels per canvas pixel
+        /// </summary>
+        public float Scale { get; private set; } = 1;
+
+        private int scaledWidth, scaledHeight;
+
+        /// <summary>
+        /// Width of the canvas in pixels
+        /// </summary>
+        public int Width => Scale == 1 ? (int)Target.Width : scaledWidth;
+
+        /// <summary>
+        /// Height of the canvas in pixels
+        /// </summary>
+        public int Height => Scale == 1 ? (int)Target.Height : scaledHeight;
+
         /// <summary>
         /// Draws a color at the given x and y.
         /// </summary>
         [MethodImpl(MethodImplOptions.AggressiveInlining)]
-        public void Draw(int x, int y, Color color) =>
-            Target[x, y] = color;
+        public void Draw(int x, int y, Color color)
+        {
+            if (Scale == 1)
+            {
+                Target[x, y] = color;
+                return;
+            }
+
+            int width = 1, height = 1;
+            ToTarget(ref x, ref y, ref width, ref height);
+
+            if (width == 1 && height == 1)
+                Target[x, y] = color;
+            else
+                FillTarget(x, y, width, height, color);
+        }
 
         /// <summary>
         /// Puts a color at the given point
@@ -36,37 +69,19 @@ namespace Szark.Graphics
         /// </summary>
         public void DrawLine(int x1, int y1, int x2, int y2, Color color, int thickness = 1)
         {
-            float x, y, step;
-            float dx = x2 - x1;
-            float dy = y2 - y1;
-
-            float absDX = Abs(dx);
-            float absDY = Abs(dy);
-
-            step = absDX >= absDY ? absDX : absDY;
-
-            dx /= step;
-            dy /= step;
-
-            x = x1;
-            y = y1;
-
-            for (int i = 1; i <= step; i++)
+            if (Scale != 1)
             {
-                Draw((int)x, (int)y, color);
+                (x1, y1, x2, y2) = (ToTarget(x1), ToTarget(y1), ToTarget(x2), ToTarget(y2));
+                thickness = ToTargetSize(thickness);
+            }
 
-                if (thickness > 1)
-                {
-                    for (int j = 1; j < thickness; j++)
-                    {
-                        Draw((int)x + j, (int)y, color);
-                        Draw((int)x, (int)y + j, color);
-                    }
-                }
+            Core.CanvasDrawLine(ref Target.Pixel0, Target.Format,
+                Target.Width, Target.Height,
+                x1, y1, x2, y2, color, thickness);
 
-                x += dx;
-                y += dy;
-            }
+            int extra = Max(thickness, 1);
+            Target.MarkDirty(Min(x1, x2), Min(y1, y2),
+                Abs(x2 - x1) + extra, Abs(y2 - y1) + extra);
         }
 
         /// <summary>
@@ -103,9 +118,8 @@ namespace Szark.Graphics
         /// </summary>
         public void FillRectangle(int x, int y, int width, int height, Color color)
         {
-            for (int i = 0; i < width; i++)
-                for (int j = 0; j < height; j++)
-                    Draw(x + i, y + j, color);
+            ToTarget(ref x, ref y, ref width, ref height);
+            FillTarget(x, y, width, height, color);
         }
 
         /// <summary>
@@ -166,15 +180,13 @@ namespace Szark.Graphics
         /// </summary>
         public void FillCircle(int x, int y, int radius, Color color)
         {
-            for (int i = 0; i < radius * 2; i++)
-            {
-                for (int j = 0; j < radius * 2; j++)
-                {
-                    var dist = Sqrt((radius - i) * (radius - i) +
-                        (radius - j) * (radius - j));
-                    if (dist < radius) Draw(x - 1 + i, y - 1 + j, color);
-                }
-            }
+            if (Scale != 1)
+                (x, y, radius) = (ToTarget(x), ToTarget(y), ToTargetSize(radius));
+
+            Core.CanvasFillCircle(ref Target.Pixel0, Target.Format,
+                Target.Width, Target.Height,
+                x, y, radius, color);
+            Target.MarkDirty(x - 1, y - 1, radius * 2, radius * 2);
         }
 
         /// <summary>
@@ -205,29 +217,19 @@ namespace Szark.Graphics
         /// </summary>
         public void FillTriangle(int x1, int y1, int x2, int y2, int x3, int y3, Color color)
         {
-            static float Area(int x1, int y1, int x2, int y2, int x3, int y3) =>
-                Abs((x1 * (y2 - y3) + x2 * (y3 - y1) + x3 * (y1 - y2)) / 2.0f);
-
-            var minX = Min(Min(x1, x2), x3);
-            var maxX = Max(Max(x1, x2), x3);
-
-            var minY = Min(Min(y1, y2), y3);
-            var maxY = Max(Max(y1, y2), y3);
-
-            float a = Area(x1, y1, x2, y2, x3, y3);
-
-            for (int x = minX; x < maxX; x++)
+            if (Scale != 1)
             {
-                for (int y = minY; y < maxY; y++)
-                {
-                    float a1 = Area(x, y, x2, y2, x3, y3);
-                    float a2 = Area(x1, y1, x, y, x3, y3);
-                    float a3 = Area(x1, y1, x2, y2, x, y);
-
-                    if (a == a1 + a2 + a3)
-                        Draw(x, y, color);
-                }
+                (x1, y1, x2, y2) = (ToTarget(x1), ToTarget(y1), ToTarget(x2), ToTarget(y2));
+                (x3, y3) = (ToTarget(x3), ToTarget(y3));
             }
+
+            Core.CanvasFillTriangle(ref Target.Pixel0, Target.Format,
+                Target.Width, Target.Height,
+                x1, y1, x2, y2, x3, y3, color);
+
+            int minX = Min(Min(x1, x2), x3), minY = Min(Min(y1, y2), y3);
+            Target.MarkDirty(minX, minY, Max(Max(x1, x2), x3) - minX,
+                Max(Max(y1, y2), y3) - minY);
         }
 
         /// <summary>
@@ -242,14 +244,18 @@ namespace Szark.Graphics
         /// </summary>
         public void DrawTexture(int x, int y, Texture texture, int scale = 1)
         {
-            for (int i = 0; i < texture.Width; i++)
-            {
-                for (int j = 0; j < texture.Height; j++)
-                {
-                    FillRectangle((x + i) * scale, (y + j) * scale,
-                        scale, scale, texture[i, j]);
-                }
-            }
+            if (scale <= 0) return;
+
+            x *= scale;
+            y *= scale;
+            int width = (int)texture.Width * scale, height = (int)texture.Height * scale;
+            ToTarget(ref x, ref y, ref width, ref height);
+
+            Core.CanvasDrawTexture(ref Target.Pixel0, Target.Format,
+                Target.Width, Target.Height,
+                ref texture.Pixel0, texture.Format, texture.Width, texture.Height,
+                x, y, width, height);
+            Target.MarkDirty(x, y, width, height);
         }
 
         /// <summary>
@@ -257,5 +263,41 @@ namespace Szark.Graphics
         /// </summary>
         public void DrawTexture(Vec2 point, Texture texture, int scale = 1) =>
             DrawTexture((int)point.X, (int)point.Y, texture, scale);
+
+        /// <summary>
+        /// Maps canvas pixels onto a target that is Scale times the
+        /// width and height. Must only be called by the Game.
+        /// </summary>
+        internal void SetScale(float scale, int width, int height) =>
+            (Scale, scaledWidth, scaledHeight) = (scale, width, height);
+
+        private void FillTarget(int x, int y, int width, int height, Color color)
+        {
+            Core.CanvasFillRect(ref Target.Pixel0, Target.Format,
+                Target.Width, Target.Height,
+                x, y, width, height, color);
+            Target.MarkDirty(x, y, width, height);
+        }
+
+        internal int ToTarget(int position) =>
+            (int)Floor(position * (double)Scale);
+
+        private int ToTargetSize(int size) =>
+            size <= 0 ? size : Max(1, (int)Round(size * (double)Scale));
+
+        // Rounds both edges down so neighbouring rectangles still meet
+        private void ToTarget(ref int x, ref int y, ref int width, ref int height)
+        {
+            if (Scale == 1) return;
+
+            int x0 = ToTarget(x), y0 = ToTarget(y);
+            int x1 = ToTarget(x + width), y1 = ToTarget(y + height);
+
+            // Never lets a scaled down rectangle vanish
+            if (width > 0) x1 = Max(x1, x0 + 1);
+            if (height > 0) y1 = Max(y1, y0 + 1);
+
+            (x, y, width, height) = (x0, y0, x1 - x0, y1 - y0);
+        }
     }
 }
\ No newline at end of file
@@ -121,6 +121,13 @@ namespace Szark.Graphics
             };
         }
 
+        /// <summary>
+        /// Creates the color that stands for a palette index when drawn
+        /// to an Indexed8 texture, which keeps only the red channel.
+        /// </summary>
+        public static Color FromIndex(byte index) =>
+            new Color(index, 0, 0);
+
         // -- Object Overrides --
 
         public override bool Equals(object? obj) =>
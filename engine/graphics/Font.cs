@@ -0,0 +1,71 @@
+using System;
+
+namespace Szark.Graphics
+{
+    /// <summary>
+    /// A bitmap font rasterized once by the core into a glyph atlas.
+    /// Strings are blitted from it onto canvases or drawn as sprites.
+    /// </summary>
+    public sealed class Font : IDisposable
+    {
+        /// <summary>
+        /// The built in 5x5 font
+        /// </summary>
+        public static Font Default { get; } = new Font(0);
+
+        public int GlyphWidth { get; }
+        public int GlyphHeight { get; }
+
+        internal uint ID { get; private set; }
+
+        private Font(uint id)
+        {
+            ID = id;
+            Core.GetFontSize(id, out uint width, out uint height);
+            (GlyphWidth, GlyphHeight) = ((int)width, (int)height);
+        }
+
+        /// <summary>
+        /// Creates a font from a texture of equally wide glyphs side by
+        /// side, starting at the first character. Pixels with a channel
+        /// of 128 or more are drawn, the rest are left out.
+        /// </summary>
+        public Font(Texture glyphs, int glyphWidth, char first = ' ')
+        {
+            if (glyphWidth <= 0 || glyphs.Width < glyphWidth)
+                throw new ArgumentException("Glyphs must fit the texture!");
+
+            int count = (int)glyphs.Width / glyphWidth;
+            int stripWidth = count * glyphWidth;
+            var coverage = new byte[stripWidth * glyphs.Height];
+
+            for (int y = 0; y < glyphs.Height; y++)
+                for (int x = 0; x < stripWidth; x++)
+                {
+                    var color = glyphs[x, y];
+                    coverage[y * stripWidth + x] = System.Math.Max(color.R,
+                        System.Math.Max(color.G, color.B));
+                }
+
+            ID = Core.CreateBitmapFont(coverage, (uint)glyphWidth,
+                glyphs.Height, first, (uint)count);
+            (GlyphWidth, GlyphHeight) = (glyphWidth, (int)glyphs.Height);
+        }
+
+        /// <summary>
+        /// How many pixels wide a string is drawn
+        /// </summary>
+        public int Measure(string text, int letterSpacing = 1) =>
+            (int)Core.MeasureText(ID, text, letterSpacing);
+
+        /// <summary>
+        /// Frees the glyph atlas, the default font can't be freed
+        /// </summary>
+        public void Dispose()
+        {
+            if (ID == 0) return;
+            Core.DestroyFont(ID);
+            ID = 0;
+        }
+    }
+}
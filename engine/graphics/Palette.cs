@@ -0,0 +1,76 @@
+using System;
+using System.Runtime.InteropServices;
+
+namespace Szark.Graphics
+{
+    /// <summary>
+    /// The 256 colors of Indexed8 textures. Indices are resolved on the
+    /// graphics card when drawn, so changing an entry recolors every
+    /// indexed texture without uploading any of them.
+    /// </summary>
+    public static class Palette
+    {
+        /// <summary>
+        /// How many colors the palette holds
+        /// </summary>
+        public const int Size = 256;
+
+        // Mirror of the core palette, which starts as a grey ramp
+        private static readonly Color[] colors = CreateRamp();
+
+        public static Color Get(byte index) => colors[index];
+
+        /// <summary>
+        /// Sets a single palette entry
+        /// </summary>
+        public static void Set(byte index, Color color) =>
+            Set(index, MemoryMarshal.CreateReadOnlySpan(ref color, 1));
+
+        /// <summary>
+        /// Sets consecutive palette entries starting at first.
+        /// Colors past the end of the palette are ignored.
+        /// </summary>
+        public static void Set(byte first, ReadOnlySpan<Color> entries)
+        {
+            int count = System.Math.Min(entries.Length, Size - first);
+            if (count <= 0) return;
+
+            entries.Slice(0, count).CopyTo(colors.AsSpan(first));
+            Core.SetPalette(ref colors[first], first, (uint)count);
+        }
+
+        /// <summary>
+        /// Shifts the entries from first to last (inclusive) by one place,
+        /// wrapping around. Called each frame it cycles their colors.
+        /// </summary>
+        public static void Rotate(byte first, byte last, bool forward = true)
+        {
+            if (last <= first) return;
+
+            // Rotated in place, the mirror is what gets sent
+            var range = colors.AsSpan(first, last - first + 1);
+            if (forward)
+            {
+                var wrapped = range[^1];
+                range[..^1].CopyTo(range[1..]);
+                range[0] = wrapped;
+            }
+            else
+            {
+                var wrapped = range[0];
+                range[1..].CopyTo(range);
+                range[^1] = wrapped;
+            }
+
+            Core.SetPalette(ref colors[first], first, (uint)range.Length);
+        }
+
+        private static Color[] CreateRamp()
+        {
+            var ramp = new Color[Size];
+            for (int i = 0; i < Size; i++)
+                ramp[i] = new Color((byte)i, (byte)i, (byte)i);
+            return ramp;
+        }
+    }
+}
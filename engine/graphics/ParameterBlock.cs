@@ -0,0 +1,59 @@
+using System;
+using System.Runtime.CompilerServices;
+
+namespace Szark.Graphics
+{
+    /// <summary>
+    /// A std140 uniform block of a shader written from a struct in a
+    /// single call. Only the 16 byte rows that changed since the last
+    /// update are uploaded. Lay the struct out like the block, with
+    /// vec3 and vec4 members starting on 16 byte boundaries.
+    /// </summary>
+    public sealed class ParameterBlock<T> : IDisposable where T : unmanaged
+    {
+        /// <summary>
+        /// The core ID of the block, 0 when running headless
+        /// </summary>
+        public uint ID { get; private set; }
+
+        /// <summary>
+        /// The size of the block in the shader in bytes
+        /// </summary>
+        public uint Size => Core.GetParameterBlockSize(ID);
+
+        /// <summary>
+        /// How many bytes the last update uploaded
+        /// </summary>
+        public uint LastUpload { get; private set; }
+
+        internal ParameterBlock(uint id)
+        {
+            ID = id;
+
+            if (ID != 0 && Unsafe.SizeOf<T>() > Size)
+            {
+                Dispose();
+                throw new ArgumentException($"{typeof(T).Name} is larger " +
+                    "than the uniform block in the shader!");
+            }
+        }
+
+        /// <summary>
+        /// Writes every parameter of the block at once
+        /// </summary>
+        public unsafe void Update(in T parameters)
+        {
+            fixed (T* data = &parameters)
+                LastUpload = Core.UpdateParameterBlock(ID, data, (uint)sizeof(T));
+        }
+
+        /// <summary>
+        /// Frees the uniform buffer of the block
+        /// </summary>
+        public void Dispose()
+        {
+            Core.DestroyParameterBlock(ID);
+            ID = 0;
+        }
+    }
+}
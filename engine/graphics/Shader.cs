@@ -9,6 +9,23 @@ namespace Szark.Graphics
         public readonly uint ID;
         public Shader(uint id) => ID = id;
 
+        /// <summary>
+        /// Recompiles the shader in the background whenever one of its
+        /// files changes. The shader and its locations stay valid, but
+        /// uniforms have to be sent again after a reload.
+        /// </summary>
+        /// <returns>False when running headless</returns>
+        public bool Watch(string vertexPath, string fragmentPath) =>
+            Core.WatchShader(ID, vertexPath, fragmentPath);
+
+        /// <summary>
+        /// Creates a buffer for a uniform block of the shader, which takes
+        /// all of its parameters in one call
+        /// </summary>
+        /// <param name="name">The name of the block in the shader</param>
+        public ParameterBlock<T> CreateBlock<T>(string name) where T : unmanaged =>
+            new ParameterBlock<T>(Core.CreateParameterBlock(ID, name));
+
         public uint? GetLocation(string name)
         {
             int val = Core.GetUniformLocation(ID, name);
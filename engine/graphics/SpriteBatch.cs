@@ -0,0 +1,141 @@
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+
+namespace Szark.Graphics
+{
+    /// <summary>
+    /// A single sprite instance. Positions and sizes are in screen
+    /// pixels, the source rectangle is in atlas pixels.
+    /// Lower depth values are drawn in front.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct Sprite
+    {
+        public float X, Y, Width, Height;
+        public float U, V, SourceWidth, SourceHeight;
+        public byte R, G, B, A;
+        public float Depth;
+
+        public Sprite(float x, float y, int u, int v, int width, int height,
+            Color tint, float depth = 0)
+        {
+            (X, Y, Width, Height) = (x, y, width, height);
+            (U, V, SourceWidth, SourceHeight) = (u, v, width, height);
+            (R, G, B, A) = (tint.R, tint.G, tint.B, 255);
+            Depth = depth;
+        }
+    }
+
+    /// <summary>
+    /// A texture that sprites are cut out of
+    /// </summary>
+    public class SpriteAtlas
+    {
+        public Texture Texture { get; private set; }
+        internal uint ID { get; private set; }
+
+        public SpriteAtlas(Texture texture)
+        {
+            Texture = texture;
+            ID = texture.GenerateID();
+        }
+
+        /// <summary>
+        /// Uploads any changes made to the atlas texture
+        /// </summary>
+        public void Update() => Texture.Update(ID);
+    }
+
+    /// <summary>
+    /// Collects sprites during a frame and draws them on top of the
+    /// canvas with one instanced draw call per atlas.
+    /// </summary>
+    public class SpriteBatch
+    {
+        // Sprites waiting to be submitted, per atlas id
+        private readonly Dictionary<uint, Sprite[]> batches =
+            new Dictionary<uint, Sprite[]>();
+        private readonly Dictionary<uint, int> counts =
+            new Dictionary<uint, int>();
+
+        /// <summary>
+        /// The atlas color drawn as transparent, null disables it.
+        /// Defaults to magenta.
+        /// </summary>
+        public Color? ColorKey
+        {
+            get => colorKey; set
+            {
+                Core.SetSpriteColorKey(value ?? Color.Magenta, value != null);
+                colorKey = value;
+            }
+        }
+
+        private Color? colorKey = Color.Magenta;
+
+        /// <summary>
+        /// Queues a sprite cut out of the atlas
+        /// </summary>
+        public void Draw(SpriteAtlas atlas, in Sprite sprite)
+        {
+            var batch = Reserve(atlas.ID, 1, out int start);
+            batch[start] = sprite;
+        }
+
+        /// <summary>
+        /// Queues an untinted sprite cut out of the atlas
+        /// </summary>
+        public void Draw(SpriteAtlas atlas, float x, float y, int u, int v,
+            int width, int height, float depth = 0) =>
+            Draw(atlas, new Sprite(x, y, u, v, width, height, Color.White, depth));
+
+        /// <summary>
+        /// Queues many sprites from the same atlas at once
+        /// </summary>
+        public void Draw(SpriteAtlas atlas, ReadOnlySpan<Sprite> sprites)
+        {
+            var batch = Reserve(atlas.ID, sprites.Length, out int start);
+            sprites.CopyTo(batch.AsSpan(start));
+        }
+
+        /// <summary>
+        /// Submits every queued sprite and draws them
+        /// </summary>
+        internal void Flush(int screenWidth, int screenHeight)
+        {
+            foreach (var pair in batches)
+            {
+                int count = counts[pair.Key];
+                if (count == 0) continue;
+
+                Core.SubmitSprites(pair.Key, ref pair.Value[0], (uint)count);
+                counts[pair.Key] = 0;
+            }
+
+            Core.RenderSprites((uint)screenWidth, (uint)screenHeight);
+        }
+
+        private Sprite[] Reserve(uint atlas, int amount, out int start)
+        {
+            if (!batches.TryGetValue(atlas, out var batch))
+            {
+                batch = new Sprite[System.Math.Max(amount, 64)];
+                batches[atlas] = batch;
+                counts[atlas] = 0;
+            }
+
+            start = counts[atlas];
+
+            if (start + amount > batch.Length)
+            {
+                Array.Resize(ref batch, System.Math.Max(batch.Length * 2,
+                    start + amount));
+                batches[atlas] = batch;
+            }
+
+            counts[atlas] = start + amount;
+            return batch;
+        }
+    }
+}
\ No newline at end of file
@@ -1,17 +1,114 @@
 ﻿using System;
-using System.IO;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
 
 namespace Szark.Graphics
 {
-    public class Texture
+    /// <summary>
+    /// How the pixels of a texture are laid out in memory
+    /// </summary>
+    public enum PixelFormat : uint
     {
-        public Color[] Pixels => _pixels;
+        /// <summary>
+        /// Three bytes per pixel, the default
+        /// </summary>
+        RGB24,
+
+        /// <summary>
+        /// Four bytes per pixel, alpha is kept but not blended
+        /// </summary>
+        RGBA32,
+
+        /// <summary>
+        /// One palette index per pixel, resolved through the
+        /// Palette when drawn. Colors written to it use their
+        /// red channel as the index, see Color.FromIndex.
+        /// </summary>
+        Indexed8
+    }
+
+    public class Texture : IDisposable
+    {
+        /// <summary>
+        /// Size in pixels of the square tiles used to track changes
+        /// </summary>
+        public const int TileSize = 32;
+
+        /// <summary>
+        /// The raw pixels of the texture. Writes through this array
+        /// can't be tracked, so accessing it marks the whole texture dirty.
+        /// </summary>
+        public Color[] Pixels
+        {
+            get
+            {
+                if (IsStreaming)
+                    throw new InvalidOperationException(
+                        "Streaming textures are owned by the core, use Span!");
+                RequireRGB24();
+
+                MarkDirty();
+                return _pixels;
+            }
+        }
+
+        /// <summary>
+        /// The raw pixels of the texture, wherever they are stored.
+        /// Accessing it marks the whole texture dirty.
+        /// </summary>
+        public Span<Color> Span
+        {
+            get
+            {
+                RequireRGB24();
+                MarkDirty();
+                return Data;
+            }
+        }
+
+        /// <summary>
+        /// The bytes of the pixels in any format, wherever they are
+        /// stored. Accessing it marks the whole texture dirty.
+        /// </summary>
+        public Span<byte> Bytes
+        {
+            get
+            {
+                MarkDirty();
+                return RawData;
+            }
+        }
 
         public uint Width { get; private set; }
         public uint Height { get; private set; }
 
+        public PixelFormat Format { get; private set; }
+
+        /// <summary>
+        /// Whether the pixels are owned by the core and
+        /// streamed to the graphics card asynchronously
+        /// </summary>
+        public bool IsStreaming => streamID != 0;
+
         private Color[] _pixels;
 
+        // Managed pixels of the formats other than RGB24
+        private byte[] rawPixels = Array.Empty<byte>();
+
+        // Core-owned pixels of a streaming texture
+        private IntPtr nativePixels;
+        private uint streamID;
+
+        // Whether each tile changed since the last Update
+        private bool[] dirtyTiles = Array.Empty<bool>();
+        private int tilesX, tilesY;
+        private bool isDirty;
+
+        // Reused by GetDirtyRegions so updates don't allocate
+        private Rect[] dirtyRegions = Array.Empty<Rect>();
+        private int[] previousRuns = Array.Empty<int>();
+        private int[] currentRuns = Array.Empty<int>();
+
         public Color this[int x, int y]
         {
             get => Read(x, y);
@@ -21,107 +118,362 @@ namespace Szark.Graphics
         /// <summary>
         /// Creates an empty texture
         /// </summary>
-        public Texture(uint width, uint height)
+        public Texture(uint width, uint height) :
+            this(width, height, PixelFormat.RGB24)
+        {
+        }
+
+        /// <summary>
+        /// Creates an empty texture of the given format
+        /// </summary>
+        public Texture(uint width, uint height, PixelFormat format)
         {
             Width = width;
             Height = height;
-            _pixels = new Color[width * height];
+            Format = format;
+
+            if (format == PixelFormat.RGB24)
+                _pixels = new Color[width * height];
+            else
+            {
+                _pixels = Array.Empty<Color>();
+                rawPixels = new byte[width * height * GetPixelSize(format)];
+            }
+
+            ResizeTiles();
+        }
+
+        private Texture(uint width, uint height, PixelFormat format,
+            uint streamID, IntPtr pixels)
+        {
+            Width = width;
+            Height = height;
+            Format = format;
+            _pixels = Array.Empty<Color>();
+            nativePixels = pixels;
+            this.streamID = streamID;
+            ResizeTiles();
         }
 
         /// <summary>
-        /// Creates a texture from a bitmap file
+        /// Creates a texture whose pixels live in aligned core memory.
+        /// Updates are copied into a ring of pixel buffers and uploaded
+        /// while the next frame is drawn. Requires the renderer.
         /// </summary>
-        public Texture(string filePath)
+        public static Texture CreateStreaming(uint width, uint height,
+            PixelFormat format = PixelFormat.RGB24)
         {
-            try
-            {
-                using var stream = File.Open(filePath, FileMode.Open);
-                using var reader = new BinaryReader(stream);
+            uint id = Core.CreateStreamingTexture(width, height, format);
+            if (id == 0)
+                throw new ApplicationException("Failed to create streaming texture!");
+            return new Texture(width, height, format, id, Core.GetStreamingPixels(id));
+        }
+
+        /// <summary>
+        /// Changes the size of a streaming texture without reallocating,
+        /// up to the size it was created with. The pixels are scaled to
+        /// the new size, so the image stays in place until drawn again.
+        /// </summary>
+        public bool Resize(uint width, uint height)
+        {
+            if (!IsStreaming || !Core.ResizeStreamingTexture(streamID, width, height))
+                return false;
 
-                ushort identity = reader.ReadUInt16();
-                uint size = reader.ReadUInt32();
-                uint reserved = reader.ReadUInt32();
-                uint offset = reader.ReadUInt32();
+            (Width, Height) = (width, height);
+            ResizeTiles();
+            MarkDirty();
+            return true;
+        }
 
-                uint dibSize = reader.ReadUInt32();
-                uint width = reader.ReadUInt32();
-                uint height = reader.ReadUInt32();
+        /// <summary>
+        /// How many bytes a pixel of a format takes
+        /// </summary>
+        public static int GetPixelSize(PixelFormat format) => format switch
+        {
+            PixelFormat.RGBA32 => 4,
+            PixelFormat.Indexed8 => 1,
+            _ => 3
+        };
 
-                ushort planes = reader.ReadUInt16();
-                ushort bpp = reader.ReadUInt16();
-                uint compression = reader.ReadUInt32();
-                uint totalSize = reader.ReadUInt32();
+        /// <summary>
+        /// Creates a texture from a BMP, TGA or PNG file. The file is
+        /// memory mapped and decoded by the core. A magenta texture
+        /// stands in when the file can't be read.
+        /// </summary>
+        public unsafe Texture(string filePath)
+        {
+            _pixels = Array.Empty<Color>();
+            var image = Core.MapAssetFile(filePath, out ulong size);
 
-                stream.Seek(offset, SeekOrigin.Begin);
+            if (image == null)
+            {
+                Game.Get<Game>()?.Error($"Could not find image file {filePath}!");
+                Decode(null, 0, filePath);
+                return;
+            }
 
-                _pixels = new Color[width * height];
-                Width = width;
-                Height = height;
+            Decode(image, size, filePath);
+            Core.UnmapAssetFile(image);
+        }
 
-                int x = 0;
-                int y = (int)height - 1;
+        /// <summary>
+        /// Creates a texture from an image in memory, such as an archive entry
+        /// </summary>
+        internal unsafe Texture(void* image, ulong size, string name)
+        {
+            _pixels = Array.Empty<Color>();
+            Decode(image, size, name);
+        }
 
-                int pixelSize = bpp / 8;
-                Span<byte> pixel = stackalloc byte[pixelSize];
-                while (reader.Read(pixel) > 0)
+        // Decodes straight into the pixel array, or falls back to magenta
+        private unsafe void Decode(void* image, ulong size, string name)
+        {
+            if (image != null)
+            {
+                if (Core.ReadImageSize(image, size, out uint width, out uint height))
                 {
-                    this[x, y] = new Color()
+                    // Sizes too large for an array are treated as unreadable
+                    ulong count = (ulong)width * height;
+                    var pixels = count <= int.MaxValue ? new Color[count] : null;
+                    if (pixels != null && Core.DecodeImage(image, size, ref pixels[0], width, height))
                     {
-                        R = pixel[2],
-                        G = pixel[1],
-                        B = pixel[0]
-                    };
-
-                    x++;
-                    if (x >= width)
-                    {
-                        y--;
-                        x = 0;
+                        (Width, Height) = (width, height);
+                        _pixels = pixels;
+                        ResizeTiles();
+                        return;
                     }
+
+                    Game.Get<Game>()?.Error($"Failed to decode {name}!");
                 }
+                else
+                    Game.Get<Game>()?.Error($"{name} is not a BMP, TGA or PNG image!");
             }
-            catch (FileNotFoundException)
-            {
-                Game.Get<Game>()?.Error("Could not find bitmap file!");
-            }
-            catch (Exception)
-            {
-                Game.Get<Game>()?.Error("Invalid bitmap file!");
-            }
-            finally
-            {
-                // This creates a fallback texture
-                (Width, Height) = (16, 16);
-                _pixels = new Color[Width * Height];
-                Clear(Color.Magenta);
-            }
+
+            (Width, Height) = (16, 16);
+            _pixels = new Color[Width * Height];
+            ResizeTiles();
+            Clear(Color.Magenta);
         }
 
+        /// <summary>
+        /// Reads a pixel, indexed textures return Color.FromIndex
+        /// </summary>
         public Color Read(int x, int y)
         {
             if (x < 0 || x >= Width || y < 0 || y >= Height)
                 return new Color();
-            return Pixels[y * Width + x];
+
+            int index = (int)(y * Width + x);
+            switch (Format)
+            {
+                case PixelFormat.RGBA32:
+                    var rgba = RawData.Slice(index * 4, 3);
+                    return new Color(rgba[0], rgba[1], rgba[2]);
+                case PixelFormat.Indexed8:
+                    return Color.FromIndex(RawData[index]);
+                default:
+                    return Data[index];
+            }
         }
 
+        /// <summary>
+        /// Writes a pixel, indexed textures store the red channel
+        /// </summary>
         public void Write(int x, int y, Color color)
         {
             if (x >= 0 && x < Width && y >= 0 && y < Height)
-                Pixels[y * Width + x] = color;
+            {
+                int index = (int)(y * Width + x);
+                switch (Format)
+                {
+                    case PixelFormat.RGBA32:
+                        var rgba = RawData.Slice(index * 4, 4);
+                        (rgba[0], rgba[1], rgba[2], rgba[3]) = (color.R, color.G, color.B, 255);
+                        break;
+                    case PixelFormat.Indexed8:
+                        RawData[index] = color.R;
+                        break;
+                    default:
+                        Data[index] = color;
+                        break;
+                }
+
+                dirtyTiles[(y / TileSize) * tilesX + (x / TileSize)] = true;
+                isDirty = true;
+            }
         }
 
         public void Clear(Color color)
         {
-            for (int i = 0; i < Pixels.Length; i++)
-                Pixels[i] = color;
+            Core.CanvasFillRect(ref Pixel0, Format, Width, Height, 0, 0,
+                (int)Width, (int)Height, color);
+            MarkDirty();
+        }
+
+        /// <summary>
+        /// Marks the whole texture as changed
+        /// </summary>
+        public void MarkDirty() =>
+            MarkDirty(0, 0, (int)Width, (int)Height);
+
+        /// <summary>
+        /// Marks a region of the texture as changed so the
+        /// next Update uploads it. The region is clipped.
+        /// </summary>
+        public void MarkDirty(int x, int y, int width, int height)
+        {
+            int x0 = System.Math.Max(x, 0);
+            int y0 = System.Math.Max(y, 0);
+            int x1 = (int)System.Math.Min((long)x + width, Width);
+            int y1 = (int)System.Math.Min((long)y + height, Height);
+            if (x0 >= x1 || y0 >= y1) return;
+
+            for (int ty = y0 / TileSize; ty <= (y1 - 1) / TileSize; ty++)
+                for (int tx = x0 / TileSize; tx <= (x1 - 1) / TileSize; tx++)
+                    dirtyTiles[ty * tilesX + tx] = true;
+
+            isDirty = true;
         }
 
         public Canvas GetCanvas() => new Canvas(this);
 
-        public uint GenerateID() =>
-            Core.GenerateTextureID(Pixels, Width, Height);
+        /// <summary>
+        /// The RGB24 pixels without marking anything dirty, for
+        /// internal writers that track their own regions.
+        /// </summary>
+        internal unsafe Span<Color> Data => IsStreaming ?
+            new Span<Color>(nativePixels.ToPointer(), (int)(Width * Height)) :
+            _pixels;
+
+        /// <summary>
+        /// The bytes of the pixels in any format without marking anything dirty
+        /// </summary>
+        internal unsafe Span<byte> RawData => IsStreaming ?
+            new Span<byte>(nativePixels.ToPointer(),
+                (int)(Width * Height) * GetPixelSize(Format)) :
+            Format == PixelFormat.RGB24 ?
+                MemoryMarshal.AsBytes(_pixels.AsSpan()) : rawPixels;
+
+        /// <summary>
+        /// Reference to the first pixel for passing to the core
+        /// </summary>
+        internal ref byte Pixel0 => ref MemoryMarshal.GetReference(RawData);
+
+        public uint GenerateID()
+        {
+            ClearDirty();
+            if (IsStreaming) return streamID;
+            return Core.GenerateTextureID(ref Pixel0, Width, Height, Format);
+        }
+
+        /// <summary>
+        /// Uploads the regions that changed since the last update.
+        /// Nothing is uploaded when the texture hasn't changed.
+        /// </summary>
+        public void Update(uint textureID)
+        {
+            if (!isDirty) return;
+
+            int count = GetDirtyRegions();
+
+            if (IsStreaming)
+                Core.StreamTextureRegions(streamID, dirtyRegions, (uint)count);
+            else
+                Core.UpdateTextureRegions(textureID, ref Pixel0, Width, Height,
+                    dirtyRegions, (uint)count);
+
+            ClearDirty();
+        }
+
+        /// <summary>
+        /// Frees the core-owned pixels of a streaming texture
+        /// </summary>
+        public void Dispose()
+        {
+            if (!IsStreaming) return;
+
+            Core.DestroyStreamingTexture(streamID);
+            (Width, Height) = (0, 0);
+            nativePixels = IntPtr.Zero;
+            streamID = 0;
+            ResizeTiles();
+        }
+
+        private void RequireRGB24()
+        {
+            if (Format != PixelFormat.RGB24)
+                throw new InvalidOperationException(
+                    $"{Format} textures have no Color pixels, use Bytes!");
+        }
+
+        private void ResizeTiles()
+        {
+            tilesX = ((int)Width + TileSize - 1) / TileSize;
+            tilesY = ((int)Height + TileSize - 1) / TileSize;
+            dirtyTiles = new bool[tilesX * tilesY];
+            isDirty = false;
+
+            // Each tile is at most one region and a row has at most one run per tile
+            dirtyRegions = new Rect[tilesX * tilesY];
+            previousRuns = new int[tilesX];
+            currentRuns = new int[tilesX];
+        }
+
+        private void ClearDirty()
+        {
+            Array.Clear(dirtyTiles, 0, dirtyTiles.Length);
+            isDirty = false;
+        }
+
+        // Merges dirty tiles into horizontal runs, then grows the
+        // run from the row above when it covers the same columns.
+        // Fills dirtyRegions and returns how many regions it holds.
+        private int GetDirtyRegions()
+        {
+            int count = 0, previousCount = 0;
+            var previous = previousRuns;
+            var current = currentRuns;
+
+            for (int ty = 0; ty < tilesY; ty++)
+            {
+                int currentCount = 0;
 
-        public uint Update(uint textureID) =>
-            Core.UpdateTexture(textureID, Pixels, Width, Height);
+                for (int tx = 0; tx < tilesX; tx++)
+                {
+                    if (!dirtyTiles[ty * tilesX + tx]) continue;
+
+                    int start = tx;
+                    while (tx < tilesX && dirtyTiles[ty * tilesX + tx]) tx++;
+
+                    int x = start * TileSize, y = ty * TileSize;
+                    int w = System.Math.Min(tx * TileSize, (int)Width) - x;
+                    int h = System.Math.Min(TileSize, (int)Height - y);
+
+                    int match = -1;
+                    for (int i = 0; i < previousCount && match < 0; i++)
+                    {
+                        ref var region = ref dirtyRegions[previous[i]];
+                        if (region.x == x && region.width == w) match = i;
+                    }
+
+                    if (match >= 0)
+                    {
+                        dirtyRegions[previous[match]].height += h;
+                        current[currentCount++] = previous[match];
+                        previous[match] = previous[--previousCount];
+                    }
+                    else
+                    {
+                        dirtyRegions[count] = new Rect { x = x, y = y, width = w, height = h };
+                        current[currentCount++] = count++;
+                    }
+                }
+
+                (previous, current) = (current, previous);
+                previousCount = currentCount;
+            }
+
+            return count;
+        }
     }
 }
@@ -0,0 +1,18 @@
+namespace Szark.Graphics
+{
+    /// <summary>
+    /// A region of the screen rendered by one job system worker
+    /// </summary>
+    public readonly struct Tile
+    {
+        public readonly int X, Y, Width, Height;
+
+        /// <summary>
+        /// The worker rendering this tile, below Jobs.WorkerCount
+        /// </summary>
+        public readonly int Worker;
+
+        public Tile(int x, int y, int width, int height, int worker) =>
+            (X, Y, Width, Height, Worker) = (x, y, width, height, worker);
+    }
+}
@@ -0,0 +1,53 @@
+using System.Runtime.InteropServices;
+
+namespace Szark.Input
+{
+    public enum InputEventType : uint
+    {
+        Key,
+        Mouse,
+        Scroll,
+        Cursor
+    }
+
+    /// <summary>
+    /// A window event recorded by the core with the time it arrived.
+    /// Keys and buttons use Key, Button and Mods, the cursor and
+    /// scroll use X and Y.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct InputEvent
+    {
+        /// <summary>
+        /// Seconds on the clock of Game.InputTime
+        /// </summary>
+        public double Time;
+        public double X, Y;
+        public InputEventType Type;
+
+        internal int code;
+        internal Action action;
+
+        /// <summary>
+        /// GLFW modifier bits held during a key or button event
+        /// </summary>
+        public int Mods;
+
+        public Key Key => (Key)code;
+        public int Button => code;
+        public bool IsPressed => action != Action.Release;
+        public bool IsRepeat => action == Action.Repeat;
+    }
+
+    /// <summary>
+    /// Input event counts since startup, and the seconds from the
+    /// newest and oldest event shown in the last frame with input
+    /// until that frame was presented
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct InputStats
+    {
+        public ulong Events, Dropped;
+        public double Latency, WorstLatency;
+    }
+}
@@ -0,0 +1,224 @@
+using System;
+using System.Runtime.InteropServices;
+
+using Szark.ECS;
+using Szark.Math;
+
+namespace Szark.Physics
+{
+    /// <summary>
+    /// A spatial hash over axis aligned boxes in the core. Build it from
+    /// the component columns once per frame, then find overlapping pairs
+    /// or query it as often as needed without testing every pair.
+    /// </summary>
+    public sealed class Broadphase : IDisposable
+    {
+        /// <summary>
+        /// Width and height of a grid cell
+        /// </summary>
+        public float CellSize { get; }
+
+        /// <summary>
+        /// Counts and timing of the last build and pair search
+        /// </summary>
+        public BroadphaseStats Stats => Core.GetBroadphaseStats(id);
+
+        private uint id;
+        private EntityPair[] pairs = new EntityPair[64];
+
+        /// <param name="cellSize">About the size of the common box.
+        /// Boxes much larger than a cell are tested against all others.</param>
+        public Broadphase(float cellSize = 64)
+        {
+            if (!(cellSize > 0))
+                throw new ArgumentOutOfRangeException(nameof(cellSize));
+
+            CellSize = cellSize;
+            id = Core.CreateBroadphase(cellSize);
+        }
+
+        /// <summary>
+        /// Rebuilds from every entity the query matches. The component
+        /// holds the box as four floats, a position followed by a size,
+        /// starting at boundsOffset bytes into it.
+        /// </summary>
+        public void Build<T>(QueryBuilder query, int boundsOffset = 0)
+            where T : unmanaged, IComponent
+        {
+            Clear();
+            query.ForEachChunk((ReadOnlySpan<Entity> entities, Span<T> bounds) =>
+                Add<T>(entities, bounds, boundsOffset));
+            Build();
+        }
+
+        /// <summary>
+        /// Removes every box to start a rebuild
+        /// </summary>
+        public void Clear() => Core.ClearBroadphase(id);
+
+        /// <summary>
+        /// Adds boxes for the next Build. Each value holds its box as a
+        /// position and a size of four floats at boundsOffset bytes.
+        /// </summary>
+        public unsafe void Add<T>(ReadOnlySpan<Entity> entities,
+            ReadOnlySpan<T> bounds, int boundsOffset = 0) where T : unmanaged
+        {
+            if (entities.Length != bounds.Length)
+                throw new ArgumentException("Every entity needs a box!");
+            if (boundsOffset < 0 || boundsOffset + sizeof(float) * 4 > sizeof(T))
+                throw new ArgumentOutOfRangeException(nameof(boundsOffset));
+
+            fixed (Entity* entitiesPtr = entities)
+            fixed (T* boundsPtr = bounds)
+            {
+                Core.InsertBroadphase(id, (ulong*)entitiesPtr,
+                    (byte*)boundsPtr + boundsOffset, (uint)sizeof(T),
+                    (uint)entities.Length);
+            }
+        }
+
+        /// <summary>
+        /// Puts the added boxes in the grid, queries see them from now on
+        /// </summary>
+        public void Build() => Core.BuildBroadphase(id);
+
+        /// <summary>
+        /// Every pair of overlapping boxes, found once per build. Touching
+        /// boxes overlap. Valid until the next call.
+        /// </summary>
+        public ReadOnlySpan<EntityPair> FindPairs()
+        {
+            while (true)
+            {
+                int count = (int)Core.FindBroadphasePairs(id,
+                    ref pairs[0], (uint)pairs.Length);
+
+                if (count <= pairs.Length)
+                    return new ReadOnlySpan<EntityPair>(pairs, 0, count);
+
+                pairs = new EntityPair[count];
+            }
+        }
+
+        /// <summary>
+        /// Writes the entities whose boxes contain the point and returns
+        /// how many there are, which can be more than fit in results
+        /// </summary>
+        public unsafe int QueryPoint(Vec2 point, Span<Entity> results)
+        {
+            fixed (Entity* resultsPtr = results)
+            {
+                return (int)Core.QueryBroadphasePoint(id, point.X, point.Y,
+                    (ulong*)resultsPtr, (uint)results.Length);
+            }
+        }
+
+        /// <summary>
+        /// Writes the entities whose boxes overlap the box and returns
+        /// how many there are, which can be more than fit in results
+        /// </summary>
+        public unsafe int QueryRect(Vec2 position, Vec2 size, Span<Entity> results)
+        {
+            fixed (Entity* resultsPtr = results)
+            {
+                return (int)Core.QueryBroadphaseRect(id, position.X, position.Y,
+                    size.X, size.Y, (ulong*)resultsPtr, (uint)results.Length);
+            }
+        }
+
+        /// <summary>
+        /// Finds the nearest box along a ray
+        /// </summary>
+        public bool Raycast(Vec2 origin, Vec2 direction, out RaycastHit hit,
+            float maxDistance = float.PositiveInfinity)
+        {
+            Span<Ray> ray = stackalloc Ray[] { new Ray(origin, direction, maxDistance) };
+            Span<RaycastHit> hits = stackalloc RaycastHit[1];
+
+            Raycast(ray, hits);
+            hit = hits[0];
+            return hit.Hit;
+        }
+
+        /// <summary>
+        /// Finds the nearest box along every ray at once.
+        /// Returns how many of them hit something.
+        /// </summary>
+        public unsafe int Raycast(ReadOnlySpan<Ray> rays, Span<RaycastHit> hits)
+        {
+            if (hits.Length < rays.Length)
+                throw new ArgumentException("Every ray needs a hit!");
+
+            fixed (Ray* raysPtr = rays)
+            fixed (RaycastHit* hitsPtr = hits)
+            {
+                return (int)Core.RaycastBroadphase(id, raysPtr,
+                    (uint)rays.Length, hitsPtr);
+            }
+        }
+
+        /// <summary>
+        /// Frees the grid in the core
+        /// </summary>
+        public void Dispose()
+        {
+            if (id == 0) return;
+            Core.DestroyBroadphase(id);
+            id = 0;
+        }
+    }
+
+    /// <summary>
+    /// Two entities whose boxes overlap
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct EntityPair
+    {
+        public Entity A, B;
+    }
+
+    /// <summary>
+    /// A ray cast through a broadphase. The direction doesn't need to be
+    /// normalized, distances are measured in world units.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct Ray
+    {
+        public Vec2 Origin, Direction;
+        public float MaxDistance;
+
+        public Ray(Vec2 origin, Vec2 direction,
+            float maxDistance = float.PositiveInfinity) =>
+            (Origin, Direction, MaxDistance) = (origin, direction, maxDistance);
+    }
+
+    /// <summary>
+    /// Where a ray first hit a box. Rays starting inside a box hit it at
+    /// a distance of 0 without a normal.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct RaycastHit
+    {
+        public Entity Entity;
+        public float Distance;
+        public Vec2 Point, Normal;
+
+        /// <summary>
+        /// Whether the ray hit anything
+        /// </summary>
+        public bool Hit => Entity != Entity.None;
+    }
+
+    /// <summary>
+    /// Boxes in the last build, how many of them were too large for the
+    /// grid, and the pairs tested and found by the last pair search.
+    /// Build time is in seconds and includes adding the boxes.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct BroadphaseStats
+    {
+        public uint Items, LargeItems, CellEntries;
+        public ulong CandidatePairs, Pairs;
+        public double BuildTime;
+    }
+}
@@ -0,0 +1,121 @@
+using System;
+using System.Runtime.InteropServices;
+
+using Szark.Math;
+
+namespace Szark.Physics
+{
+    /// <summary>
+    /// A grid of tiles in the core, each one unit wide. Tile 0 is empty
+    /// and any other value is solid. Upload it once and change single
+    /// tiles as the map changes, then cast whole screens of rays at once.
+    /// </summary>
+    public sealed class TileGrid : IDisposable
+    {
+        public int Width { get; }
+        public int Height { get; }
+
+        private uint id;
+
+        public TileGrid(int width, int height)
+        {
+            if (width <= 0 || height <= 0)
+                throw new ArgumentOutOfRangeException(width <= 0 ?
+                    nameof(width) : nameof(height));
+
+            (Width, Height) = (width, height);
+            id = Core.CreateTileGrid((uint)width, (uint)height);
+        }
+
+        /// <summary>
+        /// A single tile, cells outside the grid are empty
+        /// </summary>
+        public unsafe byte this[int x, int y]
+        {
+            get => Core.GetTile(id, x, y);
+            set => Core.SetTiles(id, x, y, 1, 1, &value);
+        }
+
+        /// <summary>
+        /// Copies rows of tiles into a rectangle of the grid.
+        /// Tiles outside the grid are skipped.
+        /// </summary>
+        public unsafe void SetTiles(int x, int y, int width, int height,
+            ReadOnlySpan<byte> tiles)
+        {
+            if (width < 0 || height < 0 || tiles.Length < width * height)
+                throw new ArgumentException("Not enough tiles for the rectangle!");
+
+            fixed (byte* tilesPtr = tiles)
+                Core.SetTiles(id, x, y, (uint)width, (uint)height, tilesPtr);
+        }
+
+        /// <summary>
+        /// Replaces every tile, row by row
+        /// </summary>
+        public void SetTiles(ReadOnlySpan<byte> tiles) =>
+            SetTiles(0, 0, Width, Height, tiles);
+
+        /// <summary>
+        /// Finds the first solid tile along a ray
+        /// </summary>
+        public bool Cast(Vec2 origin, Vec2 direction, out TileHit hit,
+            float maxDistance = float.PositiveInfinity)
+        {
+            Span<Vec2> directions = stackalloc Vec2[] { direction };
+            Span<TileHit> hits = stackalloc TileHit[1];
+
+            Cast(origin, directions, hits, maxDistance);
+            hit = hits[0];
+            return hit.Hit;
+        }
+
+        /// <summary>
+        /// Casts a ray from the origin along every direction in one call,
+        /// such as one for each screen column. Directions don't need to be
+        /// normalized. Returns how many of them hit a tile.
+        /// </summary>
+        public unsafe int Cast(Vec2 origin, ReadOnlySpan<Vec2> directions,
+            Span<TileHit> hits, float maxDistance = float.PositiveInfinity)
+        {
+            if (hits.Length < directions.Length)
+                throw new ArgumentException("Every ray needs a hit!");
+
+            fixed (Vec2* directionsPtr = directions)
+            fixed (TileHit* hitsPtr = hits)
+            {
+                return (int)Core.CastTileRays(id, origin.X, origin.Y,
+                    (float*)directionsPtr, (uint)directions.Length,
+                    maxDistance, hitsPtr);
+            }
+        }
+
+        /// <summary>
+        /// Frees the grid in the core
+        /// </summary>
+        public void Dispose()
+        {
+            if (id == 0) return;
+            Core.DestroyTileGrid(id);
+            id = 0;
+        }
+    }
+
+    /// <summary>
+    /// Where a ray first hit a solid tile. Side is 0 for the faces facing
+    /// along x, 1 for those along y, and -1 for rays starting inside the
+    /// tile. U runs from 0 to 1 across the face for texturing.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TileHit
+    {
+        public float Distance, U;
+        public int CellX, CellY, Side;
+        public uint Tile;
+
+        /// <summary>
+        /// Whether the ray hit anything
+        /// </summary>
+        public bool Hit => Tile != 0;
+    }
+}
@@ -0,0 +1,122 @@
+using System;
+using System.Runtime.InteropServices;
+
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using Szark.Graphics;
+
+namespace Tests
+{
+    [TestClass]
+    public class ImageTests
+    {
+        [DllImport("SzarkCore.dll")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool ReadImageSize(byte[] image, ulong size,
+            out uint width, out uint height);
+
+        [DllImport("SzarkCore.dll")]
+        [return: MarshalAs(UnmanagedType.I1)]
+        static extern bool DecodeImage(byte[] image, ulong size,
+            [Out] Color[] pixels, uint width, uint height);
+
+        // A 2x2 RGBA image: red, green / blue, white
+        static readonly byte[] Png =
+        {
+            0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D,
+            0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+            0x08, 0x06, 0x00, 0x00, 0x00, 0x72, 0xB6, 0x0D, 0x24, 0x00, 0x00, 0x00,
+            0x13, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9C, 0x63, 0xF8, 0xCF, 0xC0, 0xF0,
+            0x1F, 0x0C, 0x81, 0x34, 0x08, 0x34, 0x00, 0x00, 0x49, 0x49, 0x09, 0x78,
+            0x28, 0xA0, 0xDB, 0x77, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4E, 0x44,
+            0xAE, 0x42, 0x60, 0x82
+        };
+
+        static byte[] Targa(int type, int bpp)
+        {
+            var image = new byte[18 + 4 * ((bpp + 7) / 8)];
+            (image[2], image[12], image[14], image[16]) = ((byte)type, 2, 2, (byte)bpp);
+            for (int i = 18; i < image.Length; i++) image[i] = (byte)(i * 7);
+            return image;
+        }
+
+        static byte[] Bitmap()
+        {
+            // 2x2, 24 bits, rows padded to 8 bytes
+            var image = new byte[54 + 16];
+            (image[0], image[1], image[2]) = ((byte)'B', (byte)'M', (byte)image.Length);
+            (image[10], image[14], image[18], image[22]) = (54, 40, 2, 2);
+            (image[26], image[28]) = (1, 24);
+            for (int i = 54; i < image.Length; i++) image[i] = (byte)(i * 7);
+            return image;
+        }
+
+        static bool Decode(byte[] image)
+        {
+            if (!ReadImageSize(image, (ulong)image.Length, out uint width, out uint height))
+                return false;
+            var pixels = new Color[width * height];
+            return DecodeImage(image, (ulong)image.Length, pixels, width, height);
+        }
+
+        [TestMethod]
+        public void DecodesPng()
+        {
+            var pixels = new Color[4];
+            Assert.IsTrue(DecodeImage(Png, (ulong)Png.Length, pixels, 2, 2));
+            Assert.AreEqual(new Color(255, 0, 0), pixels[0]);
+            Assert.AreEqual(new Color(0, 0, 255), pixels[2]);
+            Assert.AreEqual(new Color(255, 255, 255), pixels[3]);
+        }
+
+        [TestMethod]
+        public void RejectsTruncatedImages()
+        {
+            foreach (var image in new[] { Targa(2, 24), Targa(2, 32), Bitmap() })
+            {
+                Assert.IsTrue(Decode(image));
+                for (int length = 0; length < image.Length; length++)
+                    Assert.IsFalse(Decode(image[..length]), $"{length} bytes");
+            }
+
+            // Everything but the end chunk holds pixel data
+            for (int length = 0; length < Png.Length - 12; length++)
+                Assert.IsFalse(Decode(Png[..length]), $"{length} bytes");
+        }
+
+        [TestMethod]
+        public void RejectsMalformedImages()
+        {
+            Assert.IsFalse(ReadImageSize(Targa(2, 8), 22, out _, out _));
+            Assert.IsFalse(ReadImageSize(Targa(2, 12), 24, out _, out _));
+            Assert.IsFalse(ReadImageSize(Targa(3, 16), 26, out _, out _));
+
+            var corrupt = (byte[])Png.Clone();
+            corrupt[45] ^= 0xff;
+            Assert.IsFalse(Decode(corrupt));
+
+            var mismatched = new Color[4];
+            Assert.IsFalse(DecodeImage(Png, (ulong)Png.Length, mismatched, 4, 1));
+        }
+
+        [TestMethod]
+        public void SurvivesCorruptImages()
+        {
+            var random = new Random(1);
+            var images = new[] { Targa(2, 24), Targa(2, 16), Bitmap(), Png };
+
+            for (int i = 0; i < 20000; i++)
+            {
+                var image = (byte[])images[i % images.Length].Clone();
+                for (int j = random.Next(1, 5); j > 0; j--)
+                    image[random.Next(image.Length)] = (byte)random.Next(256);
+
+                if (ReadImageSize(image, (ulong)image.Length, out uint width, out uint height) &&
+                    (ulong)width * height <= 1 << 20)
+                {
+                    var pixels = new Color[width * height];
+                    DecodeImage(image, (ulong)image.Length, pixels, width, height);
+                }
+            }
+        }
+    }
+}
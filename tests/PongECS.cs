@@ -1,7 +1,10 @@
+using System;
+
 using Szark.ECS;
 using Szark.Graphics;
 using Szark.Input;
 using Szark.Math;
+using Szark.Physics;
 using Szark;
 
 namespace Example
@@ -34,6 +37,7 @@ namespace Example
     /// This renders a square on the screen for 
     /// entities that have a Quad component.
     /// </summary>
+    [Reads(typeof(Quad)), Writes(typeof(Canvas))]
     public class QuadRenderer : ComponentSystem<Pong>
     {
         public override void Execute(Canvas canvas, float deltaTime)
@@ -53,6 +57,7 @@ namespace Example
     /// <summary>
     /// This moves the player entity with keyboard input.
     /// </summary>
+    [Reads(typeof(PlayerTag)), Writes(typeof(Quad))]
     public class PlayerMover : ComponentSystem<Pong>
     {
         public override void Execute(Canvas canvas, float deltaTime)
@@ -81,6 +86,7 @@ namespace Example
     /// <summary>
     /// This moves the enemy paddle toward the ball.
     /// </summary>
+    [Reads(typeof(EnemyTag)), Writes(typeof(Quad))]
     public class EnemyAI : ComponentSystem<Pong>
     {
         private float speed = 8.0f;
@@ -123,46 +129,51 @@ namespace Example
     /// This checks whether the ball has collided with something.
     /// If so, then the ball will change trajectory.
     /// </summary>
+    [Writes(typeof(Quad), typeof(Velocity))]
     public class ColliderSystem : ComponentSystem<Pong>
     {
         public override void Execute(Canvas canvas, float deltaTime)
         {
-            Entities.Query().ForEach((ref Velocity vel, ref Quad quad) =>
-            {
-                var (X, Y) = quad.Position;
-                var width = quad.Size.X;
-                var height = quad.Size.Y;
-                var newVel = vel.Value;
-
-                // Bounce off ceiling
-                if (Y < 0 || Y + height > Game.ScreenHeight)
-                    newVel = new Vec2(vel.Value.X, -vel.Value.Y);
+            // Every quad goes in the broadphase so the ball only
+            // tests against the quads around it
+            var broadphase = Game.Broadphase;
+            broadphase.Build<Quad>(Entities.Query());
 
-                // Reset ball if it goes past goals
-                if (X + width > Game.ScreenWidth || X < 0)
-                {
-                    quad.Position = new(Game.ScreenWidth * 0.5f,
-                        Game.ScreenHeight * 0.5f);
-                    newVel *= -1;
-                }
+            Entities.Query().ForEachChunk((ReadOnlySpan<Entity> entities,
+                Span<Velocity> velocities, Span<Quad> quads) =>
+            {
+                Span<Entity> others = stackalloc Entity[8];
 
-                // Check for collision with Paddles
-                Entities.Query().ForEach((ref Quad other) =>
+                for (int i = 0; i < entities.Length; i++)
                 {
-                    if (X != other.Position.X && Y != other.Position.Y)
+                    ref var quad = ref quads[i];
+                    var (X, Y) = quad.Position;
+                    var width = quad.Size.X;
+                    var height = quad.Size.Y;
+                    var newVel = velocities[i].Value;
+
+                    // Bounce off ceiling
+                    if (Y < 0 || Y + height > Game.ScreenHeight)
+                        newVel = new Vec2(newVel.X, -newVel.Y);
+
+                    // Reset ball if it goes past goals
+                    if (X + width > Game.ScreenWidth || X < 0)
                     {
-                        if (X + width >= other.Position.X &&
-                            X < other.Position.X + other.Size.X &&
-                            Y + height >= other.Position.Y &&
-                            Y < other.Position.Y + other.Size.Y)
-                        {
-                            newVel.X *= -1;
-                        }
+                        quad.Position = new(Game.ScreenWidth * 0.5f,
+                            Game.ScreenHeight * 0.5f);
+                        newVel *= -1;
                     }
 
-                });
+                    // Check for collision with Paddles
+                    int count = broadphase.QueryRect(new Vec2(X, Y),
+                        quad.Size, others);
+
+                    for (int j = 0; j < System.Math.Min(count, others.Length); j++)
+                        if (others[j] != entities[i])
+                            newVel.X *= -1;
 
-                vel.Value = newVel;
+                    velocities[i].Value = newVel;
+                }
             });
         }
     }
@@ -170,6 +181,7 @@ namespace Example
     /// <summary>
     /// This is in charge of simply moving the ball with a velocity.
     /// </summary>
+    [Reads(typeof(Velocity)), Writes(typeof(Quad))]
     public class BallMover : ComponentSystem<Pong>
     {
         public override void Execute(Canvas canvas, float deltaTime)
@@ -187,6 +199,8 @@ namespace Example
 
         public Entity player, enemy, ball;
 
+        public Broadphase Broadphase { get; } = new Broadphase(32);
+
         protected override void OnCreated()
         {
             float centerY = ScreenHeight * 0.5f;
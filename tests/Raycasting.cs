@@ -1,6 +1,7 @@
 using System;
 using Szark.Graphics;
 using Szark.Math;
+using Szark.Physics;
 
 namespace Example
 {
@@ -16,9 +17,12 @@ namespace Example
         };
 
         private const float MAX_DIST = 10f;
-        private const float RAY_INCR = 0.1f;
         private const float FOV = 70f;
 
+        private TileGrid grid = new TileGrid(map[0].Length, map.Length);
+        private Vec2[] rayDirs = Array.Empty<Vec2>();
+        private TileHit[] rayHits = Array.Empty<TileHit>();
+
         private Vec2 playerPos;
         private float lookAngle = 45f;
 
@@ -35,9 +39,14 @@ namespace Example
                 for (int j = 0; j < map[i].Length; j++)
                 {
                     if (map[i][j] == 'P')
-                        playerPos = new Vec2(j, i);
+                        playerPos = new Vec2(j + 0.5f, i + 0.5f);
+
+                    grid[j, i] = (byte)(map[i][j] == 'X' ? 1 : 0);
                 }
             }
+
+            rayDirs = new Vec2[ScreenWidth];
+            rayHits = new TileHit[ScreenWidth];
         }
 
         protected override void OnRender(Canvas canvas, float deltaTime)
@@ -47,27 +56,22 @@ namespace Example
                 float colNorm = (col - (ScreenWidth * 0.5f)) / ScreenWidth;
                 float angle = ((colNorm * FOV) + lookAngle) * Mathf.DEG2RAD;
 
-                Vec2 lookDir = new Vec2((float)Math.Cos(angle),
+                rayDirs[col] = new Vec2((float)Math.Cos(angle),
                     (float)Math.Sin(angle));
+            }
 
-                float dist = RAY_INCR;
-
-                while (dist < MAX_DIST)
-                {
-                    Vec2 ray = playerPos + (lookDir * dist);
-
-                    ray.X = (float)Math.Round(ray.X);
-                    ray.Y = (float)Math.Round(ray.Y);
-
-                    if (map[(int)ray.Y][(int)ray.X] == 'X')
-                        break;
+            // Every column is cast in a single call
+            grid.Cast(playerPos, rayDirs, rayHits, MAX_DIST);
 
-                    dist += RAY_INCR;
-                }
+            for (int col = 0; col < ScreenWidth; col++)
+            {
+                ref var hit = ref rayHits[col];
+                float dist = hit.Hit ? hit.Distance : MAX_DIST;
 
+                // Walls along y are a little darker to tell the sides apart
                 float distNorm = dist / MAX_DIST;
                 float centerDist = distNorm * ScreenHeight * 0.5f;
-                byte distVal = (byte)((1 - distNorm) * 255.0f);
+                byte distVal = (byte)((1 - distNorm) * (hit.Side == 1 ? 200f : 255f));
 
                 for (int row = 0; row < ScreenHeight; row++)
                 {
@@ -106,6 +110,7 @@ namespace Example
 
         protected override void OnDestroy()
         {
+            grid.Dispose();
             base.OnDestroy();
         }
     }
@@ -46,11 +46,15 @@ namespace Example
 
     public class Raytracing : Szark.Game
     {
-        public Raytracing() : base("Raytracing", 800, 800, 2, false) { }
+        public Raytracing() : base("Raytracing", 800, 800, 2, false)
+        {
+            // Trades resolution for a steady 60 fps
+            FrameBudget = 1 / 60.0;
+            SmoothScaling = true;
+        }
 
         const float STEP = 0.05f;
         const float MAX_DIST = 10.0f;
-        const int SUB_DIVISIONS = 2;
 
         private float framerate = 0f;
         private float time = 0f;
@@ -94,11 +98,17 @@ namespace Example
             Direction = new Vec3(0, 0, 1),
         };
 
-        private Random random = new Random();
+        // Random isn't thread safe, so each worker gets its own
+        private Random[] randoms = Array.Empty<Random>();
 
         protected override void OnCreated()
         {
             VSync = false;
+            TiledRendering = true;
+
+            randoms = new Random[Szark.Jobs.WorkerCount];
+            for (int i = 0; i < randoms.Length; i++)
+                randoms[i] = new Random(i);
         }
 
         protected override void OnRender(Canvas gfx, float deltaTime)
@@ -109,27 +119,15 @@ namespace Example
                 time = 0;
             }
 
-            int regionWidth = (int)ScreenWidth / SUB_DIVISIONS;
-            int regionHeight = (int)ScreenHeight / SUB_DIVISIONS;
-
-            for (int i = 0; i < SUB_DIVISIONS; i++)
-            {
-                for (int j = 0; j < SUB_DIVISIONS; j++)
-                {
-                    RenderRegion(
-                        gfx,
-                        regionWidth * i,
-                        regionHeight * j,
-                        regionWidth,
-                        regionHeight
-                    );
-                }
-            }
-
             gfx.DrawString(0, 0, $"{framerate}", Color.Green);
         }
 
-        private void RenderRegion(Canvas canvas, int x0, int y0, int width, int height)
+        protected override void OnRenderTile(Canvas gfx, Tile tile, float deltaTime) =>
+            RenderRegion(gfx, tile.X, tile.Y, tile.Width, tile.Height,
+                randoms[tile.Worker]);
+
+        private void RenderRegion(Canvas canvas, int x0, int y0, int width,
+            int height, Random random)
         {
             Vec3 perp = camera.Direction.GetPerpendicular().Normalized();
 
@@ -1,5 +1,4 @@
 using Szark.Graphics;
-using System.IO;
 using System;
 
 namespace Example
@@ -15,9 +14,9 @@ namespace Example
         {
             // Setup Custom GPU Shader
             ErrorRecieved += s => throw new ApplicationException($"[Error]: {s}");
-            string vertSrc = File.ReadAllText("resources/raytracing.vert");
-            string fragSrc = File.ReadAllText("resources/raytracing.frag");
-            shader = SetCustomShader(vertSrc, fragSrc);
+            // Edits to the shader files show up without a restart
+            shader = LoadCustomShader("resources/raytracing.vert",
+                "resources/raytracing.frag", hotReload: true);
 
             uCol = shader.GetLocation("uCol").GetValueOrDefault(0);
         }